@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Scaling benchmark of the Grid Location Service model. For every network
+ * size the area grows so that the node density stays constant; nodes move
+ * with the random waypoint model and look up random targets. Reports the
+ * per-node state (entries served), update cost and lookup cost, in
+ * geographic hops, together with the wall-clock time of each run.
+ *
+ *   ./waf --run "gls-scaling --sizes=1000,2000,5000,10000"
+ */
+
+#include "ns3/gpsr-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <ctime>
+#include <cstdlib>
+
+using namespace ns3;
+
+class GlsScaling
+{
+public:
+  GlsScaling ();
+  /// Configure script parameters, \return true on successful configuration
+  bool Configure (int argc, char **argv);
+  /// Run one simulation per network size and report each
+  void Run (std::ostream & os);
+
+private:
+  ///\name parameters
+  //\{
+  /// Network sizes, comma separated
+  std::string sizes;
+  /// Nodes per square kilometre
+  double density;
+  /// Simulation time, seconds
+  double totalTime;
+  /// Maximum node speed, m/s
+  double maxSpeed;
+  /// Lookups made by every node
+  uint32_t lookupsPerNode;
+  //\}
+
+  void RunSize (uint32_t size, std::ostream & os);
+  static void Lookup (Ptr<gpsr::GlsLocationService> gls, Ipv4Address target);
+};
+
+int main (int argc, char **argv)
+{
+  GlsScaling test;
+  if (! test.Configure (argc, argv))
+    NS_FATAL_ERROR ("Configuration failed. Aborted.");
+
+  test.Run (std::cout);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+GlsScaling::GlsScaling () :
+  sizes ("1000,2000,5000,10000"),
+  density (100),
+  totalTime (60),
+  maxSpeed (10),
+  lookupsPerNode (5)
+{
+}
+
+bool
+GlsScaling::Configure (int argc, char **argv)
+{
+  SeedManager::SetSeed (12345);
+  CommandLine cmd;
+
+  cmd.AddValue ("sizes", "Network sizes, comma separated.", sizes);
+  cmd.AddValue ("density", "Nodes per square kilometre.", density);
+  cmd.AddValue ("time", "Simulation time, s.", totalTime);
+  cmd.AddValue ("maxSpeed", "Maximum node speed, m/s.", maxSpeed);
+  cmd.AddValue ("lookups", "Lookups made by every node.", lookupsPerNode);
+
+  cmd.Parse (argc, argv);
+  return density > 0 && totalTime > 10;
+}
+
+void
+GlsScaling::Run (std::ostream & os)
+{
+  os << "Nodes,Side(m),MeanState,MaxState,UpdateHopsPerNodePerSec,Lookups,LookupSuccess,MeanLookupHops,WallClock(s)\n";
+  std::istringstream list (sizes);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      RunSize (std::atoi (item.c_str ()), os);
+    }
+}
+
+void
+GlsScaling::Lookup (Ptr<gpsr::GlsLocationService> gls, Ipv4Address target)
+{
+  gls->GetPosition (target);
+}
+
+void
+GlsScaling::RunSize (uint32_t size, std::ostream & os)
+{
+  std::clock_t begin = std::clock ();
+  double side = std::sqrt (size / density) * 1000;
+
+  NodeContainer nodes;
+  nodes.Create (size);
+
+  std::ostringstream bound;
+  bound << "ns3::UniformRandomVariable[Min=0.0|Max=" << side << "]";
+  ObjectFactory pos;
+  pos.SetTypeId ("ns3::RandomRectanglePositionAllocator");
+  pos.Set ("X", StringValue (bound.str ()));
+  pos.Set ("Y", StringValue (bound.str ()));
+  Ptr<PositionAllocator> positionAlloc = pos.Create ()->GetObject<PositionAllocator> ();
+
+  std::ostringstream speed;
+  speed << "ns3::UniformRandomVariable[Min=1.0|Max=" << maxSpeed << "]";
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::RandomWaypointMobilityModel",
+                             "Speed", StringValue (speed.str ()),
+                             "Pause", StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"),
+                             "PositionAllocator", PointerValue (positionAlloc));
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.Install (nodes);
+
+  // 10.0.0.1, 10.0.0.2, ... as with Ipv4AddressHelper
+  uint32_t base = Ipv4Address ("10.0.0.0").Get ();
+  std::vector<Ptr<gpsr::GlsLocationService> > services;
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      Ptr<gpsr::GlsLocationService> gls = CreateObject<gpsr::GlsLocationService> ();
+      gls->SetAttribute ("WorldSize", DoubleValue (side));
+      gls->Start (Ipv4Address (base + i + 1), nodes.Get (i)->GetObject<MobilityModel> ());
+      services.push_back (gls);
+    }
+
+  // lookups start once every node has placed its servers
+  Ptr<UniformRandomVariable> when = CreateObject<UniformRandomVariable> ();
+  Ptr<UniformRandomVariable> who = CreateObject<UniformRandomVariable> ();
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      for (uint32_t j = 0; j < lookupsPerNode; ++j)
+        {
+          uint32_t target = who->GetInteger (0, size - 1);
+          Simulator::Schedule (Seconds (when->GetValue (5, totalTime)), &GlsScaling::Lookup,
+                               services[i], Ipv4Address (base + target + 1));
+        }
+    }
+
+  Simulator::Stop (Seconds (totalTime));
+  Simulator::Run ();
+
+  uint64_t state = 0;
+  uint32_t maxState = 0;
+  uint64_t updateHops = 0;
+  uint64_t lookupHops = 0;
+  uint32_t lookups = 0;
+  uint32_t failed = 0;
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      state += services[i]->GetStateSize ();
+      maxState = std::max (maxState, services[i]->GetStateSize ());
+      updateHops += services[i]->GetUpdateHops ();
+      lookupHops += services[i]->GetLookupHops ();
+      lookups += services[i]->GetLookups ();
+      failed += services[i]->GetFailedLookups ();
+      // leaves the shared GLS registry for the next size
+      services[i]->Dispose ();
+    }
+  Simulator::Destroy ();
+
+  os << size << "," << side << ","
+     << (double) state / size << "," << maxState << ","
+     << (double) updateHops / size / totalTime << ","
+     << lookups << "," << (lookups ? 1 - (double) failed / lookups : 0) << ","
+     << (lookups ? (double) lookupHops / lookups : 0) << ","
+     << (double) (std::clock () - begin) / CLOCKS_PER_SEC << "\n";
+}
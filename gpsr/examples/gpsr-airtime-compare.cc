@@ -0,0 +1,296 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Greedy next hop by geometry or by airtime, on the 802.11b setup of the
+ * ns-3 manet-routing-compare example: 50 nodes with random waypoint
+ * mobility in a 300x1500 m area, Friis loss, 7.5 dBm, and CBR flows
+ * between node pairs. Reports the end-to-end throughput.
+ *
+ * The geometric metric favours long hops at the edge of range, which
+ * need the most retries (and, with --manager=ns3::AarfWifiManager, the
+ * lowest rates); the airtime metric trades progress against the expected
+ * channel time of every neighbour.
+ *
+ * With --twoHop the HELLOs also carry the neighbour positions, and the
+ * Recovery-mode entries made and avoided are reported with the HELLO
+ * overhead this costs.
+ *
+ *   ./waf --run "gpsr-airtime-compare --airtime=0"
+ *   ./waf --run "gpsr-airtime-compare --airtime=1"
+ *   ./waf --run "gpsr-airtime-compare --twoHop=1"
+ *
+ * With --loadTolerance a neighbour advertising a shorter MAC queue takes
+ * the traffic of a loaded greedy next hop if it makes at most that much
+ * less progress. The load is best seen with the workload scaled from 10 to
+ * 50 flows, where every node sinks one flow:
+ *
+ *   ./waf --run "gpsr-airtime-compare --sinks=50 --loadTolerance=0"
+ *   ./waf --run "gpsr-airtime-compare --sinks=50 --loadTolerance=50"
+ */
+
+#include "ns3/gpsr-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/applications-module.h"
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+class AirtimeCompareExample
+{
+public:
+  AirtimeCompareExample ();
+  /// Configure script parameters, \return true on successful configuration
+  bool Configure (int argc, char **argv);
+  /// Run simulation
+  void Run ();
+  /// Report results
+  void Report (std::ostream & os);
+
+private:
+  ///\name parameters
+  //\{
+  /// Number of nodes
+  uint32_t size;
+  /// Number of CBR flows
+  uint32_t nSinks;
+  /// Simulation time, seconds
+  double totalTime;
+  /// Start of the flows, seconds
+  double flowStart;
+  /// Rate of every flow
+  std::string rate;
+  /// Maximum node speed, m/s
+  double maxSpeed;
+  /// Transmit power, dBm
+  double txp;
+  /// Remote station manager
+  std::string manager;
+  /// Select next hops by progress per airtime
+  bool airtime;
+  /// Advertise neighbour positions in HELLOs
+  bool twoHop;
+  /// Progress a less loaded next hop may give up, meters
+  double loadTolerance;
+  //\}
+
+  ///\name statistics
+  //\{
+  uint64_t bytesReceived;
+  uint32_t packetsReceived;
+  /// Packets that entered Recovery-mode, all nodes
+  uint32_t perimeterEntries;
+  /// Greedy choices steered away from dead ends, all nodes
+  uint32_t perimeterEntriesAvoided;
+  /// Neighbour summary bytes sent in HELLOs, all nodes
+  uint64_t twoHopBytes;
+  /// Greedy choices moved to a less loaded neighbour, all nodes
+  uint32_t loadDetours;
+  //\}
+
+  ///\name network
+  //\{
+  NodeContainer nodes;
+  NetDeviceContainer devices;
+  Ipv4InterfaceContainer interfaces;
+  //\}
+
+private:
+  void CreateNodes ();
+  void CreateDevices ();
+  void InstallInternetStack ();
+  void InstallApplications ();
+  void SinkRx (Ptr<const Packet> packet, const Address &from);
+};
+
+int main (int argc, char **argv)
+{
+  AirtimeCompareExample test;
+  if (! test.Configure (argc, argv))
+    NS_FATAL_ERROR ("Configuration failed. Aborted.");
+
+  test.Run ();
+  test.Report (std::cout);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+AirtimeCompareExample::AirtimeCompareExample () :
+  size (50),
+  nSinks (10),
+  totalTime (200),
+  flowStart (100),
+  rate ("2048bps"),
+  maxSpeed (20),
+  txp (7.5),
+  manager ("ns3::ConstantRateWifiManager"),
+  airtime (false),
+  twoHop (false),
+  loadTolerance (0),
+  bytesReceived (0),
+  packetsReceived (0),
+  perimeterEntries (0),
+  perimeterEntriesAvoided (0),
+  twoHopBytes (0),
+  loadDetours (0)
+{
+}
+
+bool
+AirtimeCompareExample::Configure (int argc, char **argv)
+{
+  SeedManager::SetSeed (12345);
+  CommandLine cmd;
+
+  cmd.AddValue ("size", "Number of nodes.", size);
+  cmd.AddValue ("sinks", "Number of CBR flows.", nSinks);
+  cmd.AddValue ("time", "Simulation time, s.", totalTime);
+  cmd.AddValue ("start", "Start of the flows, s.", flowStart);
+  cmd.AddValue ("rate", "Rate of every flow.", rate);
+  cmd.AddValue ("maxSpeed", "Maximum node speed, m/s.", maxSpeed);
+  cmd.AddValue ("txp", "Transmit power, dBm.", txp);
+  cmd.AddValue ("manager", "Remote station manager, DsssRate11Mbps when constant rate.", manager);
+  cmd.AddValue ("airtime", "Select next hops by progress per expected airtime.", airtime);
+  cmd.AddValue ("twoHop", "Advertise neighbour positions in HELLOs to avoid greedy dead ends.", twoHop);
+  cmd.AddValue ("loadTolerance", "Progress a less loaded next hop may give up, m; 0 disables.", loadTolerance);
+
+  cmd.Parse (argc, argv);
+  return nSinks <= size && flowStart < totalTime;
+}
+
+void
+AirtimeCompareExample::Run ()
+{
+  CreateNodes ();
+  CreateDevices ();
+  InstallInternetStack ();
+  InstallApplications ();
+
+  GpsrHelper gpsr;
+  gpsr.Install ();
+
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx",
+                                 MakeCallback (&AirtimeCompareExample::SinkRx, this));
+
+  std::cout << "Starting simulation for " << totalTime << " s, airtime metric " << airtime << " ...\n";
+
+  Simulator::Stop (Seconds (totalTime));
+  Simulator::Run ();
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      Ptr<gpsr::RoutingProtocol> routing = nodes.Get (i)->GetObject<gpsr::RoutingProtocol> ();
+      perimeterEntries += routing->GetPerimeterEntries ();
+      perimeterEntriesAvoided += routing->GetPerimeterEntriesAvoided ();
+      twoHopBytes += routing->GetTwoHopOverhead ();
+      loadDetours += routing->GetLoadDetours ();
+    }
+  Simulator::Destroy ();
+}
+
+void
+AirtimeCompareExample::Report (std::ostream & os)
+{
+  os << "Airtime metric " << airtime << ", " << manager << ", " << nSinks << " flows of " << rate << "\n"
+     << "Packets received: " << packetsReceived << "\n"
+     << "End-to-end throughput: " << bytesReceived * 8 / (totalTime - flowStart) / 1000 << " kbit/s\n"
+     << "Recovery-mode entries: " << perimeterEntries << ", avoided: " << perimeterEntriesAvoided << "\n"
+     << "Neighbour summary overhead: " << twoHopBytes * 8 / totalTime / size << " bit/s per node\n"
+     << "Load detours (tolerance " << loadTolerance << " m): " << loadDetours << "\n";
+}
+
+void
+AirtimeCompareExample::SinkRx (Ptr<const Packet> packet, const Address &from)
+{
+  packetsReceived++;
+  bytesReceived += packet->GetSize ();
+}
+
+void
+AirtimeCompareExample::CreateNodes ()
+{
+  std::cout << "Creating " << (unsigned)size << " nodes in 300x1500 m.\n";
+  nodes.Create (size);
+
+  ObjectFactory pos;
+  pos.SetTypeId ("ns3::RandomRectanglePositionAllocator");
+  pos.Set ("X", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=300.0]"));
+  pos.Set ("Y", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=1500.0]"));
+  Ptr<PositionAllocator> positionAlloc = pos.Create ()->GetObject<PositionAllocator> ();
+
+  std::ostringstream speed;
+  speed << "ns3::UniformRandomVariable[Min=0.0|Max=" << maxSpeed << "]";
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::RandomWaypointMobilityModel",
+                             "Speed", StringValue (speed.str ()),
+                             "Pause", StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"),
+                             "PositionAllocator", PointerValue (positionAlloc));
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.Install (nodes);
+}
+
+void
+AirtimeCompareExample::CreateDevices ()
+{
+  NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+  wifiPhy.Set ("TxPowerStart", DoubleValue (txp));
+  wifiPhy.Set ("TxPowerEnd", DoubleValue (txp));
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
+  if (manager == "ns3::ConstantRateWifiManager")
+    {
+      wifi.SetRemoteStationManager (manager, "DataMode", StringValue ("DsssRate11Mbps"), "ControlMode", StringValue ("DsssRate11Mbps"));
+    }
+  else
+    {
+      wifi.SetRemoteStationManager (manager);
+    }
+  devices = wifi.Install (wifiPhy, wifiMac, nodes);
+}
+
+void
+AirtimeCompareExample::InstallInternetStack ()
+{
+  GpsrHelper gpsr;
+  gpsr.Set ("AirtimeMetric", BooleanValue (airtime));
+  gpsr.Set ("TwoHopHello", BooleanValue (twoHop));
+  gpsr.Set ("LoadTolerance", DoubleValue (loadTolerance));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (gpsr);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.0.0");
+  interfaces = address.Assign (devices);
+}
+
+void
+AirtimeCompareExample::InstallApplications ()
+{
+  uint16_t port = 9;
+  Ptr<UniformRandomVariable> start = CreateObject<UniformRandomVariable> ();
+  // as in manet-routing-compare: node i sinks the flow of node i + nSinks;
+  // with more than size / 2 flows the sources wrap around, half the nodes away
+  uint32_t shift = nSinks < size ? nSinks : size / 2;
+  for (uint32_t i = 0; i < nSinks; ++i)
+    {
+      PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      ApplicationContainer apps = sinkHelper.Install (nodes.Get (i));
+      apps.Start (Seconds (1.0));
+      apps.Stop (Seconds (totalTime));
+
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (interfaces.GetAddress (i), port));
+      onoff.SetConstantRate (DataRate (rate), 64);
+      apps = onoff.Install (nodes.Get ((i + shift) % size));
+      apps.Start (Seconds (start->GetValue (flowStart, flowStart + 1)));
+      apps.Stop (Seconds (totalTime));
+    }
+}
@@ -0,0 +1,293 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Greedy GPSR with HELLO-maintained neighbour tables against beaconless
+ * contention-based forwarding, at vehicular speeds: 50 nodes with random
+ * waypoint mobility between 20 and 40 m/s in a 300x1500 m area, 802.11b at
+ * 11 Mbit/s and CBR flows between node pairs.
+ *
+ * In beaconless mode no HELLO is sent; every data frame is broadcast and the
+ * receiver making the most progress forwards it first, the others give up
+ * when they overhear it. Reports the delivery ratio, the HELLO overhead and
+ * the data frames sent per delivered packet, which counts the duplicates of
+ * contentions that were not suppressed.
+ *
+ *   ./waf --run "gpsr-beaconless-compare --beaconless=0"
+ *   ./waf --run "gpsr-beaconless-compare --beaconless=1"
+ *   ./waf --run "gpsr-beaconless-compare --beaconless=1 --minSpeed=30 --maxSpeed=40"
+ */
+
+#include "ns3/gpsr-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/applications-module.h"
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+class BeaconlessCompareExample
+{
+public:
+  BeaconlessCompareExample ();
+  /// Configure script parameters, \return true on successful configuration
+  bool Configure (int argc, char **argv);
+  /// Run simulation
+  void Run ();
+  /// Report results
+  void Report (std::ostream & os);
+
+private:
+  ///\name parameters
+  //\{
+  /// Number of nodes
+  uint32_t size;
+  /// Number of CBR flows
+  uint32_t nSinks;
+  /// Simulation time, seconds
+  double totalTime;
+  /// Start of the flows, seconds
+  double flowStart;
+  /// Rate of every flow
+  std::string rate;
+  /// Node speed range, m/s
+  double minSpeed;
+  double maxSpeed;
+  /// Transmit power, dBm
+  double txp;
+  /// Forward by contention instead of by neighbour tables
+  bool beaconless;
+  //\}
+
+  ///\name statistics
+  //\{
+  uint32_t packetsSent;
+  uint32_t packetsReceived;
+  /// HELLOs sent and their bytes, all nodes
+  uint32_t hellos;
+  uint64_t helloBytes;
+  /// Frames handed to the MACs, HELLOs included
+  uint32_t macFrames;
+  /// Beaconless contentions won and given up, all nodes
+  uint32_t contentionWins;
+  uint32_t contentionsSuppressed;
+  //\}
+
+  ///\name network
+  //\{
+  NodeContainer nodes;
+  NetDeviceContainer devices;
+  Ipv4InterfaceContainer interfaces;
+  //\}
+
+private:
+  void CreateNodes ();
+  void CreateDevices ();
+  void InstallInternetStack ();
+  void InstallApplications ();
+  void SourceTx (Ptr<const Packet> packet);
+  void SinkRx (Ptr<const Packet> packet, const Address &from);
+  void HelloTx (Ptr<const Packet> packet);
+  void MacTx (Ptr<const Packet> packet);
+};
+
+int main (int argc, char **argv)
+{
+  BeaconlessCompareExample test;
+  if (! test.Configure (argc, argv))
+    NS_FATAL_ERROR ("Configuration failed. Aborted.");
+
+  test.Run ();
+  test.Report (std::cout);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+BeaconlessCompareExample::BeaconlessCompareExample () :
+  size (50),
+  nSinks (10),
+  totalTime (200),
+  flowStart (100),
+  rate ("2048bps"),
+  minSpeed (20),
+  maxSpeed (40),
+  txp (7.5),
+  beaconless (false),
+  packetsSent (0),
+  packetsReceived (0),
+  hellos (0),
+  helloBytes (0),
+  macFrames (0),
+  contentionWins (0),
+  contentionsSuppressed (0)
+{
+}
+
+bool
+BeaconlessCompareExample::Configure (int argc, char **argv)
+{
+  SeedManager::SetSeed (12345);
+  CommandLine cmd;
+
+  cmd.AddValue ("size", "Number of nodes.", size);
+  cmd.AddValue ("sinks", "Number of CBR flows.", nSinks);
+  cmd.AddValue ("time", "Simulation time, s.", totalTime);
+  cmd.AddValue ("start", "Start of the flows, s.", flowStart);
+  cmd.AddValue ("rate", "Rate of every flow.", rate);
+  cmd.AddValue ("minSpeed", "Minimum node speed, m/s.", minSpeed);
+  cmd.AddValue ("maxSpeed", "Maximum node speed, m/s.", maxSpeed);
+  cmd.AddValue ("txp", "Transmit power, dBm.", txp);
+  cmd.AddValue ("beaconless", "Forward by contention among the receivers, without HELLOs.", beaconless);
+
+  cmd.Parse (argc, argv);
+  return nSinks <= size && flowStart < totalTime && minSpeed <= maxSpeed;
+}
+
+void
+BeaconlessCompareExample::Run ()
+{
+  CreateNodes ();
+  CreateDevices ();
+  InstallInternetStack ();
+  InstallApplications ();
+
+  GpsrHelper gpsr;
+  gpsr.Install ();
+
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::OnOffApplication/Tx",
+                                 MakeCallback (&BeaconlessCompareExample::SourceTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx",
+                                 MakeCallback (&BeaconlessCompareExample::SinkRx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::RoutingProtocol/HelloTx",
+                                 MakeCallback (&BeaconlessCompareExample::HelloTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
+                                 MakeCallback (&BeaconlessCompareExample::MacTx, this));
+
+  std::cout << "Starting simulation for " << totalTime << " s, beaconless " << beaconless << " ...\n";
+
+  Simulator::Stop (Seconds (totalTime));
+  Simulator::Run ();
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      Ptr<gpsr::RoutingProtocol> routing = nodes.Get (i)->GetObject<gpsr::RoutingProtocol> ();
+      contentionWins += routing->GetContentionWins ();
+      contentionsSuppressed += routing->GetContentionsSuppressed ();
+    }
+  Simulator::Destroy ();
+}
+
+void
+BeaconlessCompareExample::Report (std::ostream & os)
+{
+  uint32_t dataFrames = macFrames - hellos;
+  os << "Beaconless " << beaconless << ", speed " << minSpeed << "-" << maxSpeed << " m/s, " << nSinks << " flows of " << rate << "\n"
+     << "Delivery ratio: " << (packetsSent ? (double) packetsReceived / packetsSent : 0)
+     << " (" << packetsReceived << " of " << packetsSent << ")\n"
+     << "HELLO overhead: " << helloBytes * 8 / totalTime / size << " bit/s per node\n"
+     << "Data frames per delivered packet: " << (packetsReceived ? (double) dataFrames / packetsReceived : 0) << "\n"
+     << "Contentions won: " << contentionWins << ", suppressed: " << contentionsSuppressed << "\n";
+}
+
+void
+BeaconlessCompareExample::SourceTx (Ptr<const Packet> packet)
+{
+  packetsSent++;
+}
+
+void
+BeaconlessCompareExample::SinkRx (Ptr<const Packet> packet, const Address &from)
+{
+  packetsReceived++;
+}
+
+void
+BeaconlessCompareExample::HelloTx (Ptr<const Packet> packet)
+{
+  hellos++;
+  helloBytes += packet->GetSize ();
+}
+
+void
+BeaconlessCompareExample::MacTx (Ptr<const Packet> packet)
+{
+  macFrames++;
+}
+
+void
+BeaconlessCompareExample::CreateNodes ()
+{
+  std::cout << "Creating " << (unsigned)size << " nodes in 300x1500 m.\n";
+  nodes.Create (size);
+
+  ObjectFactory pos;
+  pos.SetTypeId ("ns3::RandomRectanglePositionAllocator");
+  pos.Set ("X", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=300.0]"));
+  pos.Set ("Y", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=1500.0]"));
+  Ptr<PositionAllocator> positionAlloc = pos.Create ()->GetObject<PositionAllocator> ();
+
+  std::ostringstream speed;
+  speed << "ns3::UniformRandomVariable[Min=" << minSpeed << "|Max=" << maxSpeed << "]";
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::RandomWaypointMobilityModel",
+                             "Speed", StringValue (speed.str ()),
+                             "Pause", StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"),
+                             "PositionAllocator", PointerValue (positionAlloc));
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.Install (nodes);
+}
+
+void
+BeaconlessCompareExample::CreateDevices ()
+{
+  NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+  wifiPhy.Set ("TxPowerStart", DoubleValue (txp));
+  wifiPhy.Set ("TxPowerEnd", DoubleValue (txp));
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("DsssRate11Mbps"), "ControlMode", StringValue ("DsssRate11Mbps"));
+  devices = wifi.Install (wifiPhy, wifiMac, nodes);
+}
+
+void
+BeaconlessCompareExample::InstallInternetStack ()
+{
+  GpsrHelper gpsr;
+  gpsr.Set ("Beaconless", BooleanValue (beaconless));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (gpsr);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.0.0");
+  interfaces = address.Assign (devices);
+}
+
+void
+BeaconlessCompareExample::InstallApplications ()
+{
+  uint16_t port = 9;
+  Ptr<UniformRandomVariable> start = CreateObject<UniformRandomVariable> ();
+  // as in manet-routing-compare: node i sinks the flow of node i + nSinks
+  uint32_t shift = nSinks < size ? nSinks : size / 2;
+  for (uint32_t i = 0; i < nSinks; ++i)
+    {
+      PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      ApplicationContainer apps = sinkHelper.Install (nodes.Get (i));
+      apps.Start (Seconds (1.0));
+      apps.Stop (Seconds (totalTime));
+
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (interfaces.GetAddress (i), port));
+      onoff.SetConstantRate (DataRate (rate), 64);
+      apps = onoff.Install (nodes.Get ((i + shift) % size));
+      apps.Start (Seconds (start->GetValue (flowStart, flowStart + 1)));
+      apps.Stop (Seconds (totalTime));
+    }
+}
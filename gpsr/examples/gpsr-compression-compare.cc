@@ -0,0 +1,282 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Full GPSR position headers against per-flow header compression: 50 nodes
+ * with random waypoint mobility in a 300x1500 m area, 802.11b at 11 Mbit/s
+ * and CBR flows of 64-byte packets between node pairs.
+ *
+ * Every data transmission, at the source and at every relay, is traced at
+ * the IP layer; the GPSR bytes it carries are its size without the UDP
+ * header and the payload. Reports the delivery ratio and the GPSR bytes
+ * per data transmission. With compression a flow sends a 1-byte type and a
+ * 6-byte flow header while its destination stays in one CompressionTolerance
+ * square, and a full position header only when it moves out of it.
+ *
+ *   ./waf --run "gpsr-compression-compare --compression=0"
+ *   ./waf --run "gpsr-compression-compare --compression=1"
+ *   ./waf --run "gpsr-compression-compare --compression=1 --tolerance=50"
+ */
+
+#include "ns3/gpsr-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/applications-module.h"
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+class CompressionCompareExample
+{
+public:
+  CompressionCompareExample ();
+  /// Configure script parameters, \return true on successful configuration
+  bool Configure (int argc, char **argv);
+  /// Run simulation
+  void Run ();
+  /// Report results
+  void Report (std::ostream & os);
+
+private:
+  ///\name parameters
+  //\{
+  /// Number of nodes
+  uint32_t size;
+  /// Number of CBR flows
+  uint32_t nSinks;
+  /// Simulation time, seconds
+  double totalTime;
+  /// Start of the flows, seconds
+  double flowStart;
+  /// Rate of every flow
+  std::string rate;
+  /// Payload of every packet, bytes
+  uint32_t packetSize;
+  /// Node speed range, m/s
+  double minSpeed;
+  double maxSpeed;
+  /// Send flow headers instead of repeated position headers
+  bool compression;
+  /// Grid square a destination may move in without a new context, meters
+  double tolerance;
+  //\}
+
+  ///\name statistics
+  //\{
+  uint32_t packetsSent;
+  uint32_t packetsReceived;
+  /// Data packets sent by sources and relays, and the GPSR bytes they carried
+  uint32_t dataTx;
+  uint64_t gpsrBytes;
+  //\}
+
+  ///\name network
+  //\{
+  NodeContainer nodes;
+  NetDeviceContainer devices;
+  Ipv4InterfaceContainer interfaces;
+  //\}
+
+private:
+  void CreateNodes ();
+  void CreateDevices ();
+  void InstallInternetStack ();
+  void InstallApplications ();
+  void SourceTx (Ptr<const Packet> packet);
+  void SinkRx (Ptr<const Packet> packet, const Address &from);
+  void DataTx (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+};
+
+int main (int argc, char **argv)
+{
+  CompressionCompareExample test;
+  if (! test.Configure (argc, argv))
+    NS_FATAL_ERROR ("Configuration failed. Aborted.");
+
+  test.Run ();
+  test.Report (std::cout);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+CompressionCompareExample::CompressionCompareExample () :
+  size (50),
+  nSinks (10),
+  totalTime (200),
+  flowStart (100),
+  rate ("2048bps"),
+  packetSize (64),
+  minSpeed (1),
+  maxSpeed (20),
+  compression (false),
+  tolerance (10),
+  packetsSent (0),
+  packetsReceived (0),
+  dataTx (0),
+  gpsrBytes (0)
+{
+}
+
+bool
+CompressionCompareExample::Configure (int argc, char **argv)
+{
+  SeedManager::SetSeed (12345);
+  CommandLine cmd;
+
+  cmd.AddValue ("size", "Number of nodes.", size);
+  cmd.AddValue ("sinks", "Number of CBR flows.", nSinks);
+  cmd.AddValue ("time", "Simulation time, s.", totalTime);
+  cmd.AddValue ("start", "Start of the flows, s.", flowStart);
+  cmd.AddValue ("rate", "Rate of every flow.", rate);
+  cmd.AddValue ("minSpeed", "Minimum node speed, m/s.", minSpeed);
+  cmd.AddValue ("maxSpeed", "Maximum node speed, m/s.", maxSpeed);
+  cmd.AddValue ("compression", "Compress the GPSR headers of unicast flows.", compression);
+  cmd.AddValue ("tolerance", "CompressionTolerance, m.", tolerance);
+
+  cmd.Parse (argc, argv);
+  return nSinks <= size && flowStart < totalTime && minSpeed <= maxSpeed && tolerance >= 1;
+}
+
+void
+CompressionCompareExample::Run ()
+{
+  CreateNodes ();
+  CreateDevices ();
+  InstallInternetStack ();
+  InstallApplications ();
+
+  GpsrHelper gpsr;
+  gpsr.Install ();
+
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::OnOffApplication/Tx",
+                                 MakeCallback (&CompressionCompareExample::SourceTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx",
+                                 MakeCallback (&CompressionCompareExample::SinkRx, this));
+  // sources send on a real interface once a next hop is known, relays forward
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::Ipv4L3Protocol/SendOutgoing",
+                                 MakeCallback (&CompressionCompareExample::DataTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::Ipv4L3Protocol/UnicastForward",
+                                 MakeCallback (&CompressionCompareExample::DataTx, this));
+
+  std::cout << "Starting simulation for " << totalTime << " s, compression " << compression << " ...\n";
+
+  Simulator::Stop (Seconds (totalTime));
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+CompressionCompareExample::Report (std::ostream & os)
+{
+  os << "Compression " << compression << " (tolerance " << tolerance << " m), speed " << minSpeed << "-" << maxSpeed
+     << " m/s, " << nSinks << " flows of " << rate << "\n"
+     << "Delivery ratio: " << (packetsSent ? (double) packetsReceived / packetsSent : 0)
+     << " (" << packetsReceived << " of " << packetsSent << ")\n"
+     << "Data transmissions: " << dataTx << "\n"
+     << "GPSR bytes per data transmission: " << (dataTx ? (double) gpsrBytes / dataTx : 0) << "\n";
+}
+
+void
+CompressionCompareExample::SourceTx (Ptr<const Packet> packet)
+{
+  packetsSent++;
+}
+
+void
+CompressionCompareExample::SinkRx (Ptr<const Packet> packet, const Address &from)
+{
+  packetsReceived++;
+}
+
+void
+CompressionCompareExample::DataTx (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  // loopback: queued until a next hop is found, counted when it is sent
+  if (interface == 0 || header.GetDestination ().IsBroadcast ()
+      || header.GetProtocol () != UdpL4Protocol::PROT_NUMBER || packet->GetSize () < 8 + packetSize)
+    {
+      return;
+    }
+  dataTx++;
+  gpsrBytes += packet->GetSize () - 8 - packetSize;
+}
+
+void
+CompressionCompareExample::CreateNodes ()
+{
+  std::cout << "Creating " << (unsigned)size << " nodes in 300x1500 m.\n";
+  nodes.Create (size);
+
+  ObjectFactory pos;
+  pos.SetTypeId ("ns3::RandomRectanglePositionAllocator");
+  pos.Set ("X", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=300.0]"));
+  pos.Set ("Y", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=1500.0]"));
+  Ptr<PositionAllocator> positionAlloc = pos.Create ()->GetObject<PositionAllocator> ();
+
+  std::ostringstream speed;
+  speed << "ns3::UniformRandomVariable[Min=" << minSpeed << "|Max=" << maxSpeed << "]";
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::RandomWaypointMobilityModel",
+                             "Speed", StringValue (speed.str ()),
+                             "Pause", StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"),
+                             "PositionAllocator", PointerValue (positionAlloc));
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.Install (nodes);
+}
+
+void
+CompressionCompareExample::CreateDevices ()
+{
+  NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+  wifiPhy.Set ("TxPowerStart", DoubleValue (7.5));
+  wifiPhy.Set ("TxPowerEnd", DoubleValue (7.5));
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("DsssRate11Mbps"), "ControlMode", StringValue ("DsssRate11Mbps"));
+  devices = wifi.Install (wifiPhy, wifiMac, nodes);
+}
+
+void
+CompressionCompareExample::InstallInternetStack ()
+{
+  GpsrHelper gpsr;
+  gpsr.Set ("HeaderCompression", BooleanValue (compression));
+  gpsr.Set ("CompressionTolerance", DoubleValue (tolerance));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (gpsr);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.0.0");
+  interfaces = address.Assign (devices);
+}
+
+void
+CompressionCompareExample::InstallApplications ()
+{
+  uint16_t port = 9;
+  Ptr<UniformRandomVariable> start = CreateObject<UniformRandomVariable> ();
+  // as in manet-routing-compare: node i sinks the flow of node i + nSinks
+  uint32_t shift = nSinks < size ? nSinks : size / 2;
+  for (uint32_t i = 0; i < nSinks; ++i)
+    {
+      PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      ApplicationContainer apps = sinkHelper.Install (nodes.Get (i));
+      apps.Start (Seconds (1.0));
+      apps.Stop (Seconds (totalTime));
+
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (interfaces.GetAddress (i), port));
+      onoff.SetConstantRate (DataRate (rate), packetSize);
+      apps = onoff.Install (nodes.Get ((i + shift) % size));
+      apps.Start (Seconds (start->GetValue (flowStart, flowStart + 1)));
+      apps.Stop (Seconds (totalTime));
+    }
+}
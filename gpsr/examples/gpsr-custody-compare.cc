@@ -0,0 +1,275 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Store-carry-forward on a sparse rural highway: 40 vehicles spread over a
+ * 10 km two-lane road, half of them driving east and half west at 20 to
+ * 30 m/s, 802.11b at 11 Mbit/s, and low-rate CBR flows between vehicles.
+ * The network is partitioned most of the time.
+ *
+ * Without custody (--buffer=0) a packet that neither greedy forwarding nor
+ * Recovery-mode can deliver is dropped. With a custody buffer the node
+ * carries it until a new neighbour appears: the packet is forwarded if the
+ * neighbour makes progress, or handed over if the neighbour drives towards
+ * the destination faster. Reports the delivery ratio for the buffer size:
+ *
+ *   ./waf --run "gpsr-custody-compare --buffer=0"
+ *   ./waf --run "gpsr-custody-compare --buffer=8"
+ *   ./waf --run "gpsr-custody-compare --buffer=64"
+ */
+
+#include "ns3/gpsr-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/applications-module.h"
+#include <iostream>
+
+using namespace ns3;
+
+class CustodyCompareExample
+{
+public:
+  CustodyCompareExample ();
+  /// Configure script parameters, \return true on successful configuration
+  bool Configure (int argc, char **argv);
+  /// Run simulation
+  void Run ();
+  /// Report results
+  void Report (std::ostream & os);
+
+private:
+  ///\name parameters
+  //\{
+  /// Number of vehicles
+  uint32_t size;
+  /// Length of the road, meters
+  double roadLength;
+  /// Vehicle speed range, m/s
+  double minSpeed;
+  double maxSpeed;
+  /// Number of CBR flows
+  uint32_t nFlows;
+  /// Rate of every flow
+  std::string rate;
+  /// Simulation time, seconds
+  double totalTime;
+  /// Packets carried per vehicle, 0 disables store-carry-forward
+  uint32_t buffer;
+  /// Time a packet is carried at most, seconds
+  double custodyTimeout;
+  /// Transmit power, dBm
+  double txp;
+  //\}
+
+  ///\name statistics
+  //\{
+  uint32_t packetsSent;
+  uint32_t packetsReceived;
+  uint32_t custodyTaken;
+  uint32_t custodyForwarded;
+  uint32_t custodyHandovers;
+  uint32_t custodyDrops;
+  //\}
+
+  ///\name network
+  //\{
+  NodeContainer nodes;
+  NetDeviceContainer devices;
+  Ipv4InterfaceContainer interfaces;
+  //\}
+
+private:
+  void CreateNodes ();
+  void CreateDevices ();
+  void InstallInternetStack ();
+  void InstallApplications ();
+  void SourceTx (Ptr<const Packet> packet);
+  void SinkRx (Ptr<const Packet> packet, const Address &from);
+};
+
+int main (int argc, char **argv)
+{
+  CustodyCompareExample test;
+  if (! test.Configure (argc, argv))
+    NS_FATAL_ERROR ("Configuration failed. Aborted.");
+
+  test.Run ();
+  test.Report (std::cout);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+CustodyCompareExample::CustodyCompareExample () :
+  size (40),
+  roadLength (10000),
+  minSpeed (20),
+  maxSpeed (30),
+  nFlows (5),
+  rate ("512bps"),
+  totalTime (300),
+  buffer (0),
+  custodyTimeout (60),
+  txp (7.5),
+  packetsSent (0),
+  packetsReceived (0),
+  custodyTaken (0),
+  custodyForwarded (0),
+  custodyHandovers (0),
+  custodyDrops (0)
+{
+}
+
+bool
+CustodyCompareExample::Configure (int argc, char **argv)
+{
+  SeedManager::SetSeed (12345);
+  CommandLine cmd;
+
+  cmd.AddValue ("size", "Number of vehicles.", size);
+  cmd.AddValue ("road", "Length of the road, m.", roadLength);
+  cmd.AddValue ("minSpeed", "Minimum vehicle speed, m/s.", minSpeed);
+  cmd.AddValue ("maxSpeed", "Maximum vehicle speed, m/s.", maxSpeed);
+  cmd.AddValue ("flows", "Number of CBR flows.", nFlows);
+  cmd.AddValue ("rate", "Rate of every flow.", rate);
+  cmd.AddValue ("time", "Simulation time, s.", totalTime);
+  cmd.AddValue ("buffer", "Packets carried per vehicle, 0 drops them.", buffer);
+  cmd.AddValue ("custodyTimeout", "Time a packet is carried at most, s.", custodyTimeout);
+  cmd.AddValue ("txp", "Transmit power, dBm.", txp);
+
+  cmd.Parse (argc, argv);
+  // the sources stop custodyTimeout before the end, so that carried packets can still arrive
+  return 2 * nFlows <= size && minSpeed <= maxSpeed && 10 + nFlows < totalTime - custodyTimeout;
+}
+
+void
+CustodyCompareExample::Run ()
+{
+  CreateNodes ();
+  CreateDevices ();
+  InstallInternetStack ();
+  InstallApplications ();
+
+  GpsrHelper gpsr;
+  gpsr.Install ();
+
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::OnOffApplication/Tx",
+                                 MakeCallback (&CustodyCompareExample::SourceTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx",
+                                 MakeCallback (&CustodyCompareExample::SinkRx, this));
+
+  std::cout << "Starting simulation for " << totalTime << " s, custody buffer " << buffer << " ...\n";
+
+  Simulator::Stop (Seconds (totalTime));
+  Simulator::Run ();
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      Ptr<gpsr::RoutingProtocol> routing = nodes.Get (i)->GetObject<gpsr::RoutingProtocol> ();
+      custodyTaken += routing->GetCustodyTaken ();
+      custodyForwarded += routing->GetCustodyForwarded ();
+      custodyHandovers += routing->GetCustodyHandovers ();
+      custodyDrops += routing->GetCustodyDrops ();
+    }
+  Simulator::Destroy ();
+}
+
+void
+CustodyCompareExample::Report (std::ostream & os)
+{
+  os << "Custody buffer " << buffer << ", timeout " << custodyTimeout << " s, "
+     << size << " vehicles on " << roadLength / 1000 << " km\n"
+     << "Delivery ratio: " << (packetsSent ? (double) packetsReceived / packetsSent : 0)
+     << " (" << packetsReceived << " of " << packetsSent << ")\n"
+     << "Packets carried: " << custodyTaken << ", forwarded: " << custodyForwarded
+     << ", handed over: " << custodyHandovers << ", dropped: " << custodyDrops << "\n";
+}
+
+void
+CustodyCompareExample::SourceTx (Ptr<const Packet> packet)
+{
+  packetsSent++;
+}
+
+void
+CustodyCompareExample::SinkRx (Ptr<const Packet> packet, const Address &from)
+{
+  packetsReceived++;
+}
+
+void
+CustodyCompareExample::CreateNodes ()
+{
+  std::cout << "Creating " << (unsigned)size << " vehicles on a " << roadLength << " m road.\n";
+  nodes.Create (size);
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantVelocityMobilityModel");
+  mobility.Install (nodes);
+
+  // even vehicles drive east on the lower lane, odd ones west on the upper lane;
+  // the road starts far enough from 0 that no vehicle reaches a negative x, which GPSR headers cannot carry
+  double start = maxSpeed * totalTime;
+  Ptr<UniformRandomVariable> x = CreateObject<UniformRandomVariable> ();
+  Ptr<UniformRandomVariable> speed = CreateObject<UniformRandomVariable> ();
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      Ptr<ConstantVelocityMobilityModel> mm = nodes.Get (i)->GetObject<ConstantVelocityMobilityModel> ();
+      double direction = i % 2 ? -1 : 1;
+      mm->SetPosition (Vector (start + x->GetValue (0, roadLength), i % 2 ? 5 : 0, 0));
+      mm->SetVelocity (Vector (direction * speed->GetValue (minSpeed, maxSpeed), 0, 0));
+    }
+}
+
+void
+CustodyCompareExample::CreateDevices ()
+{
+  NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+  wifiPhy.Set ("TxPowerStart", DoubleValue (txp));
+  wifiPhy.Set ("TxPowerEnd", DoubleValue (txp));
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("DsssRate11Mbps"), "ControlMode", StringValue ("DsssRate11Mbps"));
+  devices = wifi.Install (wifiPhy, wifiMac, nodes);
+}
+
+void
+CustodyCompareExample::InstallInternetStack ()
+{
+  GpsrHelper gpsr;
+  gpsr.Set ("CustodyBufferSize", UintegerValue (buffer));
+  gpsr.Set ("CustodyTimeout", TimeValue (Seconds (custodyTimeout)));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (gpsr);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.0.0");
+  interfaces = address.Assign (devices);
+}
+
+void
+CustodyCompareExample::InstallApplications ()
+{
+  uint16_t port = 9;
+  // vehicle i sends to vehicle i + size / 2, both placed at random on the road
+  for (uint32_t i = 0; i < nFlows; ++i)
+    {
+      uint32_t sink = i + size / 2;
+      PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      ApplicationContainer apps = sinkHelper.Install (nodes.Get (sink));
+      apps.Start (Seconds (1.0));
+      apps.Stop (Seconds (totalTime));
+
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (interfaces.GetAddress (sink), port));
+      onoff.SetConstantRate (DataRate (rate), 64);
+      apps = onoff.Install (nodes.Get (i));
+      apps.Start (Seconds (10.0 + i));
+      apps.Stop (Seconds (totalTime - custodyTimeout));
+    }
+}
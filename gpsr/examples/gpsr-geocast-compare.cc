@@ -0,0 +1,322 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Hazard warnings sent to a region: 100 static nodes in a 1000x1000 m area,
+ * 802.11b at 11 Mbit/s, and a few sources outside the 300x300 m region in
+ * the upper right corner sending one 64 byte warning per second to it.
+ *
+ * With GPSR geocast a warning is forwarded greedily to the region and
+ * rebroadcast inside it, the nodes that hear a close transmitter staying
+ * silent. With --flooding=1 every node rebroadcasts every warning once.
+ * With --anycast=1 a warning is for any one node of the region, e.g. the
+ * nearest roadside unit. Reports the delivery ratio to the region members
+ * and the data frames sent per warning:
+ *
+ *   ./waf --run "gpsr-geocast-compare --flooding=0"
+ *   ./waf --run "gpsr-geocast-compare --flooding=1"
+ *   ./waf --run "gpsr-geocast-compare --anycast=1"
+ */
+
+#include "ns3/gpsr-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/applications-module.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace ns3;
+
+class GeocastCompareExample
+{
+public:
+  GeocastCompareExample ();
+  /// Configure script parameters, \return true on successful configuration
+  bool Configure (int argc, char **argv);
+  /// Run simulation
+  void Run ();
+  /// Report results
+  void Report (std::ostream & os);
+
+private:
+  ///\name parameters
+  //\{
+  /// Number of nodes
+  uint32_t size;
+  /// Side of the area, meters
+  double side;
+  /// Side of the target region in the upper right corner, meters
+  double regionSide;
+  /// Number of warning sources, all outside the region
+  uint32_t nSources;
+  /// Rate of every source
+  std::string rate;
+  /// Simulation time, seconds
+  double totalTime;
+  /// Transmit power, dBm
+  double txp;
+  /// Flood the warnings instead of routing them to the region
+  bool flooding;
+  /// Deliver to one node of the region instead of all
+  bool anycast;
+  //\}
+
+  ///\name statistics
+  //\{
+  uint32_t members;
+  uint32_t packetsSent;
+  uint32_t packetsReceived;
+  /// HELLOs sent, all nodes
+  uint32_t hellos;
+  /// Frames handed to the MACs, HELLOs included
+  uint32_t macFrames;
+  /// Geocast rebroadcasts made and given up, all nodes
+  uint32_t rebroadcasts;
+  uint32_t suppressed;
+  //\}
+
+  ///\name network
+  //\{
+  NodeContainer nodes;
+  NetDeviceContainer devices;
+  Ipv4InterfaceContainer interfaces;
+  //\}
+
+private:
+  void CreateNodes ();
+  void CreateDevices ();
+  void InstallInternetStack ();
+  void InstallApplications ();
+  bool InRegion (Ptr<Node> node) const;
+  void SourceTx (Ptr<const Packet> packet);
+  void SinkRx (Ptr<const Packet> packet, const Address &from);
+  void HelloTx (Ptr<const Packet> packet);
+  void MacTx (Ptr<const Packet> packet);
+};
+
+int main (int argc, char **argv)
+{
+  GeocastCompareExample test;
+  if (! test.Configure (argc, argv))
+    NS_FATAL_ERROR ("Configuration failed. Aborted.");
+
+  test.Run ();
+  test.Report (std::cout);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+GeocastCompareExample::GeocastCompareExample () :
+  size (100),
+  side (1000),
+  regionSide (300),
+  nSources (3),
+  rate ("512bps"),
+  totalTime (100),
+  txp (7.5),
+  flooding (false),
+  anycast (false),
+  members (0),
+  packetsSent (0),
+  packetsReceived (0),
+  hellos (0),
+  macFrames (0),
+  rebroadcasts (0),
+  suppressed (0)
+{
+}
+
+bool
+GeocastCompareExample::Configure (int argc, char **argv)
+{
+  SeedManager::SetSeed (12345);
+  CommandLine cmd;
+
+  cmd.AddValue ("size", "Number of nodes.", size);
+  cmd.AddValue ("side", "Side of the area, m.", side);
+  cmd.AddValue ("region", "Side of the target region, m.", regionSide);
+  cmd.AddValue ("sources", "Number of warning sources.", nSources);
+  cmd.AddValue ("rate", "Rate of every source.", rate);
+  cmd.AddValue ("time", "Simulation time, s.", totalTime);
+  cmd.AddValue ("txp", "Transmit power, dBm.", txp);
+  cmd.AddValue ("flooding", "Flood the warnings through the whole network.", flooding);
+  cmd.AddValue ("anycast", "Deliver every warning to one node of the region.", anycast);
+
+  cmd.Parse (argc, argv);
+  return nSources < size && regionSide <= side && 10 < totalTime;
+}
+
+void
+GeocastCompareExample::Run ()
+{
+  CreateNodes ();
+  CreateDevices ();
+  InstallInternetStack ();
+  InstallApplications ();
+
+  GpsrHelper gpsr;
+  gpsr.Install ();
+
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::OnOffApplication/Tx",
+                                 MakeCallback (&GeocastCompareExample::SourceTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx",
+                                 MakeCallback (&GeocastCompareExample::SinkRx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::RoutingProtocol/HelloTx",
+                                 MakeCallback (&GeocastCompareExample::HelloTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
+                                 MakeCallback (&GeocastCompareExample::MacTx, this));
+
+  std::cout << "Starting simulation for " << totalTime << " s, flooding " << flooding << ", anycast " << anycast << " ...\n";
+
+  Simulator::Stop (Seconds (totalTime));
+  Simulator::Run ();
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      Ptr<gpsr::RoutingProtocol> routing = nodes.Get (i)->GetObject<gpsr::RoutingProtocol> ();
+      rebroadcasts += routing->GetGeocastRebroadcasts ();
+      suppressed += routing->GetGeocastSuppressed ();
+    }
+  Simulator::Destroy ();
+  gpsr::RoutingProtocol::ClearGeocastRegions ();
+}
+
+void
+GeocastCompareExample::Report (std::ostream & os)
+{
+  // an anycast warning is expected once, a geocast one at every member
+  uint32_t expected = anycast ? packetsSent : packetsSent * members;
+  uint32_t dataFrames = macFrames - hellos;
+  os << (flooding ? "Flooding" : "GPSR") << (anycast ? " anycast" : " geocast") << ", "
+     << members << " of " << size << " nodes in the region\n"
+     << "Delivery ratio: " << (expected ? (double) packetsReceived / expected : 0)
+     << " (" << packetsReceived << " of " << expected << ")\n"
+     << "Data frames per warning: " << (packetsSent ? (double) dataFrames / packetsSent : 0) << "\n"
+     << "Rebroadcasts: " << rebroadcasts << ", suppressed: " << suppressed << "\n";
+}
+
+bool
+GeocastCompareExample::InRegion (Ptr<Node> node) const
+{
+  Vector position = node->GetObject<MobilityModel> ()->GetPosition ();
+  return position.x >= side - regionSide && position.y >= side - regionSide;
+}
+
+void
+GeocastCompareExample::SourceTx (Ptr<const Packet> packet)
+{
+  packetsSent++;
+}
+
+void
+GeocastCompareExample::SinkRx (Ptr<const Packet> packet, const Address &from)
+{
+  packetsReceived++;
+}
+
+void
+GeocastCompareExample::HelloTx (Ptr<const Packet> packet)
+{
+  hellos++;
+}
+
+void
+GeocastCompareExample::MacTx (Ptr<const Packet> packet)
+{
+  macFrames++;
+}
+
+void
+GeocastCompareExample::CreateNodes ()
+{
+  std::cout << "Creating " << (unsigned)size << " nodes in " << side << "x" << side << " m.\n";
+  nodes.Create (size);
+
+  ObjectFactory pos;
+  pos.SetTypeId ("ns3::RandomRectanglePositionAllocator");
+  std::ostringstream range;
+  range << "ns3::UniformRandomVariable[Min=0.0|Max=" << side << "]";
+  pos.Set ("X", StringValue (range.str ()));
+  pos.Set ("Y", StringValue (range.str ()));
+  Ptr<PositionAllocator> positionAlloc = pos.Create ()->GetObject<PositionAllocator> ();
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.Install (nodes);
+
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      if (InRegion (nodes.Get (i)))
+        {
+          members++;
+        }
+    }
+}
+
+void
+GeocastCompareExample::CreateDevices ()
+{
+  NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+  wifiPhy.Set ("TxPowerStart", DoubleValue (txp));
+  wifiPhy.Set ("TxPowerEnd", DoubleValue (txp));
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("DsssRate11Mbps"), "ControlMode", StringValue ("DsssRate11Mbps"));
+  devices = wifi.Install (wifiPhy, wifiMac, nodes);
+}
+
+void
+GeocastCompareExample::InstallInternetStack ()
+{
+  GpsrHelper gpsr;
+  gpsr.Set ("GeocastFlooding", BooleanValue (flooding));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (gpsr);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.0.0");
+  interfaces = address.Assign (devices);
+}
+
+void
+GeocastCompareExample::InstallApplications ()
+{
+  std::vector<Vector> polygon;
+  polygon.push_back (Vector (side - regionSide, side - regionSide, 0));
+  polygon.push_back (Vector (side, side - regionSide, 0));
+  polygon.push_back (Vector (side, side, 0));
+  polygon.push_back (Vector (side - regionSide, side, 0));
+  Ipv4Address region = gpsr::RoutingProtocol::AddGeocastRegion (polygon, anycast ? gpsr::GPSR_ANYCAST : gpsr::GPSR_GEOCAST);
+
+  uint16_t port = 9;
+  PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+  ApplicationContainer apps = sinkHelper.Install (nodes);
+  apps.Start (Seconds (1.0));
+  apps.Stop (Seconds (totalTime));
+
+  // the first nodes outside the region are the sources
+  Ptr<UniformRandomVariable> start = CreateObject<UniformRandomVariable> ();
+  uint32_t sources = 0;
+  for (uint32_t i = 0; i < size && sources < nSources; ++i)
+    {
+      if (InRegion (nodes.Get (i)))
+        {
+          continue;
+        }
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (region, port));
+      onoff.SetConstantRate (DataRate (rate), 64);
+      apps = onoff.Install (nodes.Get (i));
+      apps.Start (Seconds (start->GetValue (10, 11)));
+      apps.Stop (Seconds (totalTime - 1));
+      sources++;
+    }
+}
@@ -0,0 +1,348 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Compares the location services GPSR can run on: the oracle GOD service,
+ * the Reactive Location Service (RLS) and the home region service (Home).
+ * Static grid, several CBR flows starting at the same time; reports the
+ * location overhead, the lookup latency, the delay of the first packet of
+ * every flow and the location queries GPSR answered from its destination
+ * cache (only with --piggyback, which sets PiggybackMaxAge).
+ *
+ * GOD is free and exact, the reference. RLS sends nothing until a lookup
+ * but floods it, so its cost grows with the distance to the target. Home
+ * pays a periodic update per node towards its home region and routes every
+ * lookup there with GPSR, no flooding; with --staticSinks the sinks are
+ * preloaded as static nodes and their lookups cost nothing.
+ *
+ *   ./waf --run "gpsr-ls-compare --ls=GOD"
+ *   ./waf --run "gpsr-ls-compare --ls=RLS"
+ *   ./waf --run "gpsr-ls-compare --ls=Home --staticSinks=1"
+ *   ./waf --run "gpsr-ls-compare --ls=RLS --piggyback=1"
+ */
+
+#include "ns3/gpsr-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/applications-module.h"
+#include <iostream>
+#include <map>
+
+using namespace ns3;
+
+class LsCompareExample
+{
+public:
+  LsCompareExample ();
+  /// Configure script parameters, \return true on successful configuration
+  bool Configure (int argc, char **argv);
+  /// Run simulation
+  void Run ();
+  /// Report results
+  void Report (std::ostream & os);
+
+private:
+  ///\name parameters
+  //\{
+  /// Number of nodes
+  uint32_t size;
+  /// Width of the Node Grid
+  uint32_t gridWidth;
+  /// Distance between nodes, meters
+  double step;
+  /// Simulation time, seconds
+  double totalTime;
+  /// Number of CBR flows
+  uint32_t nFlows;
+  /// Location service, GOD, RLS or Home
+  std::string ls;
+  /// Preload the sinks as static nodes of the home region service
+  bool staticSinks;
+  /// Cached fixes younger than this are used without a lookup, seconds, 0 off
+  double piggyback;
+  //\}
+
+  ///\name statistics
+  //\{
+  uint32_t requestPackets;
+  uint64_t requestBytes;
+  uint32_t replyPackets;
+  uint64_t replyBytes;
+  uint32_t updatePackets;
+  uint64_t updateBytes;
+  uint32_t lookups;
+  uint32_t lookupsFailed;
+  double lookupLatencySum;
+  uint32_t packetsReceived;
+  uint32_t queriesAvoided;
+  uint32_t piggybackedFixes;
+  /// Arrival time of the first packet of every flow, keyed by sink trace context
+  std::map<std::string, Time> firstRx;
+  Time flowStart;
+  //\}
+
+  ///\name network
+  //\{
+  NodeContainer nodes;
+  NetDeviceContainer devices;
+  Ipv4InterfaceContainer interfaces;
+  //\}
+
+private:
+  void CreateNodes ();
+  void CreateDevices ();
+  void InstallInternetStack ();
+  void InstallApplications ();
+  void ConnectLsTraces ();
+  void RequestTx (Ptr<const Packet> packet);
+  void ReplyTx (Ptr<const Packet> packet);
+  void UpdateTx (Ptr<const Packet> packet);
+  void Lookup (Ipv4Address target, Time latency);
+  void LookupFailed (Ipv4Address target);
+  void SinkRx (std::string context, Ptr<const Packet> packet, const Address &from);
+};
+
+int main (int argc, char **argv)
+{
+  LsCompareExample test;
+  if (! test.Configure (argc, argv))
+    NS_FATAL_ERROR ("Configuration failed. Aborted.");
+
+  test.Run ();
+  test.Report (std::cout);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+LsCompareExample::LsCompareExample () :
+  size (100),
+  gridWidth (10),
+  step (100),
+  totalTime (30),
+  nFlows (5),
+  ls ("RLS"),
+  staticSinks (false),
+  piggyback (0),
+  requestPackets (0),
+  requestBytes (0),
+  replyPackets (0),
+  replyBytes (0),
+  updatePackets (0),
+  updateBytes (0),
+  lookups (0),
+  lookupsFailed (0),
+  lookupLatencySum (0),
+  packetsReceived (0),
+  queriesAvoided (0),
+  piggybackedFixes (0),
+  flowStart (Seconds (5))
+{
+}
+
+bool
+LsCompareExample::Configure (int argc, char **argv)
+{
+  SeedManager::SetSeed (12345);
+  CommandLine cmd;
+
+  cmd.AddValue ("size", "Number of nodes.", size);
+  cmd.AddValue ("time", "Simulation time, s.", totalTime);
+  cmd.AddValue ("step", "Grid step, m", step);
+  cmd.AddValue ("flows", "Number of CBR flows.", nFlows);
+  cmd.AddValue ("ls", "Location service: GOD, RLS or Home.", ls);
+  cmd.AddValue ("staticSinks", "Preload the sinks as static nodes (Home only).", staticSinks);
+  cmd.AddValue ("piggyback", "PiggybackMaxAge, s (0 disables the source stamp).", piggyback);
+
+  cmd.Parse (argc, argv);
+  return (ls == "GOD" || ls == "RLS" || ls == "Home") && 2 * nFlows <= size;
+}
+
+void
+LsCompareExample::Run ()
+{
+  CreateNodes ();
+  CreateDevices ();
+  InstallInternetStack ();
+  InstallApplications ();
+
+  GpsrHelper gpsr;
+  gpsr.Install ();
+
+  // the location service objects are aggregated to its node when GPSR starts, at time 0
+  Simulator::Schedule (Seconds (0.5), &LsCompareExample::ConnectLsTraces, this);
+  Config::Connect ("/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx",
+                   MakeCallback (&LsCompareExample::SinkRx, this));
+
+  std::cout << "Starting simulation for " << totalTime << " s with " << ls << " ...\n";
+
+  Simulator::Stop (Seconds (totalTime));
+  Simulator::Run ();
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      Ptr<gpsr::RoutingProtocol> routing = nodes.Get (i)->GetObject<gpsr::RoutingProtocol> ();
+      queriesAvoided += routing->GetQueriesAvoided ();
+      piggybackedFixes += routing->GetPiggybackedFixes ();
+    }
+  Simulator::Destroy ();
+}
+
+void
+LsCompareExample::Report (std::ostream & os)
+{
+  double delaySum = 0;
+  for (std::map<std::string, Time>::const_iterator i = firstRx.begin (); i != firstRx.end (); ++i)
+    {
+      delaySum += (i->second - flowStart).GetSeconds ();
+    }
+  os << "Location service " << ls << ", " << nFlows << " flows\n"
+     << "Location updates sent: " << updatePackets << " (" << updateBytes << " bytes)\n"
+     << "Location requests sent: " << requestPackets << " (" << requestBytes << " bytes)\n"
+     << "Location replies sent: " << replyPackets << " (" << replyBytes << " bytes)\n"
+     << "Lookups resolved: " << lookups << ", failed: " << lookupsFailed << "\n"
+     << "Mean lookup latency: " << (lookups ? lookupLatencySum / lookups : 0) << " s\n"
+     << "Flows delivered: " << firstRx.size () << "\n"
+     << "Mean first-packet delay: " << (firstRx.empty () ? 0 : delaySum / firstRx.size ()) << " s\n"
+     << "Packets received: " << packetsReceived << "\n"
+     << "Location queries avoided: " << queriesAvoided
+     << " (" << piggybackedFixes << " piggybacked fixes received)\n";
+}
+
+void
+LsCompareExample::ConnectLsTraces ()
+{
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::RlsLocationService/RequestTx",
+                                 MakeCallback (&LsCompareExample::RequestTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::RlsLocationService/ReplyTx",
+                                 MakeCallback (&LsCompareExample::ReplyTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::RlsLocationService/Lookup",
+                                 MakeCallback (&LsCompareExample::Lookup, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::RlsLocationService/LookupFailed",
+                                 MakeCallback (&LsCompareExample::LookupFailed, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::HomeRegionLocationService/UpdateTx",
+                                 MakeCallback (&LsCompareExample::UpdateTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::HomeRegionLocationService/QueryTx",
+                                 MakeCallback (&LsCompareExample::RequestTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::HomeRegionLocationService/ReplyTx",
+                                 MakeCallback (&LsCompareExample::ReplyTx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::HomeRegionLocationService/Lookup",
+                                 MakeCallback (&LsCompareExample::Lookup, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::HomeRegionLocationService/LookupFailed",
+                                 MakeCallback (&LsCompareExample::LookupFailed, this));
+}
+
+void
+LsCompareExample::RequestTx (Ptr<const Packet> packet)
+{
+  requestPackets++;
+  requestBytes += packet->GetSize ();
+}
+
+void
+LsCompareExample::ReplyTx (Ptr<const Packet> packet)
+{
+  replyPackets++;
+  replyBytes += packet->GetSize ();
+}
+
+void
+LsCompareExample::UpdateTx (Ptr<const Packet> packet)
+{
+  updatePackets++;
+  updateBytes += packet->GetSize ();
+}
+
+void
+LsCompareExample::Lookup (Ipv4Address target, Time latency)
+{
+  lookups++;
+  lookupLatencySum += latency.GetSeconds ();
+}
+
+void
+LsCompareExample::LookupFailed (Ipv4Address target)
+{
+  lookupsFailed++;
+}
+
+void
+LsCompareExample::SinkRx (std::string context, Ptr<const Packet> packet, const Address &from)
+{
+  packetsReceived++;
+  if (firstRx.find (context) == firstRx.end ())
+    {
+      firstRx[context] = Simulator::Now ();
+    }
+}
+
+void
+LsCompareExample::CreateNodes ()
+{
+  std::cout << "Creating " << (unsigned)size << " nodes " << step << " m apart.\n";
+  nodes.Create (size);
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                 "MinX", DoubleValue (0.0),
+                                 "MinY", DoubleValue (0.0),
+                                 "DeltaX", DoubleValue (step),
+                                 "DeltaY", DoubleValue (step),
+                                 "GridWidth", UintegerValue (gridWidth),
+                                 "LayoutType", StringValue ("RowFirst"));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+}
+
+void
+LsCompareExample::CreateDevices ()
+{
+  NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
+  YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
+  wifiPhy.SetChannel (wifiChannel.Create ());
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("OfdmRate6Mbps"), "RtsCtsThreshold", UintegerValue (0));
+  devices = wifi.Install (wifiPhy, wifiMac, nodes);
+}
+
+void
+LsCompareExample::InstallInternetStack ()
+{
+  Config::SetDefault ("ns3::gpsr::HomeRegionLocationService::WorldSize", DoubleValue (gridWidth * step));
+  GpsrHelper gpsr;
+  gpsr.Set ("LocationServiceName", StringValue (ls));
+  gpsr.Set ("PiggybackMaxAge", TimeValue (Seconds (piggyback)));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (gpsr);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.0.0");
+  interfaces = address.Assign (devices);
+}
+
+void
+LsCompareExample::InstallApplications ()
+{
+  uint16_t port = 9;
+  // flow i goes from node i to node size-1-i, all flows start together
+  for (uint32_t i = 0; i < nFlows; ++i)
+    {
+      uint32_t sink = size - 1 - i;
+      if (staticSinks)
+        {
+          gpsr::HomeRegionLocationService::AddStaticNode (interfaces.GetAddress (sink),
+                                                          nodes.Get (sink)->GetObject<MobilityModel> ()->GetPosition ());
+        }
+      PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      ApplicationContainer apps = sinkHelper.Install (nodes.Get (sink));
+      apps.Start (Seconds (1.0));
+      apps.Stop (Seconds (totalTime - 0.1));
+
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (interfaces.GetAddress (sink), port));
+      onoff.SetConstantRate (DataRate ("8kbps"), 512);
+      apps = onoff.Install (nodes.Get (i));
+      apps.Start (flowStart);
+      apps.Stop (Seconds (totalTime - 0.1));
+    }
+}
@@ -0,0 +1,300 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Compares the greedy next-hop strategies of GPSR on one static random
+ * topology: 802.11b, Friis loss, CBR flows between node pairs, the same
+ * node positions and flows for every strategy.
+ *
+ * For each strategy it reports
+ *  - the decision cost: wall-clock time of one SelectNeighbor() call on a
+ *    table of --neighbors entries, averaged over --decisions calls;
+ *  - the path quality: delivery ratio, mean IP hops of the delivered
+ *    packets and the number of Recovery-mode entries.
+ *
+ *   ./waf --run "gpsr-strategy-compare --strategies=LinkDuration,Greedy,MFR,NFP,Compass,Airtime"
+ */
+
+#include "ns3/gpsr-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/applications-module.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <ctime>
+
+using namespace ns3;
+
+class StrategyCompare
+{
+public:
+  StrategyCompare ();
+  /// Configure script parameters, \return true on successful configuration
+  bool Configure (int argc, char **argv);
+  /// Run one simulation per strategy and report each
+  void Run (std::ostream & os);
+
+private:
+  ///\name parameters
+  //\{
+  /// Strategies to compare, comma separated
+  std::string strategies;
+  /// Number of nodes
+  uint32_t size;
+  /// Side of the square area, meters
+  double side;
+  /// Number of CBR flows
+  uint32_t nSinks;
+  /// Simulation time, seconds
+  double totalTime;
+  /// Rate of every flow
+  std::string rate;
+  /// Transmit power, dBm
+  double txp;
+  /// Neighbour table size of the decision cost benchmark
+  uint32_t neighbors;
+  /// Decisions timed per strategy
+  uint32_t decisions;
+  //\}
+
+  ///\name statistics of the current run
+  //\{
+  uint32_t packetsSent;
+  uint32_t packetsReceived;
+  uint64_t hops;
+  //\}
+
+  void RunStrategy (std::string name, std::ostream & os);
+  /// Wall-clock time of one greedy decision of strategy on a table of neighbours of node 0, nanoseconds
+  double DecisionCost (uint32_t strategy, NodeContainer &nodes, Ipv4InterfaceContainer &interfaces);
+  template <class Strategy>
+  double TimeDecisions (gpsr::PositionTable &table, const std::vector<Vector> &targets, Vector nodePos);
+  void Tx (Ptr<const Packet> packet);
+  void LocalDeliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+};
+
+int main (int argc, char **argv)
+{
+  StrategyCompare test;
+  if (! test.Configure (argc, argv))
+    NS_FATAL_ERROR ("Configuration failed. Aborted.");
+
+  test.Run (std::cout);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+StrategyCompare::StrategyCompare () :
+  strategies ("LinkDuration,Greedy,MFR,NFP,Compass,Airtime"),
+  size (100),
+  side (1000),
+  nSinks (10),
+  totalTime (60),
+  rate ("4096bps"),
+  txp (7.5),
+  neighbors (30),
+  decisions (1000000),
+  packetsSent (0),
+  packetsReceived (0),
+  hops (0)
+{
+}
+
+bool
+StrategyCompare::Configure (int argc, char **argv)
+{
+  SeedManager::SetSeed (12345);
+  CommandLine cmd;
+
+  cmd.AddValue ("strategies", "Strategies to compare, comma separated.", strategies);
+  cmd.AddValue ("size", "Number of nodes.", size);
+  cmd.AddValue ("side", "Side of the square area, m.", side);
+  cmd.AddValue ("sinks", "Number of CBR flows.", nSinks);
+  cmd.AddValue ("time", "Simulation time, s.", totalTime);
+  cmd.AddValue ("rate", "Rate of every flow.", rate);
+  cmd.AddValue ("txp", "Transmit power, dBm.", txp);
+  cmd.AddValue ("neighbors", "Neighbour table size of the decision cost benchmark.", neighbors);
+  cmd.AddValue ("decisions", "Decisions timed per strategy.", decisions);
+
+  cmd.Parse (argc, argv);
+  return 2 * nSinks <= size && neighbors < size && totalTime > 10;
+}
+
+void
+StrategyCompare::Run (std::ostream & os)
+{
+  os << "Strategy,DecisionCost(ns),Sent,Received,DeliveryRatio,MeanHops,RecoveryEntries\n";
+  std::istringstream list (strategies);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      RunStrategy (item, os);
+    }
+}
+
+void
+StrategyCompare::Tx (Ptr<const Packet> packet)
+{
+  packetsSent++;
+}
+
+void
+StrategyCompare::LocalDeliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  if (header.GetDestination ().IsBroadcast () || header.GetDestination ().IsSubnetDirectedBroadcast (Ipv4Mask ("255.255.0.0")))
+    {
+      return;
+    }
+  packetsReceived++;
+  // sent with TTL 64, decremented by every forwarder
+  hops += 65 - header.GetTtl ();
+}
+
+template <class Strategy>
+double
+StrategyCompare::TimeDecisions (gpsr::PositionTable &table, const std::vector<Vector> &targets, Vector nodePos)
+{
+  uint32_t found = 0;
+  std::clock_t begin = std::clock ();
+  for (uint32_t i = 0; i < decisions; ++i)
+    {
+      if (table.SelectNeighbor<Strategy> (targets[i % targets.size ()], nodePos, Vector ()) != Ipv4Address::GetZero ())
+        {
+          found++;
+        }
+    }
+  double seconds = (double) (std::clock () - begin) / CLOCKS_PER_SEC;
+  NS_ASSERT (found > 0);
+  return seconds / decisions * 1e9;
+}
+
+double
+StrategyCompare::DecisionCost (uint32_t strategy, NodeContainer &nodes, Ipv4InterfaceContainer &interfaces)
+{
+  Vector nodePos = nodes.Get (0)->GetObject<MobilityModel> ()->GetPosition ();
+  // real nodes, so that the oracle resolves their velocities
+  gpsr::PositionTable table;
+  for (uint32_t i = 1; i <= neighbors; ++i)
+    {
+      table.AddEntry (interfaces.GetAddress (i), nodes.Get (i)->GetObject<MobilityModel> ()->GetPosition ());
+    }
+  Ptr<UniformRandomVariable> coordinate = CreateObject<UniformRandomVariable> ();
+  coordinate->SetStream (3);
+  std::vector<Vector> targets;
+  for (uint32_t i = 0; i < 1000; ++i)
+    {
+      targets.push_back (Vector (coordinate->GetValue (0, side), coordinate->GetValue (0, side), 0));
+    }
+
+  switch (strategy)
+    {
+    case gpsr::GPSR_STRATEGY_GREEDY:
+      return TimeDecisions<gpsr::GreedyStrategy> (table, targets, nodePos);
+    case gpsr::GPSR_STRATEGY_MFR:
+      return TimeDecisions<gpsr::MfrStrategy> (table, targets, nodePos);
+    case gpsr::GPSR_STRATEGY_NFP:
+      return TimeDecisions<gpsr::NfpStrategy> (table, targets, nodePos);
+    case gpsr::GPSR_STRATEGY_COMPASS:
+      return TimeDecisions<gpsr::CompassStrategy> (table, targets, nodePos);
+    case gpsr::GPSR_STRATEGY_AIRTIME:
+      // without an airtime callback every neighbour costs one unit: the scan itself is timed
+      return TimeDecisions<gpsr::AirtimeStrategy> (table, targets, nodePos);
+    default:
+      return TimeDecisions<gpsr::LinkDurationStrategy> (table, targets, nodePos);
+    }
+}
+
+void
+StrategyCompare::RunStrategy (std::string name, std::ostream & os)
+{
+  packetsSent = 0;
+  packetsReceived = 0;
+  hops = 0;
+
+  NodeContainer nodes;
+  nodes.Create (size);
+
+  // the same positions for every strategy
+  Ptr<UniformRandomVariable> coordinate = CreateObject<UniformRandomVariable> ();
+  coordinate->SetStream (1);
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      positionAlloc->Add (Vector (coordinate->GetValue (0, side), coordinate->GetValue (0, side), 0));
+    }
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+
+  NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+  wifiPhy.Set ("TxPowerStart", DoubleValue (txp));
+  wifiPhy.Set ("TxPowerEnd", DoubleValue (txp));
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("DsssRate11Mbps"), "ControlMode", StringValue ("DsssRate11Mbps"));
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, nodes);
+  wifi.AssignStreams (devices, 100);
+
+  GpsrHelper gpsr;
+  gpsr.Set ("ForwardingStrategy", StringValue (name));
+  gpsr.Set ("LocationServiceName", StringValue ("Oracle"));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (gpsr);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.0.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+  uint16_t port = 9;
+  Ptr<UniformRandomVariable> start = CreateObject<UniformRandomVariable> ();
+  start->SetStream (2);
+  for (uint32_t i = 0; i < nSinks; ++i)
+    {
+      PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      ApplicationContainer apps = sinkHelper.Install (nodes.Get (i));
+      apps.Start (Seconds (1.0));
+      apps.Stop (Seconds (totalTime));
+
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (interfaces.GetAddress (i), port));
+      onoff.SetConstantRate (DataRate (rate), 64);
+      apps = onoff.Install (nodes.Get (size - 1 - i));
+      apps.Start (Seconds (start->GetValue (10, 11)));
+      apps.Stop (Seconds (totalTime));
+    }
+
+  gpsr.Install ();
+
+  Ptr<gpsr::RoutingProtocol> routing = nodes.Get (0)->GetObject<gpsr::RoutingProtocol> ();
+  EnumValue strategy;
+  routing->GetAttribute ("ForwardingStrategy", strategy);
+  double cost = DecisionCost (strategy.Get (), nodes, interfaces);
+
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::OnOffApplication/Tx",
+                                 MakeCallback (&StrategyCompare::Tx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::Ipv4L3Protocol/LocalDeliver",
+                                 MakeCallback (&StrategyCompare::LocalDeliver, this));
+
+  Simulator::Stop (Seconds (totalTime));
+  Simulator::Run ();
+  uint32_t recoveryEntries = 0;
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      recoveryEntries += nodes.Get (i)->GetObject<gpsr::RoutingProtocol> ()->GetPerimeterEntries ();
+    }
+  Simulator::Destroy ();
+
+  os << name << "," << cost << "," << packetsSent << "," << packetsReceived << ","
+     << (packetsSent ? (double) packetsReceived / packetsSent : 0) << ","
+     << (packetsReceived ? (double) hops / packetsReceived : 0) << ","
+     << recoveryEntries << "\n";
+}
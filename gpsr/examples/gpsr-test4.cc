@@ -19,6 +19,8 @@
 #include "ns3/udp-echo-helper.h"
 #include <iostream>
 #include <cmath>
+#include <map>
+#include <set>
 
 using namespace ns3;
 
@@ -46,6 +48,40 @@ private:
   double totalTime;
   /// Write per-device PCAP traces if true
   bool pcap;
+  /// Use the density-aware, slotted HELLO scheduler
+  bool densityHello;
+  /// Add a second, high rate radio on its own channel
+  bool dualRadio;
+  /// Interval between echo packets, seconds
+  double interval;
+  /// Echo flows across the grid rows, besides the two diagonal ones
+  uint32_t rowFlows;
+  /// Near-equal greedy candidates the flows are hashed over, 1 disables
+  uint32_t multipath;
+  /// Idle gap that starts a new flowlet, seconds; 0 hashes whole flows
+  double flowletGap;
+  //\}
+
+  /// Unicast bytes delivered to applications, both radios
+  uint64_t rxBytes;
+  /// Greedy choices hashed away from the best candidate, all nodes
+  uint32_t spreads;
+
+  ///\name HELLO statistics
+  //\{
+  struct HelloLink
+  {
+    uint16_t firstSeqNo;
+    uint16_t lastSeqNo;
+    uint32_t received;
+  };
+  /// Per (sender, receiver) HELLO reception
+  std::map<std::pair<Ipv4Address, Ipv4Address>, HelloLink> helloLinks;
+  /// Every neighbour a node has heard at least once
+  std::map<Ipv4Address, std::set<Ipv4Address> > heard;
+  /// Sum and number of neighbour-table completeness samples
+  double completenessSum;
+  uint32_t completenessSamples;
   //\}
 
   ///\name network
@@ -53,6 +89,9 @@ private:
   NodeContainer nodes;
   NetDeviceContainer devices;
   Ipv4InterfaceContainer interfaces;
+  /// High rate radio, dualRadio only
+  NetDeviceContainer devices2;
+  Ipv4InterfaceContainer interfaces2;
   //\}
 
 private:
@@ -60,6 +99,9 @@ private:
   void CreateDevices ();
   void InstallInternetStack ();
   void InstallApplications ();
+  void HelloRx (Ipv4Address sender, Ipv4Address receiver, uint16_t seqNo);
+  void SampleNeighbors ();
+  void LocalDeliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
 };
 
 int main (int argc, char **argv)
@@ -84,7 +126,17 @@ GpsrExample::GpsrExample () :
   // Simulation time
   totalTime (30),
   // Generate capture files for each node
-  pcap (false)
+  pcap (false),
+  densityHello (false),
+  dualRadio (false),
+  interval (1),
+  rowFlows (0),
+  multipath (1),
+  flowletGap (0),
+  rxBytes (0),
+  spreads (0),
+  completenessSum (0),
+  completenessSamples (0)
 {
 }
 
@@ -101,9 +153,15 @@ GpsrExample::Configure (int argc, char **argv)
   cmd.AddValue ("size", "Number of nodes.", size);
   cmd.AddValue ("time", "Simulation time, s.", totalTime);
   cmd.AddValue ("step", "Grid step, m", step);
+  cmd.AddValue ("densityHello", "Use density-aware slotted HELLOs.", densityHello);
+  cmd.AddValue ("dualRadio", "Add a 54 Mbps radio on a second channel next to the 6 Mbps one.", dualRadio);
+  cmd.AddValue ("interval", "Interval between echo packets, s.", interval);
+  cmd.AddValue ("rowFlows", "Echo flows across the grid rows, besides the two diagonal ones.", rowFlows);
+  cmd.AddValue ("multipath", "Near-equal greedy candidates the flows are hashed over, 1 disables.", multipath);
+  cmd.AddValue ("flowletGap", "Idle gap that starts a new flowlet, s; 0 hashes whole flows.", flowletGap);
 
   cmd.Parse (argc, argv);
-  return true;
+  return rowFlows <= size / gridWidth - 2;
 }
 
 void
@@ -119,16 +177,99 @@ GpsrExample::Run ()
   gpsr.Set ("LocationServiceName", StringValue ("GOD"));
   gpsr.Install ();
 
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::RoutingProtocol/HelloRx",
+                                 MakeCallback (&GpsrExample::HelloRx, this));
+  Config::ConnectWithoutContext ("/NodeList/*/$ns3::Ipv4L3Protocol/LocalDeliver",
+                                 MakeCallback (&GpsrExample::LocalDeliver, this));
+  // leave the first HELLO rounds out of the completeness statistics
+  Simulator::Schedule (Seconds (5), &GpsrExample::SampleNeighbors, this);
+
   std::cout << "Starting simulation for " << totalTime << " s ...\n";
 
   Simulator::Stop (Seconds (totalTime));
   Simulator::Run ();
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      spreads += nodes.Get (i)->GetObject<gpsr::RoutingProtocol> ()->GetMultipathSpreads ();
+    }
   Simulator::Destroy ();
 }
 
 void
-GpsrExample::Report (std::ostream &)
+GpsrExample::Report (std::ostream & os)
+{
+  uint64_t expected = 0;
+  uint64_t received = 0;
+  for (std::map<std::pair<Ipv4Address, Ipv4Address>, HelloLink>::const_iterator i = helloLinks.begin ();
+       i != helloLinks.end (); ++i)
+    {
+      expected += (uint16_t)(i->second.lastSeqNo - i->second.firstSeqNo) + 1;
+      received += i->second.received;
+    }
+  double heardTotal = 0;
+  for (std::map<Ipv4Address, std::set<Ipv4Address> >::const_iterator i = heard.begin (); i != heard.end (); ++i)
+    {
+      heardTotal += i->second.size ();
+    }
+
+  os << "Grid step " << step << " m, density-aware HELLO " << densityHello << ", dual radio " << dualRadio << "\n"
+     << "Flows " << 2 + rowFlows << ", multipath candidates " << multipath << ", flowlet gap " << flowletGap << " s\n"
+     << "Greedy choices spread: " << spreads << "\n"
+     << "Aggregate throughput: " << rxBytes * 8 / (totalTime - 2) / 1000 << " kbit/s\n"
+     << "Neighbours heard per node: " << (heard.empty () ? 0 : heardTotal / heard.size ()) << "\n"
+     << "HELLO loss rate: " << (expected ? 1 - (double) received / expected : 0) << "\n"
+     << "Neighbour table completeness: " << (completenessSamples ? completenessSum / completenessSamples : 0) << "\n";
+}
+
+void
+GpsrExample::HelloRx (Ipv4Address sender, Ipv4Address receiver, uint16_t seqNo)
 {
+  std::pair<Ipv4Address, Ipv4Address> link (sender, receiver);
+  std::map<std::pair<Ipv4Address, Ipv4Address>, HelloLink>::iterator i = helloLinks.find (link);
+  if (i == helloLinks.end ())
+    {
+      HelloLink l;
+      l.firstSeqNo = seqNo;
+      l.lastSeqNo = seqNo;
+      l.received = 1;
+      helloLinks.insert (std::make_pair (link, l));
+    }
+  else
+    {
+      i->second.lastSeqNo = seqNo;
+      i->second.received++;
+    }
+  heard[receiver].insert (sender);
+}
+
+void
+GpsrExample::LocalDeliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  // HELLOs are the only broadcasts; everything unicast is echo traffic
+  if (header.GetDestination ().IsBroadcast () || header.GetDestination ().IsSubnetDirectedBroadcast (Ipv4Mask ("255.255.0.0")))
+    {
+      return;
+    }
+  rxBytes += packet->GetSize ();
+}
+
+void
+GpsrExample::SampleNeighbors ()
+{
+  // completeness: neighbours currently in the table over neighbours ever heard
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      std::set<Ipv4Address> &known = heard[interfaces.GetAddress (i)];
+      if (known.empty ())
+        {
+          continue;
+        }
+      Ptr<gpsr::RoutingProtocol> gpsr = nodes.Get (i)->GetObject<gpsr::RoutingProtocol> ();
+      // heard[] is keyed by the address of the first radio
+      completenessSum += std::min (1.0, (double) gpsr->GetNeighborCount (1) / known.size ());
+      completenessSamples++;
+    }
+  Simulator::Schedule (Seconds (1), &GpsrExample::SampleNeighbors, this);
 }
 
 void
@@ -168,6 +309,17 @@ GpsrExample::CreateDevices ()
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("OfdmRate6Mbps"), "RtsCtsThreshold", UintegerValue (0));
   devices = wifi.Install (wifiPhy, wifiMac, nodes);
 
+  if (dualRadio)
+    {
+      // shorter range at 54 Mbps: the default error model needs a much higher SNR
+      YansWifiChannelHelper highRateChannel = YansWifiChannelHelper::Default ();
+      YansWifiPhyHelper highRatePhy = YansWifiPhyHelper::Default ();
+      highRatePhy.SetChannel (highRateChannel.Create ());
+      WifiHelper highRate = WifiHelper::Default ();
+      highRate.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("OfdmRate54Mbps"), "RtsCtsThreshold", UintegerValue (0));
+      devices2 = highRate.Install (highRatePhy, wifiMac, nodes);
+    }
+
   if (pcap)
     {
       wifiPhy.EnablePcapAll (std::string ("gpsr"));
@@ -179,12 +331,27 @@ GpsrExample::InstallInternetStack ()
 {
   GpsrHelper gpsr;
   // you can configure GPSR attributes here using gpsr.Set(name, value)
+  gpsr.Set ("DensityAwareHello", BooleanValue (densityHello));
+  gpsr.Set ("MultipathCandidates", UintegerValue (multipath));
+  gpsr.Set ("FlowletGap", TimeValue (Seconds (flowletGap)));
   InternetStackHelper stack;
   stack.SetRoutingHelper (gpsr);
   stack.Install (nodes);
   Ipv4AddressHelper address;
   address.SetBase ("10.0.0.0", "255.255.0.0");
   interfaces = address.Assign (devices);
+  if (dualRadio)
+    {
+      address.SetBase ("10.1.0.0", "255.255.0.0");
+      interfaces2 = address.Assign (devices2);
+      // of two equally good next hops, GPSR takes the one on the lower metric: prefer the high rate radio
+      for (uint32_t i = 0; i < size; ++i)
+        {
+          Ptr<Ipv4> ipv4 = nodes.Get (i)->GetObject<Ipv4> ();
+          ipv4->SetMetric (1, 10);
+          ipv4->SetMetric (2, 1);
+        }
+    }
 }
 
 void
@@ -193,8 +360,8 @@ GpsrExample::InstallApplications ()
 
   uint16_t port = 9;  // well-known echo port number
   uint32_t packetSize = 1024; // size of the packets being transmitted
-  uint32_t maxPacketCount = 100; // number of packets to transmit
-  Time interPacketInterval = Seconds (1.); // interval between packet transmissions
+  uint32_t maxPacketCount = std::max (100u, (uint32_t) (totalTime / interval)); // number of packets to transmit
+  Time interPacketInterval = Seconds (interval); // interval between packet transmissions
 
   // Set-up  a server Application on the bottom-right node of the grid
   UdpEchoServerHelper server1 (port);
@@ -230,4 +397,22 @@ GpsrExample::InstallApplications ()
   apps.Start (Seconds (2.0));
   apps.Stop (Seconds (totalTime-0.1));
 
+  // parallel flows from the left to the right edge of the inner rows, each on its own port
+  for (uint32_t j = 0; j < rowFlows; ++j)
+    {
+      uint32_t row = 1 + j;
+      UdpEchoServerHelper server (port + 1 + j);
+      apps = server.Install (nodes.Get (row * gridWidth + gridWidth - 1));
+      apps.Start (Seconds (1.0));
+      apps.Stop (Seconds (totalTime-0.1));
+
+      UdpEchoClientHelper client (interfaces.GetAddress (row * gridWidth + gridWidth - 1), port + 1 + j);
+      client.SetAttribute ("MaxPackets", UintegerValue (maxPacketCount));
+      client.SetAttribute ("Interval", TimeValue (interPacketInterval));
+      client.SetAttribute ("PacketSize", UintegerValue (packetSize));
+      apps = client.Install (nodes.Get (row * gridWidth));
+      apps.Start (Seconds (2.0));
+      apps.Stop (Seconds (totalTime-0.1));
+    }
+
 }
@@ -61,6 +61,8 @@ private:
   double totalTime;
   /// Write per-device PCAP traces if true
   bool pcap;
+  /// GreedyFailureCell, meters, 0 disables the greedy failure memory
+  double greedyCell;
   //\}
 
   ///\name network
@@ -70,6 +72,16 @@ private:
   Ipv4InterfaceContainer interfaces;
   //\}
 
+  ///\name statistics
+  //\{
+  /// Greedy selections answered from the greedy failure memory, all nodes
+  uint32_t greedyScansSaved;
+  /// Greedy selections that scanned the neighbour table
+  uint32_t greedyScans;
+  /// Neighbour entries those selections did not scan
+  uint64_t neighborsNotScanned;
+  //\}
+
 private:
   void CreateNodes ();
   void CreateDevices ();
@@ -99,7 +111,11 @@ GpsrExample::GpsrExample () :
   // Simulation time
   totalTime (30),
   // Generate capture files for each node
-  pcap (true)
+  pcap (true),
+  greedyCell (50),
+  greedyScansSaved (0),
+  greedyScans (0),
+  neighborsNotScanned (0)
 {
 }
 
@@ -116,6 +132,7 @@ GpsrExample::Configure (int argc, char **argv)
   cmd.AddValue ("size", "Number of nodes.", size);
   cmd.AddValue ("time", "Simulation time, s.", totalTime);
   cmd.AddValue ("step", "Grid step, m", step);
+  cmd.AddValue ("greedyCell", "GreedyFailureCell, m (0 disables the greedy failure memory).", greedyCell);
 
   cmd.Parse (argc, argv);
   return true;
@@ -137,12 +154,21 @@ GpsrExample::Run ()
 
   Simulator::Stop (Seconds (totalTime));
   Simulator::Run ();
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      Ptr<gpsr::RoutingProtocol> routing = nodes.Get (i)->GetObject<gpsr::RoutingProtocol> ();
+      greedyScansSaved += routing->GetGreedyScansSaved ();
+      greedyScans += routing->GetGreedyScans ();
+      neighborsNotScanned += routing->GetNeighborsNotScanned ();
+    }
   Simulator::Destroy ();
 }
 
 void
-GpsrExample::Report (std::ostream &)
+GpsrExample::Report (std::ostream & os)
 {
+  os << "Greedy scans saved: " << greedyScansSaved << " of " << greedyScansSaved + greedyScans << " selections"
+     << " (" << neighborsNotScanned << " neighbour entries not scanned)\n";
 }
 
 void
@@ -197,6 +223,7 @@ GpsrExample::InstallInternetStack ()
 {
   GpsrHelper gpsr;
   // you can configure GPSR attributes here using gpsr.Set(name, value)
+  gpsr.Set ("GreedyFailureCell", DoubleValue (greedyCell));
   InternetStackHelper stack;
   stack.SetRoutingHelper (gpsr);
   stack.Install (nodes);
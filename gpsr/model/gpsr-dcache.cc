@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "gpsr-dcache.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("GpsrDestinationCache");
+
+namespace ns3 {
+namespace gpsr {
+
+DestinationCache::DestinationCache ()
+  : m_lifeTime (Seconds (10))
+{
+}
+
+void
+DestinationCache::Update (Ipv4Address id, Vector position, Vector velocity, Time updated)
+{
+  std::map<Ipv4Address, Entry>::iterator i = m_table.find (id);
+  if (i != m_table.end () && i->second.updated >= updated)
+    {
+      return;
+    }
+  Entry entry;
+  entry.position = position;
+  entry.velocity = velocity;
+  entry.updated = updated;
+  m_table[id] = entry;
+}
+
+void
+DestinationCache::Update (Ipv4Address id, Vector position, Time updated)
+{
+  Vector velocity (0, 0, 0);
+  std::map<Ipv4Address, Entry>::const_iterator i = m_table.find (id);
+  if (i != m_table.end ())
+    {
+      if (i->second.updated >= updated)
+        {
+          return;
+        }
+      double dt = (updated - i->second.updated).GetSeconds ();
+      velocity = Vector ((position.x - i->second.position.x) / dt,
+                         (position.y - i->second.position.y) / dt, 0);
+    }
+  Update (id, position, velocity, updated);
+}
+
+bool
+DestinationCache::Lookup (Ipv4Address id, Vector &position, Vector &velocity, Time &updated)
+{
+  std::map<Ipv4Address, Entry>::const_iterator i = m_table.find (id);
+  if (i == m_table.end () || i->second.updated + m_lifeTime <= Simulator::Now ())
+    {
+      return false;
+    }
+  position = i->second.position;
+  velocity = i->second.velocity;
+  updated = i->second.updated;
+  return true;
+}
+
+Vector
+DestinationCache::Extrapolate (Vector position, Vector velocity, Time updated, Time maxAge)
+{
+  double age = std::min ((Simulator::Now () - updated).GetSeconds (), maxAge.GetSeconds ());
+  if (age <= 0)
+    {
+      return position;
+    }
+  return Vector (position.x + velocity.x * age, position.y + velocity.y * age, position.z);
+}
+
+void
+DestinationCache::Purge ()
+{
+  Time now = Simulator::Now ();
+  for (std::map<Ipv4Address, Entry>::iterator i = m_table.begin (); i != m_table.end (); )
+    {
+      if (i->second.updated + m_lifeTime <= now)
+        {
+          m_table.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+}
+
+}   // gpsr
+} // ns3
@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef GPSR_DCACHE_H
+#define GPSR_DCACHE_H
+
+#include <map>
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+
+namespace ns3 {
+namespace gpsr {
+
+/**
+ * \ingroup gpsr
+ * \brief Last known position and velocity of destinations
+ *
+ * Filled from location service answers, HELLOs and the position headers of
+ * the packets a node handles; only fixes newer than the stored one are
+ * kept. When a fix comes without a velocity, it is estimated from the
+ * previous fix of the same node.
+ */
+class DestinationCache
+{
+public:
+  /// c-tor
+  DestinationCache ();
+
+  /// How long an entry is kept after its fix
+  void SetLifeTime (Time lifeTime)
+  {
+    m_lifeTime = lifeTime;
+  }
+  Time GetLifeTime () const
+  {
+    return m_lifeTime;
+  }
+
+  /// Store a fix with a known velocity
+  void Update (Ipv4Address id, Vector position, Vector velocity, Time updated);
+  /// Store a fix, the velocity is estimated from the previous fix
+  void Update (Ipv4Address id, Vector position, Time updated);
+
+  /**
+   * \brief Gets the last fix of id
+   * \return false if id is unknown or its entry expired
+   */
+  bool Lookup (Ipv4Address id, Vector &position, Vector &velocity, Time &updated);
+
+  /**
+   * \brief Position at the current time of a node moving at velocity since its fix
+   * \param maxAge the fix is not extrapolated further than this
+   */
+  static Vector Extrapolate (Vector position, Vector velocity, Time updated, Time maxAge);
+
+  /// Remove expired entries
+  void Purge ();
+  void Clear ()
+  {
+    m_table.clear ();
+  }
+
+private:
+  struct Entry
+  {
+    Vector position;
+    Vector velocity;
+    Time updated;               ///< Time of the fix
+  };
+  Time m_lifeTime;
+  std::map<Ipv4Address, Entry> m_table;
+};
+
+}   // gpsr
+} // ns3
+#endif /* GPSR_DCACHE_H */
@@ -0,0 +1,409 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "gpsr-gls.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/trace-source-accessor.h"
+#include <algorithm>
+#include <cmath>
+
+NS_LOG_COMPONENT_DEFINE ("GpsrGls");
+
+namespace ns3 {
+namespace gpsr {
+
+NS_OBJECT_ENSURE_REGISTERED (GlsLocationService);
+
+std::map<uint32_t, GlsLocationService *> GlsLocationService::s_registry;
+std::map<GlsLocationService::Cell, std::set<uint32_t> > GlsLocationService::s_cells;
+Time GlsLocationService::s_cellsTime;
+bool GlsLocationService::s_cellsDirty = true;
+
+TypeId
+GlsLocationService::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::gpsr::GlsLocationService")
+    .SetParent<LocationService> ()
+    .AddConstructor<GlsLocationService> ()
+    .AddAttribute ("GridSize", "Side of an order-1 square, m.",
+                   DoubleValue (250),
+                   MakeDoubleAccessor (&GlsLocationService::GridSize),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("WorldSize", "Side of the simulated area, m.",
+                   DoubleValue (2000),
+                   MakeDoubleAccessor (&GlsLocationService::WorldSize),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("UpdateDistance", "Movement (m) that triggers an update of the order-1 servers, doubled for every order above.",
+                   DoubleValue (100),
+                   MakeDoubleAccessor (&GlsLocationService::UpdateDistance),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("RadioRange", "Range (m) used to count the hops of GLS messages.",
+                   DoubleValue (250),
+                   MakeDoubleAccessor (&GlsLocationService::RadioRange),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("UpdateCheckInterval", "Period of the movement check.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&GlsLocationService::UpdateCheckInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("CacheTimeout", "Lifetime of a position looked up.",
+                   TimeValue (Seconds (5)),
+                   MakeTimeAccessor (&GlsLocationService::CacheTimeout),
+                   MakeTimeChecker ())
+    .AddTraceSource ("Lookup", "A lookup went through the server hierarchy.",
+                     MakeTraceSourceAccessor (&GlsLocationService::m_lookupTrace),
+                     "ns3::gpsr::GlsLocationService::LookupCallback")
+  ;
+  return tid;
+}
+
+GlsLocationService::GlsLocationService ()
+  : GridSize (250),
+    WorldSize (2000),
+    UpdateDistance (100),
+    RadioRange (250),
+    UpdateCheckInterval (Seconds (1)),
+    CacheTimeout (Seconds (5)),
+    m_id (0),
+    m_updateHops (0),
+    m_lookupHops (0),
+    m_lookups (0),
+    m_failedLookups (0)
+{
+  m_uniformRandomVariable = CreateObject<UniformRandomVariable> ();
+}
+
+GlsLocationService::~GlsLocationService ()
+{
+}
+
+void
+GlsLocationService::DoDispose ()
+{
+  m_updateEvent.Cancel ();
+  std::map<uint32_t, GlsLocationService *>::iterator i = s_registry.find (m_id);
+  if (i != s_registry.end () && i->second == this)
+    {
+      s_registry.erase (i);
+      s_cellsDirty = true;
+    }
+  m_mobility = 0;
+  LocationService::DoDispose ();
+}
+
+void
+GlsLocationService::Start (Ipv4Address id, Ptr<MobilityModel> mobility)
+{
+  NS_LOG_FUNCTION (this << id);
+  m_id = id.Get ();
+  m_mobility = mobility;
+  s_registry[m_id] = this;
+  s_cellsDirty = true;
+  m_lastUpdatePos.assign (GetLevels (), GetInvalidPosition ());
+  m_servers.assign (GetLevels (), std::vector<uint32_t> ());
+  // every node joins before the first check
+  m_updateEvent = Simulator::Schedule (Seconds (m_uniformRandomVariable->GetValue (0, UpdateCheckInterval.GetSeconds ())) + MicroSeconds (1),
+                                       &GlsLocationService::UpdateCheck, this);
+}
+
+Time
+GlsLocationService::GetEntryUpdateTime (Ipv4Address id)
+{
+  std::map<Ipv4Address, Entry>::const_iterator i = m_cache.find (id);
+  if (i == m_cache.end () || i->second.expire <= Simulator::Now ())
+    {
+      return Seconds (0);
+    }
+  return i->second.updated;
+}
+
+void
+GlsLocationService::AddEntry (Ipv4Address id, Vector position)
+{
+  Entry entry;
+  entry.position = position;
+  entry.updated = Simulator::Now ();
+  entry.expire = Simulator::Now () + CacheTimeout;
+  m_cache[id] = entry;
+}
+
+void
+GlsLocationService::DeleteEntry (Ipv4Address id)
+{
+  m_cache.erase (id);
+}
+
+Vector
+GlsLocationService::GetPosition (Ipv4Address id)
+{
+  std::map<Ipv4Address, Entry>::const_iterator i = m_cache.find (id);
+  if (i != m_cache.end () && i->second.expire > Simulator::Now ())
+    {
+      return i->second.position;
+    }
+  uint32_t t = id.Get ();
+  if (t == m_id)
+    {
+      return GetMyPosition ();
+    }
+
+  RefreshCells ();
+  m_lookups++;
+  Vector myPos = GetMyPosition ();
+  Cell cell = GetCell (myPos);
+  Vector at = myPos;
+  uint32_t hops = 0;
+  bool found = false;
+  Entry result;
+
+  // nodes of the same order-1 square know each other from their HELLOs
+  std::map<uint32_t, GlsLocationService *>::const_iterator target = s_registry.find (t);
+  if (target != s_registry.end () && GetCell (target->second->GetMyPosition ()) == cell)
+    {
+      found = true;
+      result.position = target->second->GetMyPosition ();
+      result.updated = Simulator::Now ();
+    }
+
+  // walk the best nodes for t of the order-1, order-2, ... squares of this node
+  for (uint32_t order = 1; order < GetLevels () && !found; ++order)
+    {
+      Cell square ((cell.first >> (order - 1)) << (order - 1), (cell.second >> (order - 1)) << (order - 1));
+      uint32_t best = BestNode (square, order, t);
+      std::map<uint32_t, GlsLocationService *>::const_iterator server = s_registry.find (best);
+      if (server == s_registry.end ())
+        {
+          continue;
+        }
+      Vector serverPos = server->second->GetMyPosition ();
+      hops += Hops (at, serverPos);
+      at = serverPos;
+      if (best == t)
+        {
+          // the query reached the target itself
+          found = true;
+          result.position = serverPos;
+          result.updated = Simulator::Now ();
+        }
+      else
+        {
+          std::map<uint32_t, Entry>::const_iterator served = server->second->m_served.find (t);
+          if (served != server->second->m_served.end ())
+            {
+              found = true;
+              result = served->second;
+            }
+        }
+    }
+
+  if (found)
+    {
+      hops += Hops (at, myPos); // reply
+    }
+  else
+    {
+      m_failedLookups++;
+    }
+  m_lookupHops += hops;
+  m_lookupTrace (id, hops, found);
+  NS_LOG_LOGIC ("Lookup of " << id << " " << (found ? "found" : "failed") << " in " << hops << " hops");
+
+  if (!found)
+    {
+      return GetInvalidPosition ();
+    }
+  result.expire = Simulator::Now () + CacheTimeout;
+  m_cache[id] = result;
+  return result.position;
+}
+
+bool
+GlsLocationService::IsInSearch (Ipv4Address id)
+{
+  // lookups are resolved when GetPosition is called
+  return false;
+}
+
+bool
+GlsLocationService::HasPosition (Ipv4Address id)
+{
+  std::map<Ipv4Address, Entry>::const_iterator i = m_cache.find (id);
+  return i != m_cache.end () && i->second.expire > Simulator::Now ();
+}
+
+void
+GlsLocationService::Purge ()
+{
+  Time now = Simulator::Now ();
+  for (std::map<Ipv4Address, Entry>::iterator i = m_cache.begin (); i != m_cache.end (); )
+    {
+      if (i->second.expire <= now)
+        {
+          m_cache.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+}
+
+void
+GlsLocationService::Clear ()
+{
+  m_cache.clear ();
+}
+
+uint32_t
+GlsLocationService::GetLevels () const
+{
+  uint32_t levels = 1;
+  double side = GridSize;
+  while (side < WorldSize)
+    {
+      side *= 2;
+      levels++;
+    }
+  return levels;
+}
+
+GlsLocationService::Cell
+GlsLocationService::GetCell (Vector position) const
+{
+  return Cell (std::max (0, (int32_t) std::floor (position.x / GridSize)),
+               std::max (0, (int32_t) std::floor (position.y / GridSize)));
+}
+
+Vector
+GlsLocationService::GetMyPosition () const
+{
+  return m_mobility->GetPosition ();
+}
+
+void
+GlsLocationService::RefreshCells ()
+{
+  Time now = Simulator::Now ();
+  if (!s_cellsDirty && now - s_cellsTime < UpdateCheckInterval)
+    {
+      return;
+    }
+  s_cells.clear ();
+  for (std::map<uint32_t, GlsLocationService *>::const_iterator i = s_registry.begin (); i != s_registry.end (); ++i)
+    {
+      s_cells[GetCell (i->second->GetMyPosition ())].insert (i->first);
+    }
+  s_cellsTime = now;
+  s_cellsDirty = false;
+}
+
+uint32_t
+GlsLocationService::BestNode (Cell origin, uint32_t order, uint32_t id) const
+{
+  int32_t side = 1 << (order - 1);
+  uint32_t best = 0;
+  uint32_t lowest = 0;
+  bool hasBest = false;
+  bool hasLowest = false;
+  for (int32_t x = origin.first; x < origin.first + side; ++x)
+    {
+      for (int32_t y = origin.second; y < origin.second + side; ++y)
+        {
+          std::map<Cell, std::set<uint32_t> >::const_iterator c = s_cells.find (Cell (x, y));
+          if (c == s_cells.end () || c->second.empty ())
+            {
+              continue;
+            }
+          std::set<uint32_t>::const_iterator u = c->second.upper_bound (id);
+          if (u != c->second.end () && (!hasBest || *u < best))
+            {
+              best = *u;
+              hasBest = true;
+            }
+          if (!hasLowest || *c->second.begin () < lowest)
+            {
+              lowest = *c->second.begin ();
+              hasLowest = true;
+            }
+        }
+    }
+  // the ID space is circular
+  return hasBest ? best : lowest;
+}
+
+uint32_t
+GlsLocationService::Hops (Vector a, Vector b) const
+{
+  return (uint32_t) std::ceil (CalculateDistance (a, b) / RadioRange);
+}
+
+void
+GlsLocationService::UpdateCheck ()
+{
+  RefreshCells ();
+  Vector pos = GetMyPosition ();
+  for (uint32_t order = 1; order < GetLevels (); ++order)
+    {
+      double threshold = UpdateDistance * (1 << (order - 1));
+      if (m_servers[order - 1].empty () || CalculateDistance (pos, m_lastUpdatePos[order - 1]) >= threshold)
+        {
+          UpdateServers (order);
+        }
+    }
+  m_updateEvent = Simulator::Schedule (UpdateCheckInterval, &GlsLocationService::UpdateCheck, this);
+}
+
+void
+GlsLocationService::UpdateServers (uint32_t order)
+{
+  Vector pos = GetMyPosition ();
+  Cell cell = GetCell (pos);
+  int32_t side = 1 << (order - 1);
+  Cell parent ((cell.first >> order) << order, (cell.second >> order) << order);
+  Cell own ((cell.first >> (order - 1)) << (order - 1), (cell.second >> (order - 1)) << (order - 1));
+
+  // one server in each of the three order-k squares sharing the order-(k+1) square
+  std::vector<uint32_t> servers;
+  for (int32_t dx = 0; dx < 2; ++dx)
+    {
+      for (int32_t dy = 0; dy < 2; ++dy)
+        {
+          Cell square (parent.first + dx * side, parent.second + dy * side);
+          if (square == own)
+            {
+              continue;
+            }
+          uint32_t server = BestNode (square, order, m_id);
+          if (s_registry.find (server) != s_registry.end ())
+            {
+              servers.push_back (server);
+            }
+        }
+    }
+
+  // servers that were dropped forget the entry
+  std::vector<uint32_t> &old = m_servers[order - 1];
+  for (std::vector<uint32_t>::const_iterator i = old.begin (); i != old.end (); ++i)
+    {
+      std::map<uint32_t, GlsLocationService *>::iterator server = s_registry.find (*i);
+      if (server != s_registry.end () && std::find (servers.begin (), servers.end (), *i) == servers.end ())
+        {
+          server->second->m_served.erase (m_id);
+        }
+    }
+
+  Entry entry;
+  entry.position = pos;
+  entry.updated = Simulator::Now ();
+  for (std::vector<uint32_t>::const_iterator i = servers.begin (); i != servers.end (); ++i)
+    {
+      GlsLocationService *server = s_registry[*i];
+      server->m_served[m_id] = entry;
+      m_updateHops += Hops (pos, server->GetMyPosition ());
+    }
+  old = servers;
+  m_lastUpdatePos[order - 1] = pos;
+}
+
+}   // gpsr
+} // ns3
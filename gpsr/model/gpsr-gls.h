@@ -0,0 +1,156 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef GPSR_GLS_H
+#define GPSR_GLS_H
+
+#include <map>
+#include <set>
+#include <vector>
+#include "ns3/ipv4-address.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/traced-callback.h"
+#include "ns3/mobility-model.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/location-service.h"
+
+namespace ns3 {
+namespace gpsr {
+
+/**
+ * \ingroup gpsr
+ * \brief Grid Location Service
+ *
+ * The area is divided into a hierarchy of squares: GridSize-sided order-1
+ * squares, grouped four by four into order-2 squares and so on. For every
+ * order k, a node keeps one location server in each of the three order-k
+ * squares that share its order-(k+1) square; the server is the node of that
+ * square with the least ID greater than the ID of the node (circularly).
+ * Servers of order k are updated when the node moved UpdateDistance*2^(k-1)
+ * since their last update. A lookup walks, from the querying node, the
+ * nodes with the best ID in its order-1, order-2, ... squares until one of
+ * them serves the target.
+ *
+ * This is a model: servers are selected, updated and queried through a
+ * registry shared by all instances, and the messages a real deployment
+ * would send are accounted in geographic hops (RadioRange) instead of
+ * being transmitted. Square membership is refreshed every
+ * UpdateCheckInterval.
+ */
+class GlsLocationService : public LocationService
+{
+public:
+  static TypeId GetTypeId (void);
+
+  /// c-tor
+  GlsLocationService ();
+  virtual ~GlsLocationService ();
+  virtual void DoDispose ();
+
+  ///\name From LocationService
+  //\{
+  virtual Time GetEntryUpdateTime (Ipv4Address id);
+  virtual void AddEntry (Ipv4Address id, Vector position);
+  virtual void DeleteEntry (Ipv4Address id);
+  virtual Vector GetPosition (Ipv4Address id);
+  virtual bool IsInSearch (Ipv4Address id);
+  virtual bool HasPosition (Ipv4Address id);
+  virtual void Purge ();
+  virtual void Clear ();
+  //\}
+
+  /// Join the grid with the given ID, positioned by mobility
+  void Start (Ipv4Address id, Ptr<MobilityModel> mobility);
+
+  ///\name Statistics
+  //\{
+  /// Number of nodes this node is a location server for
+  uint32_t GetStateSize () const
+  {
+    return m_served.size ();
+  }
+  /// Hops of all location updates sent by this node
+  uint64_t GetUpdateHops () const
+  {
+    return m_updateHops;
+  }
+  /// Hops of all lookups (query and reply) made by this node
+  uint64_t GetLookupHops () const
+  {
+    return m_lookupHops;
+  }
+  uint32_t GetLookups () const
+  {
+    return m_lookups;
+  }
+  uint32_t GetFailedLookups () const
+  {
+    return m_failedLookups;
+  }
+  //\}
+
+  /**
+   * TracedCallback signature for lookups.
+   * \param target the node that was looked for
+   * \param hops geographic hops of the query and its reply
+   * \param found true if a server of the target was reached
+   */
+  typedef void (* LookupCallback)(Ipv4Address target, uint32_t hops, bool found);
+
+private:
+  /// Cached (requester side) or served (server side) position
+  struct Entry
+  {
+    Vector position;
+    Time updated;               ///< Time the position was measured
+    Time expire;                ///< Time a cached entry leaves the cache
+  };
+  /// Cell coordinates of an order-1 square
+  typedef std::pair<int32_t, int32_t> Cell;
+
+  double GridSize;              ///< Side of an order-1 square, meters
+  double WorldSize;             ///< Side of the simulated area, meters
+  double UpdateDistance;        ///< Distance that triggers an update of the order-1 servers, meters
+  double RadioRange;            ///< Range used to turn distances into hops, meters
+  Time UpdateCheckInterval;     ///< Period of the movement check
+  Time CacheTimeout;            ///< Lifetime of a position looked up
+
+  uint32_t m_id;
+  Ptr<MobilityModel> m_mobility;
+  EventId m_updateEvent;
+  Ptr<UniformRandomVariable> m_uniformRandomVariable;
+  std::map<Ipv4Address, Entry> m_cache;                    ///< Positions looked up by this node
+  std::map<uint32_t, Entry> m_served;                      ///< Positions this node is a server for
+  std::vector<Vector> m_lastUpdatePos;                     ///< Position sent to the servers of each order
+  std::vector<std::vector<uint32_t> > m_servers;           ///< Servers of each order
+  uint64_t m_updateHops;
+  uint64_t m_lookupHops;
+  uint32_t m_lookups;
+  uint32_t m_failedLookups;
+  TracedCallback<Ipv4Address, uint32_t, bool> m_lookupTrace;
+
+  ///\name Registry shared by all instances
+  //\{
+  static std::map<uint32_t, GlsLocationService *> s_registry;
+  static std::map<Cell, std::set<uint32_t> > s_cells;      ///< IDs per order-1 square
+  static Time s_cellsTime;                                 ///< Time s_cells was built
+  static bool s_cellsDirty;                                ///< Registry changed since s_cells was built
+  //\}
+
+  /// Number of orders of the hierarchy
+  uint32_t GetLevels () const;
+  Cell GetCell (Vector position) const;
+  Vector GetMyPosition () const;
+  /// Rebuild s_cells if it is older than UpdateCheckInterval
+  void RefreshCells ();
+  /// Node with the least ID greater than id in the square of 2^(order-1) cells starting at origin, 0 if empty
+  uint32_t BestNode (Cell origin, uint32_t order, uint32_t id) const;
+  uint32_t Hops (Vector a, Vector b) const;
+  void UpdateCheck ();
+  void UpdateServers (uint32_t order);
+};
+
+}   // gpsr
+} // ns3
+#endif /* GPSR_GLS_H */
@@ -0,0 +1,723 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "gpsr-home.h"
+#include "gpsr-packet.h"
+#include "ns3/log.h"
+#include "ns3/address-utils.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/node.h"
+#include "ns3/mobility-model.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/trace-source-accessor.h"
+#include <algorithm>
+#include <cmath>
+
+NS_LOG_COMPONENT_DEFINE ("GpsrHome");
+
+namespace ns3 {
+namespace gpsr {
+
+//-----------------------------------------------------------------------------
+// Home region header
+//-----------------------------------------------------------------------------
+HomeHeader::HomeHeader (HomeMessageType type, bool local, uint32_t requestId,
+                        Ipv4Address node, Ipv4Address target,
+                        uint64_t posx, uint64_t posy, uint32_t timestamp)
+  : m_type (type),
+    m_valid (true),
+    m_local (local),
+    m_requestId (requestId),
+    m_node (node),
+    m_target (target),
+    m_posx (posx),
+    m_posy (posy),
+    m_timestamp (timestamp)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED (HomeHeader);
+
+TypeId
+HomeHeader::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::gpsr::HomeHeader")
+    .SetParent<Header> ()
+    .AddConstructor<HomeHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+HomeHeader::GetInstanceTypeId () const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+HomeHeader::GetSerializedSize () const
+{
+  return 34;
+}
+
+void
+HomeHeader::Serialize (Buffer::Iterator i) const
+{
+  i.WriteU8 ((uint8_t) m_type);
+  i.WriteU8 (m_local ? 1 : 0);
+  i.WriteHtonU32 (m_requestId);
+  WriteTo (i, m_node);
+  WriteTo (i, m_target);
+  i.WriteHtonU64 (m_posx);
+  i.WriteHtonU64 (m_posy);
+  i.WriteHtonU32 (m_timestamp);
+}
+
+uint32_t
+HomeHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  uint8_t type = i.ReadU8 ();
+  m_valid = true;
+  switch (type)
+    {
+    case HOMETYPE_UPDATE:
+    case HOMETYPE_QUERY:
+    case HOMETYPE_REPLY:
+      {
+        m_type = (HomeMessageType) type;
+        break;
+      }
+    default:
+      m_valid = false;
+    }
+  m_local = i.ReadU8 () != 0;
+  m_requestId = i.ReadNtohU32 ();
+  ReadFrom (i, m_node);
+  ReadFrom (i, m_target);
+  m_posx = i.ReadNtohU64 ();
+  m_posy = i.ReadNtohU64 ();
+  m_timestamp = i.ReadNtohU32 ();
+
+  uint32_t dist = i.GetDistanceFrom (start);
+  NS_ASSERT (dist == GetSerializedSize ());
+  return dist;
+}
+
+void
+HomeHeader::Print (std::ostream &os) const
+{
+  switch (m_type)
+    {
+    case HOMETYPE_UPDATE:
+      os << " HOME_UPDATE";
+      break;
+    case HOMETYPE_QUERY:
+      os << " HOME_QUERY";
+      break;
+    case HOMETYPE_REPLY:
+      os << " HOME_REPLY";
+      break;
+    }
+  os << " Local: " << m_local
+     << " RequestId: " << m_requestId
+     << " Node: " << m_node
+     << " Target: " << m_target
+     << " PositionX: " << m_posx
+     << " PositionY: " << m_posy
+     << " Timestamp: " << m_timestamp;
+}
+
+std::ostream &
+operator<< (std::ostream & os, HomeHeader const & h)
+{
+  h.Print (os);
+  return os;
+}
+
+//-----------------------------------------------------------------------------
+// Home region location service
+//-----------------------------------------------------------------------------
+NS_OBJECT_ENSURE_REGISTERED (HomeRegionLocationService);
+
+/// UDP Port for home region messages, next to the RLS port
+const uint32_t HomeRegionLocationService::HOME_PORT = 668;
+
+std::map<Ipv4Address, Vector> HomeRegionLocationService::s_static;
+
+TypeId
+HomeRegionLocationService::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::gpsr::HomeRegionLocationService")
+    .SetParent<LocationService> ()
+    .AddConstructor<HomeRegionLocationService> ()
+    .AddAttribute ("RegionSize", "Side of a home region, meters.",
+                   DoubleValue (300),
+                   MakeDoubleAccessor (&HomeRegionLocationService::RegionSize),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("WorldSize", "Side of the simulated area, meters.",
+                   DoubleValue (1500),
+                   MakeDoubleAccessor (&HomeRegionLocationService::WorldSize),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("RegionBase", "Region i has the virtual address RegionBase + 1 + i.",
+                   Ipv4AddressValue ("240.0.0.0"),
+                   MakeIpv4AddressAccessor (&HomeRegionLocationService::RegionBase),
+                   MakeIpv4AddressChecker ())
+    .AddAttribute ("UpdateInterval", "Period of the position updates of a mobile node.",
+                   TimeValue (Seconds (5)),
+                   MakeTimeAccessor (&HomeRegionLocationService::UpdateInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("EntryTimeout", "Lifetime of a position served by a home region node.",
+                   TimeValue (Seconds (15)),
+                   MakeTimeAccessor (&HomeRegionLocationService::EntryTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("CacheTimeout", "Lifetime of a position answered to a query.",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&HomeRegionLocationService::CacheTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("QueryTimeout", "Time to wait for a reply before the query is retried.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&HomeRegionLocationService::QueryTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("QueryRetries", "Queries retried before a search is given up.",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&HomeRegionLocationService::QueryRetries),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MaxJitter", "Maximum jitter of the in-region rebroadcast.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&HomeRegionLocationService::MaxJitter),
+                   MakeTimeChecker ())
+    .AddTraceSource ("UpdateTx", "A position update is sent or rebroadcast in its home region.",
+                     MakeTraceSourceAccessor (&HomeRegionLocationService::m_updateTxTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("QueryTx", "A query is sent or rebroadcast in its home region.",
+                     MakeTraceSourceAccessor (&HomeRegionLocationService::m_queryTxTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("ReplyTx", "A reply is sent.",
+                     MakeTraceSourceAccessor (&HomeRegionLocationService::m_replyTxTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("Lookup", "A query is answered.",
+                     MakeTraceSourceAccessor (&HomeRegionLocationService::m_lookupTrace),
+                     "ns3::gpsr::HomeRegionLocationService::LookupCallback")
+    .AddTraceSource ("LookupFailed", "A query is given up.",
+                     MakeTraceSourceAccessor (&HomeRegionLocationService::m_lookupFailedTrace),
+                     "ns3::gpsr::HomeRegionLocationService::LookupFailedCallback")
+  ;
+  return tid;
+}
+
+HomeRegionLocationService::HomeRegionLocationService ()
+  : RegionSize (300),
+    WorldSize (1500),
+    RegionBase ("240.0.0.0"),
+    UpdateInterval (Seconds (5)),
+    EntryTimeout (Seconds (15)),
+    CacheTimeout (Seconds (10)),
+    QueryTimeout (Seconds (1)),
+    QueryRetries (2),
+    MaxJitter (MilliSeconds (10)),
+    m_requestId (0)
+{
+  m_uniformRandomVariable = CreateObject<UniformRandomVariable> ();
+}
+
+HomeRegionLocationService::~HomeRegionLocationService ()
+{
+}
+
+void
+HomeRegionLocationService::DoDispose ()
+{
+  Clear ();
+  m_updateEvent.Cancel ();
+  if (m_socket)
+    {
+      m_socket->Close ();
+      m_socket = 0;
+    }
+  m_ipv4 = 0;
+  m_searchDone = MakeNullCallback<void, Ipv4Address> ();
+  LocationService::DoDispose ();
+}
+
+void
+HomeRegionLocationService::Start (Ptr<Ipv4> ipv4)
+{
+  NS_LOG_FUNCTION (this);
+  m_ipv4 = ipv4;
+  m_socket = Socket::CreateSocket (ipv4->GetObject<Node> (), UdpSocketFactory::GetTypeId ());
+  m_socket->SetAllowBroadcast (true);
+  m_socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), HOME_PORT));
+  m_socket->SetRecvCallback (MakeCallback (&HomeRegionLocationService::Recv, this));
+  // spread the first updates over a period
+  m_updateEvent = Simulator::Schedule (Seconds (m_uniformRandomVariable->GetValue (0, UpdateInterval.GetSeconds ())),
+                                       &HomeRegionLocationService::UpdateTimerExpire, this);
+}
+
+void
+HomeRegionLocationService::AddStaticNode (Ipv4Address id, Vector position)
+{
+  s_static[id] = position;
+}
+
+void
+HomeRegionLocationService::ClearStaticNodes ()
+{
+  s_static.clear ();
+}
+
+uint32_t
+HomeRegionLocationService::GetSide () const
+{
+  return std::max (1.0, std::ceil (WorldSize / RegionSize));
+}
+
+bool
+HomeRegionLocationService::IsRegionAddress (Ipv4Address a) const
+{
+  uint32_t side = GetSide ();
+  return a.Get () > RegionBase.Get () && a.Get () <= RegionBase.Get () + side * side;
+}
+
+Ipv4Address
+HomeRegionLocationService::GetHomeAddress (Ipv4Address id) const
+{
+  uint32_t side = GetSide ();
+  uint32_t h = id.Get () * 2654435761u;
+  return Ipv4Address (RegionBase.Get () + 1 + (h >> 8) % (side * side));
+}
+
+Vector
+HomeRegionLocationService::GetRegionCenter (Ipv4Address region) const
+{
+  uint32_t side = GetSide ();
+  uint32_t index = region.Get () - RegionBase.Get () - 1;
+  double x0 = (index % side) * RegionSize;
+  double y0 = (index / side) * RegionSize;
+  // the last row and column may be cut by the border of the area
+  return Vector ((x0 + std::min (x0 + RegionSize, WorldSize)) / 2,
+                 (y0 + std::min (y0 + RegionSize, WorldSize)) / 2, 0);
+}
+
+bool
+HomeRegionLocationService::IsInRegion (Ipv4Address region, Vector position) const
+{
+  int32_t side = GetSide ();
+  int32_t col = std::min (side - 1, std::max (0, (int32_t) std::floor (position.x / RegionSize)));
+  int32_t row = std::min (side - 1, std::max (0, (int32_t) std::floor (position.y / RegionSize)));
+  return region.Get () == RegionBase.Get () + 1 + col + row * side;
+}
+
+Vector
+HomeRegionLocationService::GetMyPosition () const
+{
+  return m_ipv4->GetObject<MobilityModel> ()->GetPosition ();
+}
+
+Time
+HomeRegionLocationService::GetEntryUpdateTime (Ipv4Address id)
+{
+  if (IsRegionAddress (id) || s_static.find (id) != s_static.end () || IsMyOwnAddress (id))
+    {
+      return Simulator::Now ();
+    }
+  Time now = Simulator::Now ();
+  std::map<Ipv4Address, Entry>::const_iterator i = m_table.find (id);
+  std::map<Ipv4Address, Entry>::const_iterator j = m_served.find (id);
+  Time updated = Seconds (0);
+  if (i != m_table.end () && i->second.expire > now)
+    {
+      updated = i->second.updated;
+    }
+  if (j != m_served.end () && j->second.expire > now && j->second.updated > updated)
+    {
+      updated = j->second.updated;
+    }
+  return updated;
+}
+
+void
+HomeRegionLocationService::AddEntry (Ipv4Address id, Vector position)
+{
+  UpdateEntry (m_table, id, position, Simulator::Now (), CacheTimeout);
+}
+
+void
+HomeRegionLocationService::DeleteEntry (Ipv4Address id)
+{
+  m_table.erase (id);
+  m_served.erase (id);
+}
+
+Vector
+HomeRegionLocationService::GetPosition (Ipv4Address id)
+{
+  if (IsRegionAddress (id))
+    {
+      return GetRegionCenter (id);
+    }
+  std::map<Ipv4Address, Vector>::const_iterator s = s_static.find (id);
+  if (s != s_static.end ())
+    {
+      return s->second;
+    }
+  if (IsMyOwnAddress (id))
+    {
+      return GetMyPosition ();
+    }
+  Time now = Simulator::Now ();
+  std::map<Ipv4Address, Entry>::const_iterator i = m_table.find (id);
+  std::map<Ipv4Address, Entry>::const_iterator j = m_served.find (id);
+  bool cached = i != m_table.end () && i->second.expire > now;
+  bool served = j != m_served.end () && j->second.expire > now;
+  if (cached && (!served || i->second.updated >= j->second.updated))
+    {
+      return i->second.position;
+    }
+  if (served)
+    {
+      return j->second.position;
+    }
+  // miss: query the home region of id unless a query is running already
+  if (m_socket && m_searches.find (id) == m_searches.end ())
+    {
+      Search search;
+      search.requestId = 0;
+      search.retries = 0;
+      search.start = now;
+      m_searches[id] = search;
+      SendQuery (id);
+    }
+  return GetInvalidPosition ();
+}
+
+bool
+HomeRegionLocationService::IsInSearch (Ipv4Address id)
+{
+  return m_searches.find (id) != m_searches.end ();
+}
+
+bool
+HomeRegionLocationService::HasPosition (Ipv4Address id)
+{
+  if (IsRegionAddress (id) || s_static.find (id) != s_static.end () || IsMyOwnAddress (id))
+    {
+      return true;
+    }
+  Time now = Simulator::Now ();
+  std::map<Ipv4Address, Entry>::const_iterator i = m_table.find (id);
+  std::map<Ipv4Address, Entry>::const_iterator j = m_served.find (id);
+  return (i != m_table.end () && i->second.expire > now) || (j != m_served.end () && j->second.expire > now);
+}
+
+void
+HomeRegionLocationService::Purge ()
+{
+  Time now = Simulator::Now ();
+  for (std::map<Ipv4Address, Entry>::iterator i = m_table.begin (); i != m_table.end (); )
+    {
+      if (i->second.expire <= now)
+        {
+          m_table.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+  for (std::map<Ipv4Address, Entry>::iterator i = m_served.begin (); i != m_served.end (); )
+    {
+      if (i->second.expire <= now)
+        {
+          m_served.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+}
+
+void
+HomeRegionLocationService::Clear ()
+{
+  for (std::map<Ipv4Address, Search>::iterator i = m_searches.begin (); i != m_searches.end (); ++i)
+    {
+      i->second.timeout.Cancel ();
+    }
+  m_searches.clear ();
+  m_table.clear ();
+  m_served.clear ();
+}
+
+void
+HomeRegionLocationService::UpdateTimerExpire ()
+{
+  Purge ();
+  if (s_static.find (GetMainAddress ()) == s_static.end ())
+    {
+      Vector myPos = GetMyPosition ();
+      HomeHeader update (HOMETYPE_UPDATE, false, 0, GetMainAddress (), GetMainAddress (),
+                         (uint64_t) myPos.x, (uint64_t) myPos.y,
+                         (uint32_t) Simulator::Now ().GetMilliSeconds ());
+      SendHome (GetMainAddress (), update);
+    }
+  m_updateEvent = Simulator::Schedule (UpdateInterval, &HomeRegionLocationService::UpdateTimerExpire, this);
+}
+
+void
+HomeRegionLocationService::SendQuery (Ipv4Address target)
+{
+  NS_LOG_FUNCTION (this << target);
+  Vector myPos = GetMyPosition ();
+  uint32_t id = ++m_requestId;
+  Search &search = m_searches[target];
+  search.requestId = id;
+  search.timeout = Simulator::Schedule (QueryTimeout, &HomeRegionLocationService::QueryExpire, this, target);
+
+  // may be answered at once when this node is in the home region of target
+  HomeHeader query (HOMETYPE_QUERY, false, id, GetMainAddress (), target,
+                    (uint64_t) myPos.x, (uint64_t) myPos.y,
+                    (uint32_t) Simulator::Now ().GetMilliSeconds ());
+  SendHome (target, query);
+}
+
+void
+HomeRegionLocationService::QueryExpire (Ipv4Address target)
+{
+  std::map<Ipv4Address, Search>::iterator i = m_searches.find (target);
+  if (i == m_searches.end ())
+    {
+      return;
+    }
+  if (i->second.retries < QueryRetries)
+    {
+      i->second.retries++;
+      SendQuery (target);
+      return;
+    }
+  NS_LOG_LOGIC ("No reply for " << target << ", query given up");
+  m_searches.erase (i);
+  m_lookupFailedTrace (target);
+  if (!m_searchDone.IsNull ())
+    {
+      m_searchDone (target);
+    }
+}
+
+void
+HomeRegionLocationService::SendHome (Ipv4Address about, const HomeHeader &header)
+{
+  Ipv4Address home = GetHomeAddress (about);
+  if (IsInRegion (home, GetMyPosition ()))
+    {
+      HandleInRegion (header);
+      return;
+    }
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  if (header.GetType () == HOMETYPE_UPDATE)
+    {
+      m_updateTxTrace (packet);
+    }
+  else
+    {
+      m_queryTxTrace (packet);
+    }
+  // routed by GPSR towards the region centre, see RoutingProtocol::RouteInput
+  m_socket->SendTo (packet, 0, InetSocketAddress (home, HOME_PORT));
+}
+
+void
+HomeRegionLocationService::RecvInRegion (Ptr<Packet> packet)
+{
+  HomeHeader header;
+  packet->RemoveHeader (header);
+  if (!header.IsValid ())
+    {
+      NS_LOG_DEBUG ("Home region message " << packet->GetUid () << " with unknown type received. Ignored");
+      return;
+    }
+  HandleInRegion (header);
+}
+
+void
+HomeRegionLocationService::HandleInRegion (const HomeHeader &header)
+{
+  Time updated = MilliSeconds (header.GetTimestamp ());
+  Vector position (header.GetPosx (), header.GetPosy (), 0);
+  bool answered = false;
+  if (header.GetType () == HOMETYPE_UPDATE)
+    {
+      UpdateEntry (m_served, header.GetNode (), position, updated, EntryTimeout);
+    }
+  else if (header.GetType () == HOMETYPE_QUERY)
+    {
+      // the reply is routed back with GPSR, which needs the position of the requester
+      UpdateEntry (m_table, header.GetNode (), position, updated, CacheTimeout);
+      std::map<Ipv4Address, Vector>::const_iterator s = s_static.find (header.GetTarget ());
+      std::map<Ipv4Address, Entry>::const_iterator j = m_served.find (header.GetTarget ());
+      if (s != s_static.end ())
+        {
+          Entry entry;
+          entry.position = s->second;
+          entry.updated = Simulator::Now ();
+          Reply (header, entry);
+          answered = true;
+        }
+      else if (j != m_served.end () && j->second.expire > Simulator::Now ())
+        {
+          Reply (header, j->second);
+          answered = true;
+        }
+    }
+
+  // share updates, and queries this node cannot answer, with the other nodes of the region
+  if (!header.IsLocal () && !answered)
+    {
+      HomeHeader local = header;
+      local.SetLocal (true);
+      Ptr<Packet> packet = Create<Packet> ();
+      packet->AddHeader (local);
+      Simulator::Schedule (Seconds (m_uniformRandomVariable->GetValue (0, MaxJitter.GetSeconds ())),
+                           &HomeRegionLocationService::Broadcast, this, packet);
+    }
+}
+
+void
+HomeRegionLocationService::Reply (const HomeHeader &query, const Entry &entry)
+{
+  HomeHeader reply (HOMETYPE_REPLY, false, query.GetRequestId (), query.GetNode (), query.GetTarget (),
+                    (uint64_t) entry.position.x, (uint64_t) entry.position.y,
+                    (uint32_t) entry.updated.GetMilliSeconds ());
+  if (IsMyOwnAddress (query.GetNode ()))
+    {
+      RecvReply (reply);
+      return;
+    }
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (reply);
+  m_replyTxTrace (packet);
+  NS_LOG_LOGIC ("Reply to " << query.GetNode () << " for " << query.GetTarget ());
+  m_socket->SendTo (packet, 0, InetSocketAddress (query.GetNode (), HOME_PORT));
+}
+
+void
+HomeRegionLocationService::Recv (Ptr<Socket> socket)
+{
+  Address sourceAddress;
+  Ptr<Packet> packet = socket->RecvFrom (sourceAddress);
+
+  // unicast replies routed by GPSR keep the headers RouteOutput put in front of the payload
+  TypeHeader tHeader (GPSRTYPE_POS);
+  packet->PeekHeader (tHeader);
+  if (tHeader.IsValid ())
+    {
+      packet->RemoveHeader (tHeader);
+      if (tHeader.Get () == GPSRTYPE_POS || tHeader.Get () == GPSRTYPE_POS_CTX)
+        {
+          PositionHeader phdr;
+          packet->RemoveHeader (phdr);
+        }
+      if (tHeader.Get () == GPSRTYPE_POS_CTX || tHeader.Get () == GPSRTYPE_CPOS)
+        {
+          FlowHeader flowHeader;
+          packet->RemoveHeader (flowHeader);
+        }
+    }
+
+  HomeHeader header;
+  packet->RemoveHeader (header);
+  if (!header.IsValid ())
+    {
+      NS_LOG_DEBUG ("Home region message " << packet->GetUid () << " with unknown type received. Ignored");
+      return;
+    }
+  if (header.GetType () == HOMETYPE_REPLY)
+    {
+      RecvReply (header);
+      return;
+    }
+  // in-region rebroadcast, only the nodes of the region take it
+  Ipv4Address about = header.GetType () == HOMETYPE_UPDATE ? header.GetNode () : header.GetTarget ();
+  if (header.IsLocal () && IsInRegion (GetHomeAddress (about), GetMyPosition ()))
+    {
+      HandleInRegion (header);
+    }
+}
+
+void
+HomeRegionLocationService::RecvReply (const HomeHeader &reply)
+{
+  if (!IsMyOwnAddress (reply.GetNode ()))
+    {
+      return;
+    }
+  UpdateEntry (m_table, reply.GetTarget (), Vector (reply.GetPosx (), reply.GetPosy (), 0),
+               MilliSeconds (reply.GetTimestamp ()), CacheTimeout);
+
+  std::map<Ipv4Address, Search>::iterator i = m_searches.find (reply.GetTarget ());
+  if (i == m_searches.end ())
+    {
+      return; // late or duplicate reply
+    }
+  i->second.timeout.Cancel ();
+  Time latency = Simulator::Now () - i->second.start;
+  m_searches.erase (i);
+  NS_LOG_LOGIC ("Found " << reply.GetTarget () << " after " << latency.GetSeconds () << " s");
+  m_lookupTrace (reply.GetTarget (), latency);
+  if (!m_searchDone.IsNull ())
+    {
+      m_searchDone (reply.GetTarget ());
+    }
+}
+
+void
+HomeRegionLocationService::Broadcast (Ptr<Packet> packet)
+{
+  HomeHeader header;
+  packet->PeekHeader (header);
+  if (header.GetType () == HOMETYPE_UPDATE)
+    {
+      m_updateTxTrace (packet);
+    }
+  else
+    {
+      m_queryTxTrace (packet);
+    }
+  m_socket->SendTo (packet, 0, InetSocketAddress (m_ipv4->GetAddress (GetMainInterface (m_ipv4), 0).GetBroadcast (), HOME_PORT));
+}
+
+bool
+HomeRegionLocationService::IsMyOwnAddress (Ipv4Address id)
+{
+  return m_ipv4 && m_ipv4->GetInterfaceForAddress (id) >= 0;
+}
+
+Ipv4Address
+HomeRegionLocationService::GetMainAddress ()
+{
+  return m_ipv4->GetAddress (GetMainInterface (m_ipv4), 0).GetLocal ();
+}
+
+void
+HomeRegionLocationService::UpdateEntry (std::map<Ipv4Address, Entry> &table, Ipv4Address id, Vector position, Time updated, Time lifetime)
+{
+  std::map<Ipv4Address, Entry>::iterator i = table.find (id);
+  if (i != table.end () && i->second.updated > updated)
+    {
+      return;
+    }
+  Entry entry;
+  entry.position = position;
+  entry.updated = updated;
+  entry.expire = Simulator::Now () + lifetime;
+  table[id] = entry;
+}
+
+}   // gpsr
+} // ns3
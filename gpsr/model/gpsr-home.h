@@ -0,0 +1,271 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef GPSR_HOME_H
+#define GPSR_HOME_H
+
+#include <map>
+#include "ns3/header.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/socket.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/callback.h"
+#include "ns3/traced-callback.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/location-service.h"
+
+namespace ns3 {
+namespace gpsr {
+
+/**
+ * \ingroup gpsr
+ * \brief Home region message types
+ *
+ * Chosen apart from the GPSR and RLS message types.
+ */
+enum HomeMessageType
+{
+  HOMETYPE_UPDATE = 20,        //!< position of a node, sent to its home region
+  HOMETYPE_QUERY = 21,         //!< query for a node, sent to its home region
+  HOMETYPE_REPLY = 22,         //!< unicast answer to a query
+};
+
+/**
+ * \ingroup gpsr
+ * \brief Home region update/query/reply header
+ *
+ * An update carries the position of node, a query the position of the
+ * requester (node) so that the reply can be routed back, a reply the
+ * position of target. The local flag marks the one-hop rebroadcast made
+ * inside the home region.
+ */
+class HomeHeader : public Header
+{
+public:
+  /// c-tor
+  HomeHeader (HomeMessageType type = HOMETYPE_UPDATE, bool local = false, uint32_t requestId = 0,
+              Ipv4Address node = Ipv4Address (), Ipv4Address target = Ipv4Address (),
+              uint64_t posx = 0, uint64_t posy = 0, uint32_t timestamp = 0);
+
+  ///\name Header serialization/deserialization
+  //\{
+  static TypeId GetTypeId ();
+  TypeId GetInstanceTypeId () const;
+  uint32_t GetSerializedSize () const;
+  void Serialize (Buffer::Iterator start) const;
+  uint32_t Deserialize (Buffer::Iterator start);
+  void Print (std::ostream &os) const;
+  //\}
+
+  ///\name Fields
+  //\{
+  HomeMessageType GetType () const
+  {
+    return m_type;
+  }
+  bool IsValid () const
+  {
+    return m_valid;
+  }
+  void SetLocal (bool local)
+  {
+    m_local = local;
+  }
+  bool IsLocal () const
+  {
+    return m_local;
+  }
+  uint32_t GetRequestId () const
+  {
+    return m_requestId;
+  }
+  Ipv4Address GetNode () const
+  {
+    return m_node;
+  }
+  Ipv4Address GetTarget () const
+  {
+    return m_target;
+  }
+  uint64_t GetPosx () const
+  {
+    return m_posx;
+  }
+  uint64_t GetPosy () const
+  {
+    return m_posy;
+  }
+  /// Time the position was measured, in milliseconds
+  uint32_t GetTimestamp () const
+  {
+    return m_timestamp;
+  }
+  //\}
+
+private:
+  HomeMessageType m_type;       ///< Message type
+  bool m_valid;                 ///< Indicates if the message is valid
+  bool m_local;                 ///< Rebroadcast inside the home region, not forwarded further
+  uint32_t m_requestId;         ///< Request ID of a query and its reply
+  Ipv4Address m_node;           ///< Updating node or requester
+  Ipv4Address m_target;         ///< Node whose position is looked for
+  uint64_t m_posx;              ///< Node (update, query) or target (reply) position
+  uint64_t m_posy;              ///< Node (update, query) or target (reply) position
+  uint32_t m_timestamp;         ///< Time of the position, ms
+};
+
+std::ostream & operator<< (std::ostream & os, HomeHeader const &);
+
+/**
+ * \ingroup gpsr
+ * \brief Home region location service
+ *
+ * The area is cut into RegionSize-sided regions; every node hashes its
+ * address to one of them, its home region. Each region has a virtual
+ * address (RegionBase + 1 + index) that GetPosition() resolves to the
+ * region centre, so that GPSR routes packets sent to it towards the
+ * region. The first node inside the region that receives such a packet
+ * hands it to this service (RoutingProtocol::RouteInput), which serves it
+ * and rebroadcasts it once to the other nodes of the region.
+ *
+ * Nodes send their position home every UpdateInterval. A query goes to
+ * the home region of the target, any region node that knows the target
+ * replies. Nodes registered with AddStaticNode() are answered from a table
+ * shared by all nodes, without messages, and send no updates.
+ *
+ * Compared to RLS there is no flooding and the lookup cost does not depend
+ * on the distance to the target but on the distance to its home region;
+ * the price is the periodic update traffic of mobile nodes and lookups that
+ * fail when a home region is empty.
+ */
+class HomeRegionLocationService : public LocationService
+{
+public:
+  static TypeId GetTypeId (void);
+  /// UDP port of home region messages
+  static const uint32_t HOME_PORT;
+
+  /// c-tor
+  HomeRegionLocationService ();
+  virtual ~HomeRegionLocationService ();
+  virtual void DoDispose ();
+
+  ///\name From LocationService
+  //\{
+  virtual Time GetEntryUpdateTime (Ipv4Address id);
+  virtual void AddEntry (Ipv4Address id, Vector position);
+  virtual void DeleteEntry (Ipv4Address id);
+  virtual Vector GetPosition (Ipv4Address id);
+  virtual bool IsInSearch (Ipv4Address id);
+  virtual bool HasPosition (Ipv4Address id);
+  virtual void Purge ();
+  virtual void Clear ();
+  //\}
+
+  /// Open the home region socket of the node owning ipv4 and start the updates
+  void Start (Ptr<Ipv4> ipv4);
+
+  /// Called with the target address when a query is answered or given up
+  void SetSearchDoneCallback (Callback<void, Ipv4Address> cb)
+  {
+    m_searchDone = cb;
+  }
+
+  ///\name Preloaded table of static nodes, shared by all nodes
+  //\{
+  static void AddStaticNode (Ipv4Address id, Vector position);
+  static void ClearStaticNodes ();
+  //\}
+
+  /// True if a is the virtual address of a home region
+  bool IsRegionAddress (Ipv4Address a) const;
+  /// True if position lies in the region of the virtual address region
+  bool IsInRegion (Ipv4Address region, Vector position) const;
+  /// Virtual address of the home region of id
+  Ipv4Address GetHomeAddress (Ipv4Address id) const;
+  /// A message sent to a region reached its first node in the region; packet starts with the HomeHeader
+  void RecvInRegion (Ptr<Packet> packet);
+
+  /**
+   * TracedCallback signature for answered queries.
+   * \param target the node that was looked for
+   * \param latency time from the first query to the reply
+   */
+  typedef void (* LookupCallback)(Ipv4Address target, Time latency);
+
+  /**
+   * TracedCallback signature for failed queries.
+   * \param target the node that was looked for
+   */
+  typedef void (* LookupFailedCallback)(Ipv4Address target);
+
+private:
+  /// Known position
+  struct Entry
+  {
+    Vector position;
+    Time updated;               ///< Time the position was measured
+    Time expire;                ///< Time the entry is removed
+  };
+  /// Ongoing query
+  struct Search
+  {
+    uint32_t requestId;         ///< ID of the last query sent
+    uint32_t retries;           ///< Queries sent after the first one
+    Time start;                 ///< Time the first query was sent
+    EventId timeout;
+  };
+
+  double RegionSize;            ///< Side of a region, meters
+  double WorldSize;             ///< Side of the simulated area, meters
+  Ipv4Address RegionBase;       ///< Region i has address RegionBase + 1 + i
+  Time UpdateInterval;          ///< Period of the updates of a mobile node
+  Time EntryTimeout;            ///< Lifetime of a position served by a region node
+  Time CacheTimeout;            ///< Lifetime of a position answered to a query
+  Time QueryTimeout;            ///< Time to wait for a reply before retrying
+  uint32_t QueryRetries;        ///< Queries retried before a search is given up
+  Time MaxJitter;               ///< Maximum jitter of the in-region rebroadcast
+
+  Ptr<Ipv4> m_ipv4;
+  Ptr<Socket> m_socket;
+  uint32_t m_requestId;
+  std::map<Ipv4Address, Entry> m_table;         ///< Positions answered to this node's queries
+  std::map<Ipv4Address, Entry> m_served;        ///< Positions of nodes whose home region this node is in
+  std::map<Ipv4Address, Search> m_searches;
+  Ptr<UniformRandomVariable> m_uniformRandomVariable;
+  Callback<void, Ipv4Address> m_searchDone;
+  EventId m_updateEvent;
+
+  TracedCallback<Ptr<const Packet> > m_updateTxTrace;
+  TracedCallback<Ptr<const Packet> > m_queryTxTrace;
+  TracedCallback<Ptr<const Packet> > m_replyTxTrace;
+  TracedCallback<Ipv4Address, Time> m_lookupTrace;
+  TracedCallback<Ipv4Address> m_lookupFailedTrace;
+
+  static std::map<Ipv4Address, Vector> s_static;
+
+  /// Regions per side
+  uint32_t GetSide () const;
+  Vector GetRegionCenter (Ipv4Address region) const;
+  Vector GetMyPosition () const;
+  void UpdateTimerExpire ();
+  void SendQuery (Ipv4Address target);
+  void QueryExpire (Ipv4Address target);
+  /// Send header to the home region of about, or serve it at once if this node is in it
+  void SendHome (Ipv4Address about, const HomeHeader &header);
+  /// Serve a message that reached the home region
+  void HandleInRegion (const HomeHeader &header);
+  void Recv (Ptr<Socket> socket);
+  void RecvReply (const HomeHeader &reply);
+  void Reply (const HomeHeader &query, const Entry &entry);
+  void Broadcast (Ptr<Packet> packet);
+  bool IsMyOwnAddress (Ipv4Address id);
+  Ipv4Address GetMainAddress ();
+  static void UpdateEntry (std::map<Ipv4Address, Entry> &table, Ipv4Address id, Vector position, Time updated, Time lifetime);
+};
+
+}   // gpsr
+} // ns3
+#endif /* GPSR_HOME_H */
@@ -0,0 +1,39 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "gpsr-ls-batch.h"
+
+namespace ns3 {
+namespace gpsr {
+
+BatchLocationQuery::~BatchLocationQuery ()
+{
+}
+
+void
+BatchLocationQuery::Query (Ptr<LocationService> ls, const std::list<Ipv4Address> &ids, StatusMap &status)
+{
+  BatchLocationQuery *batch = dynamic_cast<BatchLocationQuery *> (PeekPointer (ls));
+  if (batch != 0)
+    {
+      batch->ResolvePositions (ids, status);
+      return;
+    }
+  for (std::list<Ipv4Address>::const_iterator i = ids.begin (); i != ids.end (); ++i)
+    {
+      if (ls->IsInSearch (*i))
+        {
+          status[*i] = POSITION_IN_SEARCH;
+        }
+      else if (ls->HasPosition (*i))
+        {
+          status[*i] = POSITION_FOUND;
+        }
+      else
+        {
+          status[*i] = POSITION_NOT_FOUND;
+        }
+    }
+}
+
+}   // gpsr
+} // ns3
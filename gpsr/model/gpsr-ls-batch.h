@@ -0,0 +1,52 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef GPSR_LS_BATCH_H
+#define GPSR_LS_BATCH_H
+
+#include <list>
+#include <map>
+#include "ns3/ptr.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/location-service.h"
+
+namespace ns3 {
+namespace gpsr {
+
+/**
+ * \ingroup gpsr
+ * \brief Batch position queries on a location service
+ *
+ * Lets RoutingProtocol::CheckQueue resolve every queued destination in a
+ * single call. A location service implements it next to LocationService
+ * when it can do better than one IsInSearch()/HasPosition() pair per
+ * destination, e.g. by merging the misses into one request packet.
+ */
+class BatchLocationQuery
+{
+public:
+  /// Outcome of the query of one destination
+  enum Status
+  {
+    POSITION_FOUND,             //!< position known, queued packets can be sent
+    POSITION_IN_SEARCH,         //!< search running, keep the packets queued
+    POSITION_NOT_FOUND,         //!< search given up, drop the packets
+  };
+  typedef std::map<Ipv4Address, Status> StatusMap;
+
+  virtual ~BatchLocationQuery ();
+
+  /// Resolve all ids at once, filling status for each of them
+  virtual void ResolvePositions (const std::list<Ipv4Address> &ids, StatusMap &status) = 0;
+
+  /**
+   * \brief Batch query on any location service
+   *
+   * Uses ResolvePositions() when ls implements BatchLocationQuery, falls back
+   * to IsInSearch()/HasPosition() per id otherwise.
+   */
+  static void Query (Ptr<LocationService> ls, const std::list<Ipv4Address> &ids, StatusMap &status);
+};
+
+}   // gpsr
+} // ns3
+#endif /* GPSR_LS_BATCH_H */
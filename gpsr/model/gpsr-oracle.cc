@@ -0,0 +1,192 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "gpsr-oracle.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/ipv4.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("GpsrOracle");
+
+namespace ns3 {
+namespace gpsr {
+
+NS_OBJECT_ENSURE_REGISTERED (OracleLocationService);
+
+std::vector<OracleLocationService::Slot> OracleLocationService::s_slots;
+uint32_t OracleLocationService::s_base = 0;
+bool OracleLocationService::s_built = false;
+uint32_t OracleLocationService::s_nodes = 0;
+
+TypeId
+OracleLocationService::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::gpsr::OracleLocationService")
+    .SetParent<LocationService> ()
+    .AddConstructor<OracleLocationService> ()
+  ;
+  return tid;
+}
+
+OracleLocationService::OracleLocationService ()
+{
+}
+
+OracleLocationService::~OracleLocationService ()
+{
+}
+
+void
+OracleLocationService::Build ()
+{
+  if (!s_built)
+    {
+      // the table holds the mobility models, let them go with the simulation
+      Simulator::ScheduleDestroy (&OracleLocationService::Forget);
+    }
+  s_built = true;
+  s_nodes = NodeList::GetNNodes ();
+  uint32_t lowest = 0xffffffff;
+  uint32_t highest = 0;
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Ipv4> ipv4 = (*i)->GetObject<Ipv4> ();
+      if (ipv4 == 0 || ipv4->GetNInterfaces () < 2)
+        {
+          continue;
+        }
+      // every interface address of a multi-radio node resolves to the node
+      for (uint32_t j = 1; j < ipv4->GetNInterfaces (); ++j)
+        {
+          if (ipv4->GetNAddresses (j) == 0)
+            {
+              continue;
+            }
+          uint32_t address = ipv4->GetAddress (j, 0).GetLocal ().Get ();
+          lowest = std::min (lowest, address);
+          highest = std::max (highest, address);
+        }
+    }
+  s_slots.clear ();
+  if (lowest > highest)
+    {
+      return;
+    }
+  NS_ASSERT_MSG (highest - lowest < (1u << 24), "Node addresses too sparse for the oracle table");
+  s_base = lowest;
+  Slot empty;
+  empty.step = -1;
+  s_slots.resize (highest - lowest + 1, empty);
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Ipv4> ipv4 = (*i)->GetObject<Ipv4> ();
+      if (ipv4 == 0 || ipv4->GetNInterfaces () < 2)
+        {
+          continue;
+        }
+      for (uint32_t j = 1; j < ipv4->GetNInterfaces (); ++j)
+        {
+          if (ipv4->GetNAddresses (j) == 0)
+            {
+              continue;
+            }
+          s_slots[ipv4->GetAddress (j, 0).GetLocal ().Get () - s_base].mobility = (*i)->GetObject<MobilityModel> ();
+        }
+    }
+  NS_LOG_DEBUG ("Oracle table of " << s_slots.size () << " slots from " << Ipv4Address (s_base));
+}
+
+void
+OracleLocationService::Forget ()
+{
+  s_slots.clear ();
+  s_built = false;
+  s_nodes = 0;
+}
+
+OracleLocationService::Slot *
+OracleLocationService::Lookup (Ipv4Address id)
+{
+  // built on the first lookup, rebuilt when nodes were created since; forgotten by Simulator::Destroy
+  if (!s_built || NodeList::GetNNodes () != s_nodes)
+    {
+      Build ();
+    }
+  uint32_t index = id.Get () - s_base;
+  if (id.Get () < s_base || index >= s_slots.size () || s_slots[index].mobility == 0)
+    {
+      return 0;
+    }
+  Slot &slot = s_slots[index];
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  if (slot.step != now)
+    {
+      slot.position = slot.mobility->GetPosition ();
+      slot.velocity = slot.mobility->GetVelocity ();
+      slot.step = now;
+    }
+  return &slot;
+}
+
+Vector
+OracleLocationService::GetOraclePosition (Ipv4Address id)
+{
+  Slot *slot = Lookup (id);
+  return slot ? slot->position : GetInvalidPosition ();
+}
+
+Vector
+OracleLocationService::GetOracleVelocity (Ipv4Address id)
+{
+  Slot *slot = Lookup (id);
+  return slot ? slot->velocity : GetInvalidPosition ();
+}
+
+Time
+OracleLocationService::GetEntryUpdateTime (Ipv4Address id)
+{
+  return Simulator::Now ();
+}
+
+void
+OracleLocationService::AddEntry (Ipv4Address id, Vector position)
+{
+}
+
+void
+OracleLocationService::DeleteEntry (Ipv4Address id)
+{
+}
+
+Vector
+OracleLocationService::GetPosition (Ipv4Address id)
+{
+  return GetOraclePosition (id);
+}
+
+bool
+OracleLocationService::IsInSearch (Ipv4Address id)
+{
+  return false;
+}
+
+bool
+OracleLocationService::HasPosition (Ipv4Address id)
+{
+  return Lookup (id) != 0;
+}
+
+void
+OracleLocationService::Purge ()
+{
+}
+
+void
+OracleLocationService::Clear ()
+{
+}
+
+}   // gpsr
+} // ns3
@@ -0,0 +1,78 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef GPSR_ORACLE_H
+#define GPSR_ORACLE_H
+
+#include <vector>
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/mobility-model.h"
+#include "ns3/location-service.h"
+
+namespace ns3 {
+namespace gpsr {
+
+/**
+ * \ingroup gpsr
+ * \brief Oracle location service with an address-indexed node table
+ *
+ * Same answers as GodLocationService, but the addresses of all the
+ * interfaces of every node are resolved, by Build(), into a flat table
+ * indexed by (address - lowest address). The table is built on the first
+ * lookup, once the nodes and their addresses exist, rebuilt when nodes
+ * were created since and dropped by Simulator::Destroy. Positions and velocities are memoized per
+ * simulation time step, so that all queries made at the same instant, by
+ * any node, read the mobility model once.
+ */
+class OracleLocationService : public LocationService
+{
+public:
+  static TypeId GetTypeId (void);
+
+  /// c-tor
+  OracleLocationService ();
+  virtual ~OracleLocationService ();
+
+  ///\name From LocationService
+  //\{
+  virtual Time GetEntryUpdateTime (Ipv4Address id);
+  virtual void AddEntry (Ipv4Address id, Vector position);
+  virtual void DeleteEntry (Ipv4Address id);
+  virtual Vector GetPosition (Ipv4Address id);
+  virtual bool IsInSearch (Ipv4Address id);
+  virtual bool HasPosition (Ipv4Address id);
+  virtual void Purge ();
+  virtual void Clear ();
+  //\}
+
+  /// (Re)build the node table from the NodeList, e.g. after addresses were reassigned
+  static void Build ();
+  /// Current position of the node owning id, GetInvalidPosition () if unknown
+  static Vector GetOraclePosition (Ipv4Address id);
+  /// Current velocity of the node owning id, GetInvalidPosition () if unknown
+  static Vector GetOracleVelocity (Ipv4Address id);
+
+private:
+  struct Slot
+  {
+    Ptr<MobilityModel> mobility;
+    int64_t step;               ///< Time step position and velocity were read at, -1 if never
+    Vector position;
+    Vector velocity;
+  };
+  static std::vector<Slot> s_slots;
+  static uint32_t s_base;       ///< Address of s_slots[0]
+  static bool s_built;
+  static uint32_t s_nodes;      ///< Size of the NodeList when the table was built
+
+  /// Drop the table at Simulator::Destroy
+  static void Forget ();
+
+  /// Slot of id with position and velocity of the current time step, 0 if unknown
+  static Slot * Lookup (Ipv4Address id);
+};
+
+}   // gpsr
+} // ns3
+#endif /* GPSR_ORACLE_H */
@@ -4,6 +4,8 @@
 #include "ns3/address-utils.h"
 #include "ns3/packet.h"
 #include "ns3/log.h"
+#include <algorithm>
+#include <cmath>
 
 NS_LOG_COMPONENT_DEFINE ("GpsrPacket");
 
@@ -56,6 +58,11 @@ TypeHeader::Deserialize (Buffer::Iterator start)
     {
     case GPSRTYPE_HELLO:
     case GPSRTYPE_POS:
+    case GPSRTYPE_POS_CTX:
+    case GPSRTYPE_CPOS:
+    case GPSRTYPE_HELLO_EXT:
+    case GPSRTYPE_CBF:
+    case GPSRTYPE_GEO:
       {
         m_type = (MessageType) type;
         break;
@@ -85,6 +92,31 @@ TypeHeader::Print (std::ostream &os) const
         os << "POSITION";
         break;
       }
+    case GPSRTYPE_POS_CTX:
+      {
+        os << "POSITION_CONTEXT";
+        break;
+      }
+    case GPSRTYPE_CPOS:
+      {
+        os << "COMPRESSED_POSITION";
+        break;
+      }
+    case GPSRTYPE_HELLO_EXT:
+      {
+        os << "HELLO_EXTENDED";
+        break;
+      }
+    case GPSRTYPE_CBF:
+      {
+        os << "CONTENTION_POSITION";
+        break;
+      }
+    case GPSRTYPE_GEO:
+      {
+        os << "GEOCAST";
+        break;
+      }
     default:
       os << "UNKNOWN_TYPE";
     }
@@ -106,9 +138,14 @@ operator<< (std::ostream & os, TypeHeader const & h)
 //-----------------------------------------------------------------------------
 // HELLO
 //-----------------------------------------------------------------------------
-HelloHeader::HelloHeader (uint64_t originPosx, uint64_t originPosy)
+static const uint64_t HELLO_LOAD_FLAG = (uint64_t) 1 << 63;
+
+HelloHeader::HelloHeader (uint64_t originPosx, uint64_t originPosy, uint16_t seqNo)
   : m_originPosx (originPosx),
-    m_originPosy (originPosy)
+    m_originPosy (originPosy),
+    m_seqNo (seqNo),
+    m_load (0),
+    m_hasLoad (false)
 {
 }
 
@@ -133,7 +170,7 @@ HelloHeader::GetInstanceTypeId () const
 uint32_t
 HelloHeader::GetSerializedSize () const
 {
-  return 16;
+  return m_hasLoad ? 19 : 18;
 }
 
 void
@@ -143,7 +180,13 @@ HelloHeader::Serialize (Buffer::Iterator i) const
 
 
   i.WriteHtonU64 (m_originPosx);
-  i.WriteHtonU64 (m_originPosy);
+  // positions are far below 2^63 m: the top bit of y flags the load byte
+  i.WriteHtonU64 (m_hasLoad ? m_originPosy | HELLO_LOAD_FLAG : m_originPosy);
+  i.WriteHtonU16 (m_seqNo);
+  if (m_hasLoad)
+    {
+      i.WriteU8 (m_load);
+    }
 
 }
 
@@ -155,6 +198,10 @@ HelloHeader::Deserialize (Buffer::Iterator start)
 
   m_originPosx = i.ReadNtohU64 ();
   m_originPosy = i.ReadNtohU64 ();
+  m_hasLoad = (m_originPosy & HELLO_LOAD_FLAG) != 0;
+  m_originPosy &= ~HELLO_LOAD_FLAG;
+  m_seqNo = i.ReadNtohU16 ();
+  m_load = m_hasLoad ? i.ReadU8 () : 0;
 
   NS_LOG_DEBUG ("Deserialize X " << m_originPosx << " Y " << m_originPosy);
 
@@ -167,7 +214,9 @@ void
 HelloHeader::Print (std::ostream &os) const
 {
   os << " PositionX: " << m_originPosx
-     << " PositionY: " << m_originPosy;
+     << " PositionY: " << m_originPosy
+     << " SeqNo: " << m_seqNo
+     << " Load: " << (uint32_t) m_load;
 }
 
 std::ostream &
@@ -182,7 +231,8 @@ operator<< (std::ostream & os, HelloHeader const & h)
 bool
 HelloHeader::operator== (HelloHeader const & o) const
 {
-  return (m_originPosx == o.m_originPosx && m_originPosy == o.m_originPosy);
+  return (m_originPosx == o.m_originPosx && m_originPosy == o.m_originPosy && m_seqNo == o.m_seqNo
+          && m_hasLoad == o.m_hasLoad && m_load == o.m_load);
 }
 
 
@@ -200,7 +250,19 @@ PositionHeader::PositionHeader (uint64_t dstPosx, uint64_t dstPosy, uint32_t upd
     m_recPosy (recPosy),
     m_inRec (inRec),
     m_lastPosx (lastPosx),
-    m_lastPosy (lastPosy)
+    m_lastPosy (lastPosy),
+    m_dstVelx (0),
+    m_dstVely (0),
+    m_srcPosx (0),
+    m_srcPosy (0),
+    m_srcVelx (0),
+    m_srcVely (0),
+    m_srcUpdated (0),
+    m_facePosx (0),
+    m_facePosy (0),
+    m_firstEdgeFrom (Ipv4Address::GetZero ()),
+    m_firstEdgeTo (Ipv4Address::GetZero ()),
+    m_perimeterHops (0)
 {
 }
 
@@ -225,7 +287,8 @@ PositionHeader::GetInstanceTypeId () const
 uint32_t
 PositionHeader::GetSerializedSize () const
 {
-  return 53;
+  // the source stamp travels only when set, the perimeter state only with packets in Recovery-mode
+  return 57 + (m_srcUpdated ? 24 : 0) + (m_inRec ? 26 : 0);
 }
 
 //读入buffer
@@ -237,9 +300,28 @@ PositionHeader::Serialize (Buffer::Iterator i) const
   i.WriteU32 (m_updated);
   i.WriteU64 (m_recPosx);
   i.WriteU64 (m_recPosy);
-  i.WriteU8 (m_inRec);
+  // the high bit of the Recovery-mode byte flags a source stamp
+  i.WriteU8 (m_inRec | (m_srcUpdated ? 0x80 : 0));
   i.WriteU64 (m_lastPosx);
   i.WriteU64 (m_lastPosy);
+  i.WriteHtonU16 ((uint16_t) m_dstVelx);
+  i.WriteHtonU16 ((uint16_t) m_dstVely);
+  if (m_srcUpdated)
+    {
+      i.WriteU64 (m_srcPosx);
+      i.WriteU64 (m_srcPosy);
+      i.WriteHtonU16 ((uint16_t) m_srcVelx);
+      i.WriteHtonU16 ((uint16_t) m_srcVely);
+      i.WriteU32 (m_srcUpdated);
+    }
+  if (m_inRec)
+    {
+      i.WriteU64 (m_facePosx);
+      i.WriteU64 (m_facePosy);
+      WriteTo (i, m_firstEdgeFrom);
+      WriteTo (i, m_firstEdgeTo);
+      i.WriteHtonU16 (m_perimeterHops);
+    }
 }
 
 //读出buffer
@@ -252,9 +334,33 @@ PositionHeader::Deserialize (Buffer::Iterator start)
   m_updated = i.ReadU32 ();
   m_recPosx = i.ReadU64 ();
   m_recPosy = i.ReadU64 ();
-  m_inRec = i.ReadU8 ();
+  uint8_t flags = i.ReadU8 ();
+  m_inRec = flags & 0x7f;
   m_lastPosx = i.ReadU64 ();
   m_lastPosy = i.ReadU64 ();
+  m_dstVelx = (int16_t) i.ReadNtohU16 ();
+  m_dstVely = (int16_t) i.ReadNtohU16 ();
+  m_srcPosx = 0;
+  m_srcPosy = 0;
+  m_srcVelx = 0;
+  m_srcVely = 0;
+  m_srcUpdated = 0;
+  if (flags & 0x80)
+    {
+      m_srcPosx = i.ReadU64 ();
+      m_srcPosy = i.ReadU64 ();
+      m_srcVelx = (int16_t) i.ReadNtohU16 ();
+      m_srcVely = (int16_t) i.ReadNtohU16 ();
+      m_srcUpdated = i.ReadU32 ();
+    }
+  if (m_inRec)
+    {
+      m_facePosx = i.ReadU64 ();
+      m_facePosy = i.ReadU64 ();
+      ReadFrom (i, m_firstEdgeFrom);
+      ReadFrom (i, m_firstEdgeTo);
+      m_perimeterHops = i.ReadNtohU16 ();
+    }
 
   uint32_t dist = i.GetDistanceFrom (start);
   NS_ASSERT (dist == GetSerializedSize ());
@@ -271,7 +377,83 @@ PositionHeader::Print (std::ostream &os) const
      << " RecPositionY: " << m_recPosy
      << " inRec: " << m_inRec
      << " LastPositionX: " << m_lastPosx
-     << " LastPositionY: " << m_lastPosy;
+     << " LastPositionY: " << m_lastPosy
+     << " DstVelocity: " << GetDstVelocity ()
+     << " SrcPosition: " << GetSrcPosition ()
+     << " SrcVelocity: " << GetSrcVelocity ()
+     << " SrcUpdated: " << m_srcUpdated;
+  if (m_inRec)
+    {
+      os << " FacePositionX: " << m_facePosx
+         << " FacePositionY: " << m_facePosy
+         << " FirstEdge: " << m_firstEdgeFrom << "->" << m_firstEdgeTo
+         << " PerimeterHops: " << m_perimeterHops;
+    }
+}
+
+static int16_t
+EncodeVelocity (double v)
+{
+  double steps = std::floor (v * 10 + 0.5);
+  return (int16_t) std::max (-32767.0, std::min (32767.0, steps));
+}
+
+void
+PositionHeader::SetDstVelocity (Vector velocity)
+{
+  m_dstVelx = EncodeVelocity (velocity.x);
+  m_dstVely = EncodeVelocity (velocity.y);
+}
+
+Vector
+PositionHeader::GetDstVelocity () const
+{
+  return Vector (m_dstVelx / 10.0, m_dstVely / 10.0, 0);
+}
+
+void
+PositionHeader::SetSource (Vector position, Vector velocity, uint32_t updated)
+{
+  m_srcPosx = position.x;
+  m_srcPosy = position.y;
+  m_srcVelx = EncodeVelocity (velocity.x);
+  m_srcVely = EncodeVelocity (velocity.y);
+  m_srcUpdated = updated;
+}
+
+void
+PositionHeader::CopySource (PositionHeader const & o)
+{
+  m_srcPosx = o.m_srcPosx;
+  m_srcPosy = o.m_srcPosy;
+  m_srcVelx = o.m_srcVelx;
+  m_srcVely = o.m_srcVely;
+  m_srcUpdated = o.m_srcUpdated;
+}
+
+void
+PositionHeader::StartPerimeter (Vector entry)
+{
+  m_inRec = 1;
+  m_recPosx = entry.x;
+  m_recPosy = entry.y;
+  m_facePosx = entry.x;
+  m_facePosy = entry.y;
+  m_firstEdgeFrom = Ipv4Address::GetZero ();
+  m_firstEdgeTo = Ipv4Address::GetZero ();
+  m_perimeterHops = 0;
+}
+
+Vector
+PositionHeader::GetSrcPosition () const
+{
+  return Vector (m_srcPosx, m_srcPosy, 0);
+}
+
+Vector
+PositionHeader::GetSrcVelocity () const
+{
+  return Vector (m_srcVelx / 10.0, m_srcVely / 10.0, 0);
 }
 
 std::ostream &
@@ -286,7 +468,365 @@ operator<< (std::ostream & os, PositionHeader const & h)
 bool
 PositionHeader::operator== (PositionHeader const & o) const
 {
-  return (m_dstPosx == o.m_dstPosx && m_dstPosy == o.m_dstPosy && m_updated == o.m_updated && m_recPosx == o.m_recPosx && m_recPosy == o.m_recPosy && m_inRec == o.m_inRec && m_lastPosx == o.m_lastPosx && m_lastPosy == o.m_lastPosy);
+  return (m_dstPosx == o.m_dstPosx && m_dstPosy == o.m_dstPosy && m_updated == o.m_updated && m_recPosx == o.m_recPosx && m_recPosy == o.m_recPosy && m_inRec == o.m_inRec && m_lastPosx == o.m_lastPosx && m_lastPosy == o.m_lastPosy && m_dstVelx == o.m_dstVelx && m_dstVely == o.m_dstVely
+          && m_srcPosx == o.m_srcPosx && m_srcPosy == o.m_srcPosy && m_srcVelx == o.m_srcVelx && m_srcVely == o.m_srcVely && m_srcUpdated == o.m_srcUpdated
+          && m_facePosx == o.m_facePosx && m_facePosy == o.m_facePosy && m_firstEdgeFrom == o.m_firstEdgeFrom && m_firstEdgeTo == o.m_firstEdgeTo && m_perimeterHops == o.m_perimeterHops);
+}
+
+
+//-----------------------------------------------------------------------------
+// Flow
+//-----------------------------------------------------------------------------
+FlowHeader::FlowHeader (uint16_t flowId, uint32_t version)
+  : m_flowId (flowId),
+    m_version (version)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED (FlowHeader);
+
+TypeId
+FlowHeader::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::gpsr::FlowHeader")
+    .SetParent<Header> ()
+    .AddConstructor<FlowHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+FlowHeader::GetInstanceTypeId () const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+FlowHeader::GetSerializedSize () const
+{
+  return 6;
+}
+
+void
+FlowHeader::Serialize (Buffer::Iterator i) const
+{
+  i.WriteHtonU16 (m_flowId);
+  i.WriteHtonU32 (m_version);
+}
+
+uint32_t
+FlowHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_flowId = i.ReadNtohU16 ();
+  m_version = i.ReadNtohU32 ();
+
+  uint32_t dist = i.GetDistanceFrom (start);
+  NS_ASSERT (dist == GetSerializedSize ());
+  return dist;
+}
+
+void
+FlowHeader::Print (std::ostream &os) const
+{
+  os << " FlowId: " << m_flowId
+     << " Version: " << m_version;
+}
+
+std::ostream &
+operator<< (std::ostream & os, FlowHeader const & h)
+{
+  h.Print (os);
+  return os;
+}
+
+bool
+FlowHeader::operator== (FlowHeader const & o) const
+{
+  return (m_flowId == o.m_flowId && m_version == o.m_version);
+}
+
+//-----------------------------------------------------------------------------
+// Neighbour summary
+//-----------------------------------------------------------------------------
+NeighborSummaryHeader::NeighborSummaryHeader (uint8_t quantum)
+  : m_quantum (quantum)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED (NeighborSummaryHeader);
+
+TypeId
+NeighborSummaryHeader::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::gpsr::NeighborSummaryHeader")
+    .SetParent<Header> ()
+    .AddConstructor<NeighborSummaryHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+NeighborSummaryHeader::GetInstanceTypeId () const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+NeighborSummaryHeader::GetSerializedSize () const
+{
+  return 2 + 2 * m_offsets.size ();
+}
+
+void
+NeighborSummaryHeader::Serialize (Buffer::Iterator i) const
+{
+  i.WriteU8 (m_quantum);
+  i.WriteU8 (m_offsets.size ());
+  for (std::vector<std::pair<int8_t, int8_t> >::const_iterator j = m_offsets.begin (); j != m_offsets.end (); ++j)
+    {
+      i.WriteU8 ((uint8_t) j->first);
+      i.WriteU8 ((uint8_t) j->second);
+    }
+}
+
+uint32_t
+NeighborSummaryHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_quantum = i.ReadU8 ();
+  uint8_t count = i.ReadU8 ();
+  m_offsets.clear ();
+  for (uint8_t j = 0; j < count; ++j)
+    {
+      int8_t x = (int8_t) i.ReadU8 ();
+      int8_t y = (int8_t) i.ReadU8 ();
+      m_offsets.push_back (std::make_pair (x, y));
+    }
+
+  uint32_t dist = i.GetDistanceFrom (start);
+  NS_ASSERT (dist == GetSerializedSize ());
+  return dist;
+}
+
+void
+NeighborSummaryHeader::Print (std::ostream &os) const
+{
+  os << " Quantum: " << (uint32_t) m_quantum
+     << " Neighbors: " << m_offsets.size ();
+}
+
+bool
+NeighborSummaryHeader::AddNeighbor (Vector offset)
+{
+  if (m_offsets.size () == 255 || m_quantum == 0)
+    {
+      return false;
+    }
+  double x = std::floor (offset.x / m_quantum + 0.5);
+  double y = std::floor (offset.y / m_quantum + 0.5);
+  if (x < -127 || x > 127 || y < -127 || y > 127)
+    {
+      return false;
+    }
+  m_offsets.push_back (std::make_pair ((int8_t) x, (int8_t) y));
+  return true;
+}
+
+Vector
+NeighborSummaryHeader::GetNeighbor (uint32_t i) const
+{
+  return Vector (m_offsets[i].first * m_quantum, m_offsets[i].second * m_quantum, 0);
+}
+
+std::ostream &
+operator<< (std::ostream & os, NeighborSummaryHeader const & h)
+{
+  h.Print (os);
+  return os;
+}
+
+bool
+NeighborSummaryHeader::operator== (NeighborSummaryHeader const & o) const
+{
+  return (m_quantum == o.m_quantum && m_offsets == o.m_offsets);
+}
+
+
+//-----------------------------------------------------------------------------
+// GEOCAST
+//-----------------------------------------------------------------------------
+GeocastHeader::GeocastHeader (GeocastMode mode)
+  : m_mode (mode),
+    m_perimeter (false),
+    m_lastPosx (0),
+    m_lastPosy (0)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED (GeocastHeader);
+
+TypeId
+GeocastHeader::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::gpsr::GeocastHeader")
+    .SetParent<Header> ()
+    .AddConstructor<GeocastHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+GeocastHeader::GetInstanceTypeId () const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+GeocastHeader::GetSerializedSize () const
+{
+  return 2 + 8 * m_vertices.size () + 8;
+}
+
+void
+GeocastHeader::Serialize (Buffer::Iterator i) const
+{
+  i.WriteU8 ((uint8_t) m_mode | (m_perimeter ? 0x80 : 0));
+  i.WriteU8 (m_vertices.size ());
+  for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator j = m_vertices.begin (); j != m_vertices.end (); ++j)
+    {
+      i.WriteHtonU32 (j->first);
+      i.WriteHtonU32 (j->second);
+    }
+  i.WriteHtonU32 (m_lastPosx);
+  i.WriteHtonU32 (m_lastPosy);
+}
+
+uint32_t
+GeocastHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  uint8_t mode = i.ReadU8 ();
+  m_mode = (GeocastMode) (mode & 0x7f);
+  m_perimeter = (mode & 0x80) != 0;
+  uint8_t count = i.ReadU8 ();
+  m_vertices.clear ();
+  for (uint8_t j = 0; j < count; ++j)
+    {
+      uint32_t x = i.ReadNtohU32 ();
+      uint32_t y = i.ReadNtohU32 ();
+      m_vertices.push_back (std::make_pair (x, y));
+    }
+  m_lastPosx = i.ReadNtohU32 ();
+  m_lastPosy = i.ReadNtohU32 ();
+
+  uint32_t dist = i.GetDistanceFrom (start);
+  NS_ASSERT (dist == GetSerializedSize ());
+  return dist;
+}
+
+void
+GeocastHeader::Print (std::ostream &os) const
+{
+  os << (m_mode == GPSR_ANYCAST ? " Anycast" : " Geocast")
+     << " Vertices: " << m_vertices.size ()
+     << " LastPosition: " << m_lastPosx << "," << m_lastPosy;
+  if (m_perimeter)
+    {
+      os << " Perimeter";
+    }
+}
+
+bool
+GeocastHeader::AddVertex (Vector vertex)
+{
+  if (m_vertices.size () == 255)
+    {
+      return false;
+    }
+  m_vertices.push_back (std::make_pair ((uint32_t) vertex.x, (uint32_t) vertex.y));
+  return true;
+}
+
+Vector
+GeocastHeader::GetVertex (uint32_t i) const
+{
+  return Vector (m_vertices[i].first, m_vertices[i].second, 0);
+}
+
+void
+GeocastHeader::SetLastPos (Vector position)
+{
+  m_lastPosx = (uint32_t) position.x;
+  m_lastPosy = (uint32_t) position.y;
+}
+
+Vector
+GeocastHeader::GetLastPos () const
+{
+  return Vector (m_lastPosx, m_lastPosy, 0);
+}
+
+bool
+GeocastHeader::IsInside (Vector position) const
+{
+  bool inside = false;
+  for (uint32_t i = 0, j = m_vertices.size () - 1; i < m_vertices.size (); j = i++)
+    {
+      Vector a = GetVertex (i);
+      Vector b = GetVertex (j);
+      if ((a.y > position.y) != (b.y > position.y)
+          && position.x < (b.x - a.x) * (position.y - a.y) / (b.y - a.y) + a.x)
+        {
+          inside = !inside;
+        }
+    }
+  return inside;
+}
+
+Vector
+GeocastHeader::GetCentroid () const
+{
+  Vector centroid (0, 0, 0);
+  if (m_vertices.empty ())
+    {
+      return centroid;
+    }
+  for (uint32_t i = 0; i < m_vertices.size (); ++i)
+    {
+      centroid.x += m_vertices[i].first;
+      centroid.y += m_vertices[i].second;
+    }
+  centroid.x /= m_vertices.size ();
+  centroid.y /= m_vertices.size ();
+  return centroid;
+}
+
+std::ostream &
+operator<< (std::ostream & os, GeocastHeader const & h)
+{
+  h.Print (os);
+  return os;
+}
+
+bool
+GeocastHeader::operator== (GeocastHeader const & o) const
+{
+  return (m_mode == o.m_mode && m_perimeter == o.m_perimeter && m_vertices == o.m_vertices
+          && m_lastPosx == o.m_lastPosx && m_lastPosy == o.m_lastPosy);
+}
+
+uint32_t
+GetMainInterface (Ptr<Ipv4> ipv4)
+{
+  for (uint32_t i = 0; i < ipv4->GetNInterfaces (); ++i)
+    {
+      if (ipv4->GetNAddresses (i) > 0 && ipv4->GetAddress (i, 0).GetLocal () != Ipv4Address::GetLoopback ())
+        {
+          return i;
+        }
+    }
+  return 0;
 }
 
 
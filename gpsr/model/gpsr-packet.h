@@ -7,7 +7,9 @@
 #include "ns3/header.h"
 #include "ns3/enum.h"
 #include "ns3/ipv4-address.h"
+#include "ns3/ipv4.h"
 #include <map>
+#include <vector>
 #include "ns3/nstime.h"
 #include "ns3/vector.h"
 
@@ -20,6 +22,18 @@ enum MessageType
 {
   GPSRTYPE_HELLO  = 1,         //!< GPSRTYPE_HELLO
   GPSRTYPE_POS = 2,            //!< GPSRTYPE_POS
+  GPSRTYPE_POS_CTX = 3,        //!< GPSRTYPE_POS followed by a FlowHeader, installs a flow context at the receiver
+  GPSRTYPE_CPOS = 4,           //!< compressed position: only a FlowHeader, the receiver restores the rest from its context
+  GPSRTYPE_HELLO_EXT = 5,      //!< GPSRTYPE_HELLO followed by a NeighborSummaryHeader
+  GPSRTYPE_CBF = 6,            //!< GPSRTYPE_POS sent to all neighbours, the receivers contend to forward it
+  GPSRTYPE_GEO = 7,            //!< GeocastHeader: the packet is routed to the nodes of a region instead of one node
+};
+
+/// Receivers of a packet routed to a region
+enum GeocastMode
+{
+  GPSR_GEOCAST = 0,            //!< every node inside the region
+  GPSR_ANYCAST = 1,            //!< the first node inside the region the packet reaches
 };
 
 /**
@@ -64,7 +78,7 @@ class HelloHeader : public Header
 {
 public:
   /// c-tor
-  HelloHeader (uint64_t originPosx = 0, uint64_t originPosy = 0);
+  HelloHeader (uint64_t originPosx = 0, uint64_t originPosy = 0, uint16_t seqNo = 0);
 
   ///\name Header serialization/deserialization
   //\{
@@ -94,6 +108,28 @@ public:
   {
     return m_originPosy;
   }
+  void SetSeqNo (uint16_t seqNo)
+  {
+    m_seqNo = seqNo;
+  }
+  uint16_t GetSeqNo () const
+  {
+    return m_seqNo;
+  }
+  /// MAC queue occupancy of the sender, 0 (empty) to 255 (full); serialized only once set
+  void SetLoad (uint8_t load)
+  {
+    m_load = load;
+    m_hasLoad = true;
+  }
+  uint8_t GetLoad () const
+  {
+    return m_load;
+  }
+  bool HasLoad () const
+  {
+    return m_hasLoad;
+  }
   //\}
 
 
@@ -101,6 +137,9 @@ public:
 private:
   uint64_t         m_originPosx;          ///< Originator Position x
   uint64_t         m_originPosy;          ///< Originator Position x
+  uint16_t         m_seqNo;               ///< HELLO sequence number, lets receivers count lost beacons
+  uint8_t          m_load;                ///< Queue occupancy of the sending interface
+  bool             m_hasLoad;             ///< m_load is carried, flagged by the top bit of the serialized y position
 };
 
 std::ostream & operator<< (std::ostream & os, HelloHeader const &);
@@ -187,7 +226,57 @@ public:
   {
     return m_lastPosy;
   }
+  /// Destination velocity, carried in 0.1 m/s steps and clamped to +-3276.7 m/s
+  void SetDstVelocity (Vector velocity);
+  Vector GetDstVelocity () const;
+  /// Position, velocity and time (ms) of the packet source when it was sent, updated 0 if absent (not serialized)
+  void SetSource (Vector position, Vector velocity, uint32_t updated);
+  /// Carry the source stamp of another header unchanged
+  void CopySource (PositionHeader const & o);
+  Vector GetSrcPosition () const;
+  Vector GetSrcVelocity () const;
+  uint32_t GetSrcUpdated () const
+  {
+    return m_srcUpdated;
+  }
 
+  ///\name Perimeter state, serialized only in Recovery-mode
+  //\{
+  /// Enter Recovery-mode at entry: Lp and Lf are set to entry, the first edge and hop count are cleared
+  void StartPerimeter (Vector entry);
+  /// Point where the packet entered the current face (Lf)
+  void SetFacePos (Vector position)
+  {
+    m_facePosx = position.x;
+    m_facePosy = position.y;
+  }
+  Vector GetFacePos () const
+  {
+    return Vector (m_facePosx, m_facePosy, 0);
+  }
+  /// First edge (e0) taken on the current face
+  void SetFirstEdge (Ipv4Address from, Ipv4Address to)
+  {
+    m_firstEdgeFrom = from;
+    m_firstEdgeTo = to;
+  }
+  Ipv4Address GetFirstEdgeFrom () const
+  {
+    return m_firstEdgeFrom;
+  }
+  Ipv4Address GetFirstEdgeTo () const
+  {
+    return m_firstEdgeTo;
+  }
+  void SetPerimeterHops (uint16_t hops)
+  {
+    m_perimeterHops = hops;
+  }
+  uint16_t GetPerimeterHops () const
+  {
+    return m_perimeterHops;
+  }
+  //\}
 
   bool operator== (PositionHeader const & o) const;
 private:
@@ -199,11 +288,209 @@ private:
   uint8_t          m_inRec;          ///< 1 if in Recovery-mode, 0 otherwise
   uint64_t         m_lastPosx;          ///< x of position of previous hop
   uint64_t         m_lastPosy;          ///< y of position of previous hop
+  int16_t          m_dstVelx;          ///< Destination velocity x, 0.1 m/s
+  int16_t          m_dstVely;          ///< Destination velocity y, 0.1 m/s
+  uint64_t         m_srcPosx;          ///< Source position x when the packet was sent
+  uint64_t         m_srcPosy;          ///< Source position y when the packet was sent
+  int16_t          m_srcVelx;          ///< Source velocity x, 0.1 m/s
+  int16_t          m_srcVely;          ///< Source velocity y, 0.1 m/s
+  uint32_t         m_srcUpdated;          ///< Time the source stamp was taken, ms
+  uint64_t         m_facePosx;          ///< x of the point the current face was entered at
+  uint64_t         m_facePosy;          ///< y of the point the current face was entered at
+  Ipv4Address      m_firstEdgeFrom;          ///< Sender of the first edge on the current face
+  Ipv4Address      m_firstEdgeTo;          ///< Receiver of the first edge on the current face
+  uint16_t         m_perimeterHops;          ///< Hops made in Recovery-mode
 
 };
 
 std::ostream & operator<< (std::ostream & os, PositionHeader const &);
 
+/**
+ * \ingroup gpsr
+ * \brief Minimal header of a compressed flow
+ *
+ * Identifies the per-hop context (destination position and update time)
+ * installed by the last GPSRTYPE_POS_CTX packet of the flow. The flow is
+ * keyed by the IP source and the flow ID; the version is the destination
+ * position quantised to a grid, so it only changes when the destination
+ * really moves and the receiver's context is within one square of it.
+ */
+class FlowHeader : public Header
+{
+public:
+  /// c-tor
+  FlowHeader (uint16_t flowId = 0, uint32_t version = 0);
+
+  ///\name Header serialization/deserialization
+  //\{
+  static TypeId GetTypeId ();
+  TypeId GetInstanceTypeId () const;
+  uint32_t GetSerializedSize () const;
+  void Serialize (Buffer::Iterator start) const;
+  uint32_t Deserialize (Buffer::Iterator start);
+  void Print (std::ostream &os) const;
+  //\}
+
+  ///\name Fields
+  //\{
+  void SetFlowId (uint16_t flowId)
+  {
+    m_flowId = flowId;
+  }
+  uint16_t GetFlowId () const
+  {
+    return m_flowId;
+  }
+  void SetVersion (uint32_t version)
+  {
+    m_version = version;
+  }
+  uint32_t GetVersion () const
+  {
+    return m_version;
+  }
+  //\}
+
+  bool operator== (FlowHeader const & o) const;
+private:
+  uint16_t         m_flowId;           ///< Flow ID chosen by the source
+  uint32_t         m_version;          ///< Grid square of the destination position
+};
+
+std::ostream & operator<< (std::ostream & os, FlowHeader const &);
+
+/**
+ * \ingroup gpsr
+ * \brief Neighbour positions of the sender of an extended HELLO
+ *
+ * Every neighbour is an offset from the sender position, quantized to
+ * multiples of the quantum (meters) in one signed byte per axis, so that a
+ * neighbour costs two bytes. Neighbours further than 127 quanta on an axis
+ * are not representable and are left out.
+ */
+class NeighborSummaryHeader : public Header
+{
+public:
+  /// c-tor
+  NeighborSummaryHeader (uint8_t quantum = 4);
+
+  ///\name Header serialization/deserialization
+  //\{
+  static TypeId GetTypeId ();
+  TypeId GetInstanceTypeId () const;
+  uint32_t GetSerializedSize () const;
+  void Serialize (Buffer::Iterator start) const;
+  uint32_t Deserialize (Buffer::Iterator start);
+  void Print (std::ostream &os) const;
+  //\}
+
+  ///\name Fields
+  //\{
+  uint8_t GetQuantum () const
+  {
+    return m_quantum;
+  }
+  /// Add a neighbour at offset from the sender, \return false if it is out of reach or the header is full
+  bool AddNeighbor (Vector offset);
+  uint32_t GetNeighborCount () const
+  {
+    return m_offsets.size ();
+  }
+  /// Offset of neighbour i from the sender, meters
+  Vector GetNeighbor (uint32_t i) const;
+  //\}
+
+  bool operator== (NeighborSummaryHeader const & o) const;
+private:
+  uint8_t          m_quantum;          ///< Meters per unit of an offset
+  std::vector<std::pair<int8_t, int8_t> > m_offsets;  ///< Quantized x and y offsets
+};
+
+std::ostream & operator<< (std::ostream & os, NeighborSummaryHeader const &);
+
+/**
+ * \ingroup gpsr
+ * \brief Target region of a geocast or anycast packet
+ *
+ * The region is a simple polygon, its vertices and the position of the last
+ * transmitter are whole meters on 32 bits. Outside the region the packet is
+ * forwarded greedily towards the centroid of the vertices; where greedy
+ * forwarding fails it is flagged as in perimeter mode and a PositionHeader
+ * carrying the face routing state towards the centroid follows this header.
+ */
+class GeocastHeader : public Header
+{
+public:
+  /// c-tor
+  GeocastHeader (GeocastMode mode = GPSR_GEOCAST);
+
+  ///\name Header serialization/deserialization
+  //\{
+  static TypeId GetTypeId ();
+  TypeId GetInstanceTypeId () const;
+  uint32_t GetSerializedSize () const;
+  void Serialize (Buffer::Iterator start) const;
+  uint32_t Deserialize (Buffer::Iterator start);
+  void Print (std::ostream &os) const;
+  //\}
+
+  ///\name Fields
+  //\{
+  void SetMode (GeocastMode mode)
+  {
+    m_mode = mode;
+  }
+  GeocastMode GetMode () const
+  {
+    return m_mode;
+  }
+  /// Append a vertex to the polygon, \return false if the header is full
+  bool AddVertex (Vector vertex);
+  uint32_t GetVertexCount () const
+  {
+    return m_vertices.size ();
+  }
+  Vector GetVertex (uint32_t i) const;
+  /// Position of the node that sent the packet
+  void SetLastPos (Vector position);
+  Vector GetLastPos () const;
+  /// A PositionHeader in Recovery-mode follows, flagged by the top bit of the serialized mode
+  void SetPerimeter (bool perimeter)
+  {
+    m_perimeter = perimeter;
+  }
+  bool IsPerimeter () const
+  {
+    return m_perimeter;
+  }
+  //\}
+
+  /// Whether position lies inside the polygon (even-odd rule)
+  bool IsInside (Vector position) const;
+  /// Mean of the vertices, the target of greedy forwarding outside the region
+  Vector GetCentroid () const;
+
+  bool operator== (GeocastHeader const & o) const;
+private:
+  GeocastMode      m_mode;
+  bool             m_perimeter;        ///< Face routing towards the centroid
+  std::vector<std::pair<uint32_t, uint32_t> > m_vertices;  ///< Polygon, in order
+  uint32_t         m_lastPosx;         ///< Last transmitter position x
+  uint32_t         m_lastPosy;         ///< Last transmitter position y
+};
+
+std::ostream & operator<< (std::ostream & os, GeocastHeader const &);
+
+/**
+ * \ingroup gpsr
+ * \brief Main interface of a node: the first one that is not the loopback
+ *
+ * Its address identifies the node in the routing and location service
+ * messages, its broadcast address is the one of the location services and
+ * of beaconless forwarding.
+ */
+uint32_t GetMainInterface (Ptr<Ipv4> ipv4);
+
 }
 }
 #endif /* GPSRPACKET_H */
@@ -2,6 +2,8 @@
 #include "ns3/simulator.h"
 #include "ns3/log.h"
 #include <algorithm>
+#include <functional>
+#include <limits>
 #include <cmath>
 
 NS_LOG_COMPONENT_DEFINE ("GpsrTable");
@@ -15,6 +17,15 @@ namespace gpsr {
  */
 
 PositionTable::PositionTable ()
+  : m_version (0),
+    m_drift (0),
+    m_defaultRange (250),
+    m_deadEndsAvoided (0),
+    m_loadTolerance (0),
+    m_multipathCandidates (1),
+    m_multipathTolerance (0.1),
+    m_multipathSpreads (0),
+    m_loadDetours (0)
 {
         m_txErrorCallback = MakeCallback (&PositionTable::ProcessTxError, this);
         m_entryLifeTime = Seconds (2); //FIXME fazer isto parametrizavel de acordo com tempo de hello
@@ -37,16 +48,24 @@ PositionTable::GetEntryUpdateTime (Ipv4Address id)
  */
 //TODO finish velocity
 void
-PositionTable::AddEntry (Ipv4Address id, Vector position)
+PositionTable::AddEntry (Ipv4Address id, Vector position, uint32_t interface)
 {
         std::map<Ipv4Address, Metrix >::iterator i = m_table.find (id);
 
         //id在table中，更新table,增加位置和速度信息
         if (i != m_table.end () || id.IsEqual (i->first))
         {
+                m_drift += CalculateDistance (i->second.position, position);
+                double range = i->second.range;
+                std::vector<Vector> twoHop = i->second.twoHop;
+                uint8_t load = i->second.load;
                 m_table.erase (id);
                 Metrix metrix;
                 metrix.position=position;
+                metrix.interface=interface;
+                metrix.range=range;
+                metrix.twoHop=twoHop;
+                metrix.load=load;
                 //metrix.velocity=velocity;
                 metrix.time=Simulator::Now ();
                 m_table.insert (std::make_pair (id, metrix));
@@ -54,19 +73,202 @@ PositionTable::AddEntry (Ipv4Address id, Vector position)
         }
 
         //id不在table，增加id
+        m_version++;
         Metrix metrix;
         metrix.position=position;
+        metrix.interface=interface;
+        metrix.range=0;
+        metrix.load=0;
         metrix.time=Simulator::Now ();
         m_table.insert (std::make_pair (id, metrix));
 
 }
 
+double
+PositionTable::GetProgressMargin (Vector position, Vector nodePos)
+{
+        double margin = std::numeric_limits<double>::max ();
+        double distance = CalculateDistance (nodePos, position);
+        for (std::map<Ipv4Address, Metrix>::iterator i = m_table.begin (); i != m_table.end (); ++i)
+        {
+                margin = std::min (margin, CalculateDistance (i->second.position, position) - distance);
+        }
+        return margin;
+}
+
+void
+PositionTable::SetTwoHop (Ipv4Address id, const std::vector<Vector> &positions)
+{
+        std::map<Ipv4Address, Metrix>::iterator i = m_table.find (id);
+        if (i != m_table.end ())
+        {
+                i->second.twoHop = positions;
+        }
+}
+
+void
+PositionTable::GetNeighborPositions (std::vector<Vector> &positions)
+{
+        Purge ();
+        positions.clear ();
+        for (std::map<Ipv4Address, Metrix>::const_iterator i = m_table.begin (); i != m_table.end (); ++i)
+        {
+                positions.push_back (i->second.position);
+        }
+}
+
+//邻居广播过自己的邻居，且没有一个比它更接近目的地：贪婪转发到它会进入恢复模式
+bool
+PositionTable::IsDeadEnd (Ipv4Address id, Vector position)
+{
+        Metrix const &entry = m_table[id];
+        if (entry.twoHop.empty ())
+        {
+                return false;
+        }
+        double distance = CalculateDistance (entry.position, position);
+        //the destination itself, or in its range but left out of a capped summary
+        if (distance < 1 || distance <= GetRange (id))
+        {
+                return false;
+        }
+        for (std::vector<Vector>::const_iterator j = entry.twoHop.begin (); j != entry.twoHop.end (); ++j)
+        {
+                if (CalculateDistance (*j, position) < distance)
+                {
+                        return false;
+                }
+        }
+        return true;
+}
+
+void
+PositionTable::SetLoad (Ipv4Address id, uint8_t load)
+{
+        std::map<Ipv4Address, Metrix>::iterator i = m_table.find (id);
+        if (i != m_table.end ())
+        {
+                i->second.load = load;
+        }
+}
+
+//得分和最优相差在容差内的前k个候选里按流哈希选一个，同一个流总是选到同一个
+Ipv4Address
+PositionTable::SpreadFlow (Ipv4Address chosen, double chosenPara, uint32_t flowHash)
+{
+        double minPara = chosenPara - m_multipathTolerance * std::fabs (chosenPara);
+        std::vector<std::pair<double, Ipv4Address> > nearEqual;
+        for (std::vector<std::pair<double, Ipv4Address> >::const_iterator i = m_scores.begin (); i != m_scores.end (); ++i)
+        {
+                if (i->first >= minPara)
+                {
+                        nearEqual.push_back (*i);
+                }
+        }
+        if (nearEqual.size () < 2)
+        {
+                return chosen;
+        }
+        //best first, by address on equal scores, so that the order does not depend on the table
+        std::sort (nearEqual.begin (), nearEqual.end (), std::greater<std::pair<double, Ipv4Address> > ());
+        uint32_t count = std::min<uint32_t> (nearEqual.size (), m_multipathCandidates);
+        Ipv4Address picked = nearEqual[flowHash % count].second;
+        if (picked != chosen)
+        {
+                m_multipathSpreads++;
+        }
+        return picked;
+}
+
+//没有邻居更接近目的时，把包交给朝目的开得最快的邻居携带
+Ipv4Address
+PositionTable::BestCarrier (Vector position, double minSpeed)
+{
+        Purge ();
+        Ipv4Address bestID = Ipv4Address::GetZero ();
+        double bestSpeed = minSpeed;
+        for (std::map<Ipv4Address, Metrix>::const_iterator i = m_table.begin (); i != m_table.end (); ++i)
+        {
+                double speed = ApproachSpeed (i->second.position, GetVelocity (i->first), position);
+                if (speed > bestSpeed)
+                {
+                        bestID = i->first;
+                        bestSpeed = speed;
+                }
+        }
+        return bestID;
+}
+
+double
+PositionTable::ApproachSpeed (Vector from, Vector velocity, Vector position)
+{
+        double dx = position.x - from.x;
+        double dy = position.y - from.y;
+        double distance = std::sqrt (dx * dx + dy * dy);
+        if (distance == 0)
+        {
+                return std::numeric_limits<double>::max ();
+        }
+        return (velocity.x * dx + velocity.y * dy) / distance;
+}
+
+//前进距离和选中的下一跳相差不超过容差的邻居里，选队列最空的；一样空时保留原来的选择
+Ipv4Address
+PositionTable::LeastLoaded (Ipv4Address chosen, Vector position, double distance)
+{
+        Metrix const &best = m_table[chosen];
+        double maxDistance = std::min (CalculateDistance (best.position, position) + m_loadTolerance, distance);
+        Ipv4Address leastID = chosen;
+        uint8_t leastLoad = best.load;
+        for (std::map<Ipv4Address, Metrix>::const_iterator i = m_table.begin (); i != m_table.end () && leastLoad > 0; ++i)
+        {
+                double remaining = CalculateDistance (i->second.position, position);
+                if (i->second.load < leastLoad
+                    && remaining <= maxDistance && remaining < distance
+                    && !IsDeadEnd (i->first, position))
+                {
+                        leastID = i->first;
+                        leastLoad = i->second.load;
+                }
+        }
+        if (leastID != chosen)
+        {
+                NS_LOG_DEBUG ("Next hop " << chosen << " loaded " << (uint32_t) best.load << ", taking " << leastID);
+                m_loadDetours++;
+        }
+        return leastID;
+}
+
+void
+PositionTable::SetRange (Ipv4Address id, double range)
+{
+        std::map<Ipv4Address, Metrix>::iterator i = m_table.find (id);
+        if (i != m_table.end ())
+        {
+                i->second.range = range;
+        }
+}
+
+double
+PositionTable::GetRange (Ipv4Address id)
+{
+        std::map<Ipv4Address, Metrix>::iterator i = m_table.find (id);
+        if (i == m_table.end () || i->second.range <= 0)
+        {
+                return m_defaultRange;
+        }
+        return i->second.range;
+}
+
 /**
  * \brief Deletes entry in position table
  */
 void PositionTable::DeleteEntry (Ipv4Address id)
 {
-        m_table.erase (id);
+        if (m_table.erase (id))
+        {
+                m_version++;
+        }
 }
 
 /**
@@ -78,38 +280,17 @@ void PositionTable::DeleteEntry (Ipv4Address id)
 //获取对应address节点的位置信息
 //TODO 增加获取获取速度信息——>更可以考虑获取传输速率信息
 
+//地址到节点的解析用oracle的索引表，不再遍历NodeList
 Vector
 PositionTable::GetPosition (Ipv4Address id)
 {
-
-        NodeList::Iterator listEnd = NodeList::End ();
-        for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
-        {
-                Ptr<Node> node = *i;
-                if (node->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal () == id)
-                {
-                        return node->GetObject<MobilityModel> ()->GetPosition ();
-                }
-        }
-        return PositionTable::GetInvalidPosition ();
-
+        return OracleLocationService::GetOraclePosition (id);
 }
 
 Vector
 PositionTable::GetVelocity (Ipv4Address id)
 {
-
-        NodeList::Iterator listEnd = NodeList::End ();
-        for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
-        {
-                Ptr<Node> node = *i;
-                if (node->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal () == id)
-                {
-                        return node->GetObject<MobilityModel> ()->GetVelocity ();
-                }
-        }
-        return PositionTable::GetInvalidVelocity ();
-
+        return OracleLocationService::GetOracleVelocity (id);
 }
 
 
@@ -133,6 +314,50 @@ PositionTable::isNeighbour (Ipv4Address id)
 }
 
 
+uint32_t
+PositionTable::GetNeighborCount ()
+{
+        Purge ();
+        return m_table.size ();
+}
+
+uint32_t
+PositionTable::GetNeighborCount (uint32_t interface)
+{
+        Purge ();
+        uint32_t count = 0;
+        for (std::map<Ipv4Address, Metrix>::const_iterator i = m_table.begin (); i != m_table.end (); ++i)
+        {
+                if (i->second.interface == interface)
+                {
+                        count++;
+                }
+        }
+        return count;
+}
+
+uint32_t
+PositionTable::GetInterface (Ipv4Address id)
+{
+        std::map<Ipv4Address, Metrix>::const_iterator i = m_table.find (id);
+        if (i == m_table.end ())
+        {
+                return 0;
+        }
+        return i->second.interface;
+}
+
+uint16_t
+PositionTable::GetMetric (uint32_t interface) const
+{
+        std::map<uint32_t, uint16_t>::const_iterator i = m_metrics.find (interface);
+        if (i == m_metrics.end ())
+        {
+                return 1;
+        }
+        return i->second;
+}
+
 /**
  * \brief remove entries with expired lifetime
  */
@@ -169,6 +394,7 @@ PositionTable::Purge ()
         {
 
                 m_table.erase (*it); //删除表中对应列表的地址id
+                m_version++;
 
         }
 }
@@ -182,233 +408,19 @@ void
 PositionTable::Clear ()
 {
         m_table.clear ();
+        m_version++;
 }
 
-/**
- * \brief Gets next hop according to GPSR protocol
- * \param position the position of the destination node
- * \param nodePos the position of the node that has the packet
- * \return Ipv4Address of the next hop, Ipv4Address::GetZero () if no nighbour was found in greedy mode
- */
-
- //找最佳的传输节点 position是给定目的节点的位置，nodePos是源节点速度,nodeVec是发送节点速度
- //TODO 修改算法
-//
-// Ipv4Address
-// PositionTable::BestNeighbor (Vector position, Vector nodePos, Vector nodeVec)
-// {
-//   Purge ();
-//
-//   double initialDistance = CalculateDistance (nodePos, position);
-//
-//   if (m_table.empty ())
-//     {
-//       NS_LOG_DEBUG ("My neighhood table is empty; My Position: " << nodePos);
-//       return Ipv4Address::GetZero ();
-//     }     //if table is empty (no neighbours)
-//
-//   std::list<Ipv4Address> candidate;
-//   std::map<Ipv4Address, Metrix >::iterator i;
-//
-//   for (i = m_table.begin (); !(i == m_table.end ()); i++)
-//     {
-//
-//       if (initialDistance>CalculateDistance (i->second.position, position))
-//       //if (initialDistance>CalculateDistance ((i->second.position,position) position))
-//         {
-//           candidate.push_back(i->first);
-//         }
-//     }
-//   if(candidate.empty())
-//      return Ipv4Address::GetZero ();
-//   else
-//  {
-//   std::list<Ipv4Address>::iterator i = candidate.begin ();
-//   Ipv4Address bestFoundID = *candidate.begin();
-//   double bestFoundPara = 0;
-//   Vector bestPosition;
-//   //在前进的邻接点找最优的
-//   for (i = candidate.begin (); !(i == candidate.end ()); i++)
-//     {
-//       Vector tempv=GetVelocity(*i);
-//       Vector tempp=GetPosition(*i);
-//       double alpha=tempv.x-nodeVec.x;
-//       double beta=tempp.x-nodePos.x;
-//       double R=250;
-//       double gama=tempv.y-nodeVec.y;
-//       double sita=tempp.y-nodePos.y;
-//
-//       double tempt=(sqrt(pow(alpha,2)+pow(beta,2)*pow(R,2)-pow(alpha*sita-beta*gama,2))-(alpha*beta+gama*sita))/(pow(alpha,2)+pow(gama,2));
-//
-//       if (bestFoundPara < (pow(tempt,1)/pow(CalculateDistance (tempp, nodePos),0)))
-//         {
-//           bestFoundID = *i;
-//           bestFoundPara = pow(tempt,1)/pow(CalculateDistance (tempp, nodePos),0);
-//           bestPosition = tempp;
-//         }
-//
-//     }
-//     NS_LOG_DEBUG ("BestNeighbor ID: " <<bestFoundID<<"Begin ID" <<*candidate.begin () );
-//     NS_LOG_DEBUG ("Send packet to Position: " << bestPosition<<" From position"<<nodePos);
-//     return bestFoundID;
-// }
-// }
-
-Ipv4Address
-PositionTable::BestNeighbor (Vector position, Vector nodePos, Vector nodeVec)
+//得分相同时（同一个节点在几个接口上都是邻居）选metric小的接口
+bool
+PositionTable::IsBetter (double para, uint32_t interface, Ipv4Address bestId, double bestPara)
 {
-  Purge ();
-
-  double initialDistance = CalculateDistance (nodePos, position);
-
-  if (m_table.empty ())
-    {
-      NS_LOG_DEBUG ("My neighhood table is empty; My Position: " << nodePos);
-      return Ipv4Address::GetZero ();
-    }     //if table is empty (no neighbours)
-
-  std::list<Ipv4Address> candidate;
-  std::map<Ipv4Address, Metrix >::iterator i;
-
-  for (i = m_table.begin (); !(i == m_table.end ()); i++)
-    {
-
-      if (initialDistance>CalculateDistance (i->second.position, position))
-      //if (initialDistance>CalculateDistance ((i->second.position,position) position))
-        {
-          candidate.push_back(i->first);
-        }
-    }
-  if(candidate.empty())
-     return Ipv4Address::GetZero ();
-  else
- {
-  std::list<Ipv4Address>::iterator i = candidate.begin ();
-  Ipv4Address bestFoundID = *candidate.begin();
-  double bestFoundPara = 0;
-  Vector bestPosition;
-  //在前进的邻接点找最优的
-  for (i = candidate.begin (); !(i == candidate.end ()); i++)
+  if (bestId == Ipv4Address::GetZero () || para > bestPara)
     {
-      Vector tempv=GetVelocity(*i);
-      Vector tempp=GetPosition(*i);
-      double alpha=tempv.x-nodeVec.x;
-      double beta=tempp.x-nodePos.x;
-      double R=250;
-      double gama=tempv.y-nodeVec.y;
-      double sita=tempp.y-nodePos.y;
-
-      double tempt=(sqrt(pow(alpha,2)+pow(beta,2)*pow(R,2)-pow(alpha*sita-beta*gama,2))-(alpha*beta+gama*sita))/(pow(alpha,2)+pow(gama,2));
-
-      if (bestFoundPara < (pow(tempt,1)*pow(CalculateDistance (tempp, nodePos),0)))
-        {
-          bestFoundID = *i;
-          bestFoundPara = pow(tempt,1)*pow(CalculateDistance (tempp, nodePos),0);
-          bestPosition = tempp;
-        }
-
+      return true;
     }
-    NS_LOG_DEBUG ("BestNeighbor ID: " <<bestFoundID<<"Begin ID" <<*candidate.begin () );
-    NS_LOG_DEBUG ("Send packet to Position: " << bestPosition<<" From position"<<nodePos);
-    return bestFoundID;
-}
-}
-
-//  //找最佳的传输节点 position是给定目的节点的位置，nodePos是源节点速度,nodeVec是发送节点速度
-//  //TODO 修改算法
-//
-// Ipv4Address
-// PositionTable::BestNeighbor (Vector position, Vector nodePos, Vector nodeVec)
-// {
-//   Purge ();
-//
-//   double initialDistance = CalculateDistance (nodePos, position);
-//
-//   if (m_table.empty ())
-//     {
-//       NS_LOG_DEBUG ("BestNeighbor table is empty; Position: " << position);
-//       return Ipv4Address::GetZero ();
-//     }     //if table is empty (no neighbours)
-//
-//   Ipv4Address bestFoundID = m_table.begin ()->first;
-//   double bestFoundDistance = CalculateDistance (m_table.begin ()->second.position, position); //计算邻居节点距离目的节点最短的节点
-//   std::map<Ipv4Address, Metrix >::iterator i;
-//
-//   //找到邻居节点距离目的节点最近的那个邻居节点
-//   for (i = m_table.begin (); !(i == m_table.end ()); i++)
-//     {
-//       if (bestFoundDistance > CalculateDistance (i->second.position, position))
-//         {
-//           bestFoundID = i->first;
-//           bestFoundDistance = CalculateDistance (i->second.position, position);
-//           NS_LOG_DEBUG ("Best distance "<<bestFoundDistance);
-//         }
-//     }
-//   //找到最好的邻居节点，返回邻居节点address
-//   if(initialDistance > bestFoundDistance)
-//     return bestFoundID;
-//
-//   //如果邻居没有比源节点距离目的节点最近的节点，就返回没有找到，进行recovery-mode
-//   else
-//   {
-//     NS_LOG_DEBUG ("No best ID ");
-//     return Ipv4Address::GetZero (); //so it enters Recovery-mode
-// }
-// }
-
-//
-// //找最佳的传输节点 position是给定目的节点的位置，nodePos是源节点速度,nodeVec是发送节点速度
-// //TODO 修改算法
-//
-// Ipv4Address
-// PositionTable::BestNeighbor (Vector position, Vector nodePos, Vector nodeVec)
-// {
-//         Purge ();
-//
-//         double initialDistance = CalculateDistance (nodePos, position);
-//
-//         if (m_table.empty ())
-//         {
-//                 NS_LOG_DEBUG ("BestNeighbor table is empty; Position: " << position);
-//                 return Ipv4Address::GetZero ();
-//         } //if table is empty (no neighbours)
-//
-//         Ipv4Address bestFoundID = m_table.begin ()->first;
-//         double bestFoundDistance = CalculateDistance (m_table.begin ()->second.position, position); //计算邻居节点距离目的节点最短的节点
-//         std::map<Ipv4Address, Metrix >::iterator i;
-//
-//         //找到邻居节点距离目的节点最近的那个邻居节点
-//         for (i = m_table.begin (); !(i == m_table.end ()); i++)
-//         {
-//           NodeList::Iterator listEnd = NodeList::End ();
-//                 for (NodeList::Iterator j = NodeList::Begin (); j != listEnd; j++)
-//                 {
-//                         Ptr<Node> node = *j;
-//                         if (node->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal () == i->first)
-//                         {
-//                                if (node->GetId()>39)
-//                                bestFoundID=i->first;
-//                                return bestFoundID;
-//                         }
-//                 }
-//
-//                 if (bestFoundDistance > CalculateDistance (i->second.position, position))
-//                 {
-//                         bestFoundID = i->first;
-//                         bestFoundDistance = CalculateDistance (i->second.position, position);
-//                 }
-//         }
-//         //找到最好的邻居节点，返回邻居节点address
-//         if(initialDistance > bestFoundDistance)
-//                 return bestFoundID;
-//
-//         //如果邻居没有比源节点距离目的节点最近的节点，就返回没有找到，进行recovery-mode
-//         else
-//                 return Ipv4Address::GetZero ();  //so it enters Recovery-mode
-// }
-//
-//
-
+  return para == bestPara && GetMetric (interface) < GetMetric (m_table[bestId].interface);
+}
 
 /**
  * \brief Gets next hop according to GPSR recovery-mode protocol (right hand rule)
@@ -453,6 +465,66 @@ PositionTable::BestAngle (Vector previousHop, Vector nodePos)
 }
 
 
+Ipv4Address
+PositionTable::PlanarRightHand (Vector reference, Vector nodePos, Vector &neighborPos)
+{
+        Purge ();
+
+        if (m_table.empty ())
+        {
+                NS_LOG_DEBUG (" Perimeter but neighbours table empty; Position: " << nodePos);
+                return Ipv4Address::GetZero ();
+        }
+
+        Ipv4Address bestFoundID = Ipv4Address::GetZero ();
+        double bestFoundAngle = 361;
+        std::map<Ipv4Address, Metrix >::iterator i;
+
+        for (i = m_table.begin (); !(i == m_table.end ()); i++)
+        {
+                //只在平面化后的图上转发，否则交叉的边会让包绕不出面
+                if (!IsGabrielEdge (nodePos, i->second.position))
+                {
+                        continue;
+                }
+                double tmpAngle = GetAngle (nodePos, reference, i->second.position);
+                if (tmpAngle == 0)
+                {
+                        //the reference neighbour itself comes last
+                        tmpAngle = 360;
+                }
+                if (tmpAngle < bestFoundAngle)
+                {
+                        bestFoundID = i->first;
+                        bestFoundAngle = tmpAngle;
+                        neighborPos = i->second.position;
+                }
+        }
+        return bestFoundID;
+}
+
+bool
+PositionTable::IsGabrielEdge (Vector nodePos, Vector neighborPos)
+{
+        Vector middle ((nodePos.x + neighborPos.x) / 2, (nodePos.y + neighborPos.y) / 2, 0);
+        double radius = CalculateDistance (nodePos, neighborPos) / 2;
+        std::map<Ipv4Address, Metrix >::iterator i;
+
+        for (i = m_table.begin (); !(i == m_table.end ()); i++)
+        {
+                Vector witness = i->second.position;
+                if (witness.x == neighborPos.x && witness.y == neighborPos.y)
+                {
+                        continue;
+                }
+                if (CalculateDistance (witness, middle) < radius)
+                {
+                        return false;
+                }
+        }
+        return true;
+}
+
 //Gives angle between the vector CentrePos-Refpos to the vector CentrePos-node counterclockwise
 double
 PositionTable::GetAngle (Vector centrePos, Vector refPos, Vector node){
@@ -493,8 +565,72 @@ PositionTable::GetAngle (Vector centrePos, Vector refPos, Vector node){
 /**
  * \ProcessTxError
  */
+//MAC重传用完还失败：邻居多半已经离开，马上从表里删掉，不再等它超时
 void PositionTable::ProcessTxError (WifiMacHeader const & hdr)
 {
+        Mac48Address addr = hdr.GetAddr1 ();
+        if (addr.IsGroup ())
+        {
+                return;
+        }
+        Ipv4Address id = LookupNeighbor (addr);
+        if (id == Ipv4Address::GetZero ())
+        {
+                return;
+        }
+        std::map<Ipv4Address, Metrix>::iterator i = m_table.find (id);
+        Vector position = i->second.position;
+        Time expire = i->second.time + m_entryLifeTime;
+        NS_LOG_LOGIC ("TX error to " << id << ", removed from the neighbours");
+        DeleteEntry (id);
+        if (!m_handleLinkFailure.IsNull ())
+        {
+                m_handleLinkFailure (id, position, expire);
+        }
+}
+
+void
+PositionTable::AddArpCache (Ptr<ArpCache> a)
+{
+        m_arp.push_back (a);
+}
+
+void
+PositionTable::DelArpCache (Ptr<ArpCache> a)
+{
+        m_arp.erase (std::remove (m_arp.begin (), m_arp.end (), a), m_arp.end ());
+}
+
+Mac48Address
+PositionTable::LookupMacAddress (Ipv4Address id)
+{
+        for (std::vector<Ptr<ArpCache> >::const_iterator i = m_arp.begin (); i != m_arp.end (); ++i)
+        {
+                ArpCache::Entry * entry = (*i)->Lookup (id);
+                if (entry != 0 && (entry->IsAlive () || entry->IsPermanent ()) && !entry->IsExpired ())
+                {
+                        return Mac48Address::ConvertFrom (entry->GetMacAddress ());
+                }
+        }
+        return Mac48Address ();
+}
+
+Ipv4Address
+PositionTable::LookupNeighbor (Mac48Address addr)
+{
+        for (std::vector<Ptr<ArpCache> >::const_iterator i = m_arp.begin (); i != m_arp.end (); ++i)
+        {
+                std::list<ArpCache::Entry *> entries = (*i)->LookupInverse (addr);
+                for (std::list<ArpCache::Entry *>::const_iterator j = entries.begin (); j != entries.end (); ++j)
+                {
+                        Ipv4Address id = (*j)->GetIpv4Address ();
+                        if (m_table.find (id) != m_table.end ())
+                        {
+                                return id;
+                        }
+                }
+        }
+        return Ipv4Address::GetZero ();
 }
 
 
@@ -12,8 +12,12 @@
 #include "ns3/mobility-model.h"
 #include "ns3/vector.h"
 #include "ns3/wifi-mac-header.h"
+#include "ns3/arp-cache.h"
 #include "ns3/random-variable-stream.h"
+#include "gpsr-oracle.h"
+#include "gpsr-strategy.h"
 #include <complex>
+#include <vector>
 
 namespace ns3 {
 namespace gpsr {
@@ -35,10 +39,24 @@ public:
    */
   Time GetEntryUpdateTime (Ipv4Address id);
 
+  /**
+   * \brief Sets how long an entry is kept without a refreshing HELLO
+   */
+  void SetEntryLifeTime (Time lifeTime)
+  {
+    m_entryLifeTime = lifeTime;
+  }
+
+  Time GetEntryLifeTime () const
+  {
+    return m_entryLifeTime;
+  }
+
   /**
    * \brief Adds entry in position table
+   * \param interface the local interface the neighbour was heard on
    */
-  void AddEntry (Ipv4Address id, Vector position);
+  void AddEntry (Ipv4Address id, Vector position, uint32_t interface = 1);
 
   /**
    * \brief Deletes entry in position table
@@ -66,6 +84,125 @@ public:
    */
   bool isNeighbour (Ipv4Address id);
 
+  /**
+   * \brief Number of neighbours currently in the table
+   */
+  uint32_t GetNeighborCount ();
+
+  /**
+   * \brief Number of neighbours heard on the given interface
+   */
+  uint32_t GetNeighborCount (uint32_t interface);
+
+  /**
+   * \brief Gets the local interface a neighbour was heard on
+   * \return the interface, 0 if id is not a neighbour
+   */
+  uint32_t GetInterface (Ipv4Address id);
+
+  /**
+   * \brief Sets the metric of a local interface; of two equally good next hops the one on the lower metric wins
+   */
+  void SetInterfaceMetric (uint32_t interface, uint16_t metric)
+  {
+    m_metrics[interface] = metric;
+  }
+
+  /**
+   * \brief Sets the estimated radio range of a neighbour, used by LinkDurationStrategy
+   */
+  void SetRange (Ipv4Address id, double range);
+
+  /**
+   * \brief Gets the estimated radio range of a neighbour
+   * \return the estimate, the default range if there is none yet
+   */
+  double GetRange (Ipv4Address id);
+
+  /// Sets the neighbours a neighbour advertised in its extended HELLO
+  void SetTwoHop (Ipv4Address id, const std::vector<Vector> &positions);
+
+  /// Fills positions with the positions of all neighbours
+  void GetNeighborPositions (std::vector<Vector> &positions);
+
+  /// Sets the queue occupancy a neighbour advertised, 0 to 255
+  void SetLoad (Ipv4Address id, uint8_t load);
+
+  /**
+   * \brief The neighbour closing in on position fastest, if faster than minSpeed
+   * \return Ipv4Address::GetZero () if no neighbour does
+   */
+  Ipv4Address BestCarrier (Vector position, double minSpeed);
+
+  /// Speed at which a node at from moving with velocity closes in on position, m/s
+  static double ApproachSpeed (Vector from, Vector velocity, Vector position);
+
+  /**
+   * \brief Sets how much less progress than the strategy's choice a less loaded neighbour may make, meters; 0 disables
+   */
+  void SetLoadTolerance (double tolerance)
+  {
+    m_loadTolerance = tolerance;
+  }
+
+  /**
+   * \brief Hash flows over up to candidates neighbours whose score is within tolerance (relative) of the best
+   */
+  void SetMultipath (uint32_t candidates, double tolerance)
+  {
+    m_multipathCandidates = candidates;
+    m_multipathTolerance = tolerance;
+  }
+
+  /// Greedy choices spread to another than the best candidate
+  uint32_t GetMultipathSpreads () const
+  {
+    return m_multipathSpreads;
+  }
+
+  /// Greedy choices moved to a less loaded neighbour
+  uint32_t GetLoadDetours () const
+  {
+    return m_loadDetours;
+  }
+
+  /// Greedy choices that would have picked a dead end without the advertised two-hop neighbours
+  uint32_t GetDeadEndsAvoided () const
+  {
+    return m_deadEndsAvoided;
+  }
+
+  /// Range assumed for neighbours without an estimate, meters
+  void SetDefaultRange (double range)
+  {
+    m_defaultRange = range;
+  }
+
+  /**
+   * \brief Changes whenever a neighbour is added or removed
+   */
+  uint32_t GetVersion () const
+  {
+    return m_version;
+  }
+
+  /**
+   * \brief Sum of the distances neighbours moved between position updates, meters
+   *
+   * No neighbour moved further than the growth of the sum between two calls.
+   */
+  double GetDrift () const
+  {
+    return m_drift;
+  }
+
+  /**
+   * \brief How much closer than nodePos to position the closest neighbour is not
+   * \return the smallest distance of a neighbour to position minus that of
+   * nodePos, max double if the table is empty
+   */
+  double GetProgressMargin (Vector position, Vector nodePos);
+
   /**
    * \brief remove entries with expired lifetime
    */
@@ -85,12 +222,49 @@ public:
   }
 
   /**
-   * \brief Gets next hop according to GPSR protocol
+   * \brief Sets the callback told about a neighbour evicted after a TX error
+   *
+   * Called with the neighbour, its last position and the time its entry would have expired.
+   */
+  void SetLinkFailureCallback (Callback<void, Ipv4Address, Vector, Time> cb)
+  {
+    m_handleLinkFailure = cb;
+  }
+
+  /// Add ARP cache used to map the receivers reported by the MAC to neighbours
+  void AddArpCache (Ptr<ArpCache> a);
+  /// Don't use given ARP cache any more (interface is down)
+  void DelArpCache (Ptr<ArpCache> a);
+  /**
+   * \brief Gets the neighbour with the given hardware address
+   * \return Ipv4Address of the neighbour, Ipv4Address::GetZero () if no neighbour has it
+   */
+  Ipv4Address LookupNeighbor (Mac48Address addr);
+  /// Hardware address of a neighbour from the ARP caches, Mac48Address () if not resolved yet
+  Mac48Address LookupMacAddress (Ipv4Address id);
+
+  /**
+   * \brief Sets the callback giving the expected airtime of a frame to a neighbour heard on an interface
+   */
+  void SetAirtimeCallback (Callback<Time, Ipv4Address, uint32_t> cb)
+  {
+    m_airtime = cb;
+  }
+
+  /**
+   * \brief Gets the greedy next hop chosen by a forwarding strategy
+   *
+   * Only neighbours closer to the destination than nodePos are candidates;
+   * one that advertised no onward progress is passed over when another
+   * candidate is left.
    * \param position the position of the destination node
    * \param nodePos the position of the node that has the packet
-   * \return Ipv4Address of the next hop, Ipv4Address::GetZero () if no nighbour was found in greedy mode
+   * \param nodeVec the velocity of the node that has the packet
+   * \param flowHash flow of the packet, spread over the near-equal candidates; 0 takes the best
+   * \return Ipv4Address of the next hop, Ipv4Address::GetZero () if no neighbour makes progress
    */
-  Ipv4Address BestNeighbor (Vector position, Vector nodePos, Vector nodeVec);
+  template <class Strategy>
+  Ipv4Address SelectNeighbor (Vector position, Vector nodePos, Vector nodeVec, uint32_t flowHash = 0);
 
   bool IsInSearch (Ipv4Address id);
 
@@ -114,6 +288,18 @@ public:
    */
   Ipv4Address BestAngle (Vector previousHop, Vector nodePos);
 
+  /**
+   * \brief Gets the next perimeter hop: right hand rule on the Gabriel graph of the neighbours
+   * \param reference position the angle is measured from, counterclockwise
+   * \param nodePos the position of the node that has the packet
+   * \param neighborPos set to the position of the next hop
+   * \return Ipv4Address of the next hop, Ipv4Address::GetZero () if the table is empty
+   */
+  Ipv4Address PlanarRightHand (Vector reference, Vector nodePos, Vector &neighborPos);
+
+  /// True if no other neighbour lies in the circle with diameter nodePos-neighborPos
+  bool IsGabrielEdge (Vector nodePos, Vector neighborPos);
+
   //Gives angle between the vector CentrePos-Refpos to the vector CentrePos-node counterclockwise
   double GetAngle (Vector centrePos, Vector refPos, Vector node);
 
@@ -125,11 +311,38 @@ private:
   Vector position;
   Vector velocity;
   Time  time;
+  uint32_t interface;
+  double range;                 ///< Estimated radio range, 0 if none yet
+  std::vector<Vector> twoHop;   ///< Neighbours of the neighbour, from its extended HELLO
+  uint8_t load;                 ///< Advertised queue occupancy
   };
   Time m_entryLifeTime;
   std::map<Ipv4Address,Metrix> m_table;
+  uint32_t m_version;
+  double m_drift;
+  double m_defaultRange;
+  uint32_t m_deadEndsAvoided;
+  double m_loadTolerance;
+  uint32_t m_multipathCandidates;
+  double m_multipathTolerance;
+  uint32_t m_multipathSpreads;
+  std::vector<std::pair<double, Ipv4Address> > m_scores;   ///< Scores of the live candidates of the current decision
+  /// One of the near-equal candidates in m_scores, picked by flowHash
+  Ipv4Address SpreadFlow (Ipv4Address chosen, double chosenPara, uint32_t flowHash);
+  uint32_t m_loadDetours;
+  /// Least loaded neighbour closer to position than distance and making at most m_loadTolerance less progress than chosen
+  Ipv4Address LeastLoaded (Ipv4Address chosen, Vector position, double distance);
+  /// True if id advertised its neighbours and none is closer to position than id
+  bool IsDeadEnd (Ipv4Address id, Vector position);
+  /// True if para beats the best so far; equal scores go to the lower interface metric
+  bool IsBetter (double para, uint32_t interface, Ipv4Address bestId, double bestPara);
+  std::map<uint32_t, uint16_t> m_metrics;       ///< Metric of each local interface
+  uint16_t GetMetric (uint32_t interface) const;
   // TX error callback
   Callback<void, WifiMacHeader const &> m_txErrorCallback;
+  Callback<void, Ipv4Address, Vector, Time> m_handleLinkFailure;
+  Callback<Time, Ipv4Address, uint32_t> m_airtime;
+  std::vector<Ptr<ArpCache> > m_arp;
   // Process layer 2 TX error notification
   void ProcessTxError (WifiMacHeader const&);
 
@@ -138,6 +351,78 @@ private:
 
 };
 
+template <class Strategy>
+Ipv4Address
+PositionTable::SelectNeighbor (Vector position, Vector nodePos, Vector nodeVec, uint32_t flowHash)
+{
+  Purge ();
+
+  StrategyContext ctx;
+  ctx.destination = position;
+  ctx.nodePos = nodePos;
+  ctx.nodeVel = nodeVec;
+  ctx.distance = CalculateDistance (nodePos, position);
+
+  Ipv4Address bestFoundID = Ipv4Address::GetZero ();
+  double bestFoundPara = 0;
+  // best of the candidates that are not known dead ends
+  Ipv4Address bestLiveID = Ipv4Address::GetZero ();
+  double bestLivePara = 0;
+  bool spread = m_multipathCandidates > 1 && flowHash != 0;
+  m_scores.clear ();
+
+  for (std::map<Ipv4Address, Metrix>::iterator i = m_table.begin (); i != m_table.end (); ++i)
+    {
+      if (CalculateDistance (i->second.position, position) >= ctx.distance)
+        {
+          continue;
+        }
+      NeighborView n;
+      n.position = i->second.position;
+      n.range = i->second.range > 0 ? i->second.range : m_defaultRange;
+      if (Strategy::NeedsVelocity)
+        {
+          n.velocity = GetVelocity (i->first);
+        }
+      if (Strategy::NeedsAirtime)
+        {
+          n.airtime = m_airtime.IsNull () ? 1 : m_airtime (i->first, i->second.interface).GetSeconds ();
+        }
+      double para = Strategy::Score (ctx, n);
+      if (IsBetter (para, i->second.interface, bestFoundID, bestFoundPara))
+        {
+          bestFoundID = i->first;
+          bestFoundPara = para;
+        }
+      if ((spread || IsBetter (para, i->second.interface, bestLiveID, bestLivePara)) && !IsDeadEnd (i->first, position))
+        {
+          if (spread)
+            {
+              m_scores.push_back (std::make_pair (para, i->first));
+            }
+          if (IsBetter (para, i->second.interface, bestLiveID, bestLivePara))
+            {
+              bestLiveID = i->first;
+              bestLivePara = para;
+            }
+        }
+    }
+  if (bestLiveID != Ipv4Address::GetZero () && bestLiveID != bestFoundID)
+    {
+      m_deadEndsAvoided++;
+      bestFoundID = bestLiveID;
+    }
+  if (spread && bestLiveID != Ipv4Address::GetZero ())
+    {
+      bestFoundID = SpreadFlow (bestLiveID, bestLivePara, flowHash);
+    }
+  if (m_loadTolerance > 0 && bestFoundID != Ipv4Address::GetZero ())
+    {
+      return LeastLoaded (bestFoundID, position, ctx.distance);
+    }
+  return bestFoundID;
+}
+
 }   // gpsr
 } // ns3
 #endif /* GPSR_PTABLE_H */
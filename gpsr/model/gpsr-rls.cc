@@ -0,0 +1,683 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "gpsr-rls.h"
+#include "gpsr-packet.h"
+#include "ns3/log.h"
+#include "ns3/address-utils.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/node.h"
+#include "ns3/mobility-model.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/trace-source-accessor.h"
+
+NS_LOG_COMPONENT_DEFINE ("GpsrRls");
+
+namespace ns3 {
+namespace gpsr {
+
+//-----------------------------------------------------------------------------
+// RLS header
+//-----------------------------------------------------------------------------
+RlsHeader::RlsHeader (RlsMessageType type, uint8_t ttl, uint32_t requestId,
+                      Ipv4Address requester, Ipv4Address target,
+                      uint64_t posx, uint64_t posy, uint32_t timestamp)
+  : m_type (type),
+    m_valid (true),
+    m_ttl (ttl),
+    m_requestId (requestId),
+    m_requester (requester),
+    m_target (target),
+    m_posx (posx),
+    m_posy (posy),
+    m_timestamp (timestamp)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED (RlsHeader);
+
+TypeId
+RlsHeader::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::gpsr::RlsHeader")
+    .SetParent<Header> ()
+    .AddConstructor<RlsHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+RlsHeader::GetInstanceTypeId () const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+RlsHeader::GetSerializedSize () const
+{
+  if (m_type == RLSTYPE_MULTI_REQUEST)
+    {
+      return 35 + 4 * m_moreTargets.size ();
+    }
+  return 34;
+}
+
+void
+RlsHeader::Serialize (Buffer::Iterator i) const
+{
+  i.WriteU8 ((uint8_t) m_type);
+  i.WriteU8 (m_ttl);
+  i.WriteHtonU32 (m_requestId);
+  WriteTo (i, m_requester);
+  WriteTo (i, m_target);
+  i.WriteHtonU64 (m_posx);
+  i.WriteHtonU64 (m_posy);
+  i.WriteHtonU32 (m_timestamp);
+  if (m_type == RLSTYPE_MULTI_REQUEST)
+    {
+      i.WriteU8 ((uint8_t) m_moreTargets.size ());
+      for (std::vector<Ipv4Address>::const_iterator t = m_moreTargets.begin (); t != m_moreTargets.end (); ++t)
+        {
+          WriteTo (i, *t);
+        }
+    }
+}
+
+uint32_t
+RlsHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  uint8_t type = i.ReadU8 ();
+  m_valid = true;
+  switch (type)
+    {
+    case RLSTYPE_REQUEST:
+    case RLSTYPE_REPLY:
+    case RLSTYPE_MULTI_REQUEST:
+      {
+        m_type = (RlsMessageType) type;
+        break;
+      }
+    default:
+      m_valid = false;
+    }
+  m_ttl = i.ReadU8 ();
+  m_requestId = i.ReadNtohU32 ();
+  ReadFrom (i, m_requester);
+  ReadFrom (i, m_target);
+  m_posx = i.ReadNtohU64 ();
+  m_posy = i.ReadNtohU64 ();
+  m_timestamp = i.ReadNtohU32 ();
+  m_moreTargets.clear ();
+  if (m_valid && m_type == RLSTYPE_MULTI_REQUEST)
+    {
+      uint8_t count = i.ReadU8 ();
+      for (uint8_t k = 0; k < count; ++k)
+        {
+          Ipv4Address target;
+          ReadFrom (i, target);
+          m_moreTargets.push_back (target);
+        }
+    }
+
+  uint32_t dist = i.GetDistanceFrom (start);
+  NS_ASSERT (dist == GetSerializedSize ());
+  return dist;
+}
+
+void
+RlsHeader::Print (std::ostream &os) const
+{
+  os << (m_type == RLSTYPE_REPLY ? " RLS_REPLY" : " RLS_REQUEST")
+     << " TTL: " << (uint32_t) m_ttl
+     << " RequestId: " << m_requestId
+     << " Requester: " << m_requester
+     << " Target: " << m_target;
+  for (std::vector<Ipv4Address>::const_iterator t = m_moreTargets.begin (); t != m_moreTargets.end (); ++t)
+    {
+      os << "," << *t;
+    }
+  os
+     << " PositionX: " << m_posx
+     << " PositionY: " << m_posy
+     << " Timestamp: " << m_timestamp;
+}
+
+std::vector<Ipv4Address>
+RlsHeader::GetTargets () const
+{
+  std::vector<Ipv4Address> targets;
+  targets.push_back (m_target);
+  targets.insert (targets.end (), m_moreTargets.begin (), m_moreTargets.end ());
+  return targets;
+}
+
+void
+RlsHeader::SetTargets (const std::vector<Ipv4Address> &targets)
+{
+  NS_ASSERT (!targets.empty ());
+  m_target = targets.front ();
+  m_moreTargets.assign (targets.begin () + 1, targets.end ());
+  m_type = m_moreTargets.empty () ? RLSTYPE_REQUEST : RLSTYPE_MULTI_REQUEST;
+}
+
+std::ostream &
+operator<< (std::ostream & os, RlsHeader const & h)
+{
+  h.Print (os);
+  return os;
+}
+
+//-----------------------------------------------------------------------------
+// RLS location service
+//-----------------------------------------------------------------------------
+NS_OBJECT_ENSURE_REGISTERED (RlsLocationService);
+
+/// UDP Port for RLS messages, next to the GPSR port
+const uint32_t RlsLocationService::RLS_PORT = 667;
+/// Keeps a multi-target request well below the MTU
+const uint32_t RlsLocationService::MAX_TARGETS = 32;
+
+TypeId
+RlsLocationService::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::gpsr::RlsLocationService")
+    .SetParent<LocationService> ()
+    .AddConstructor<RlsLocationService> ()
+    .AddAttribute ("CacheTimeout", "Lifetime of a cached position.",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&RlsLocationService::CacheTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("NodeTraversalTime", "Estimate of the per-hop request/reply time, sets the ring timeout.",
+                   TimeValue (MilliSeconds (40)),
+                   MakeTimeAccessor (&RlsLocationService::NodeTraversalTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("TtlStart", "TTL of the first request of a search.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&RlsLocationService::TtlStart),
+                   MakeUintegerChecker<uint8_t> (1))
+    .AddAttribute ("TtlIncrement", "TTL increment between two expanding rings.",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&RlsLocationService::TtlIncrement),
+                   MakeUintegerChecker<uint8_t> (1))
+    .AddAttribute ("TtlThreshold", "Largest expanding-ring TTL, the next request is network wide.",
+                   UintegerValue (7),
+                   MakeUintegerAccessor (&RlsLocationService::TtlThreshold),
+                   MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("NetDiameter", "TTL of the network wide request.",
+                   UintegerValue (35),
+                   MakeUintegerAccessor (&RlsLocationService::NetDiameter),
+                   MakeUintegerChecker<uint8_t> (1))
+    .AddAttribute ("MaxJitter", "Maximum rebroadcast jitter of a request.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&RlsLocationService::MaxJitter),
+                   MakeTimeChecker ())
+    .AddTraceSource ("RequestTx", "A location request is sent or rebroadcast.",
+                     MakeTraceSourceAccessor (&RlsLocationService::m_requestTxTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("ReplyTx", "A location reply is sent.",
+                     MakeTraceSourceAccessor (&RlsLocationService::m_replyTxTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("Lookup", "A search is resolved by a reply.",
+                     MakeTraceSourceAccessor (&RlsLocationService::m_lookupTrace),
+                     "ns3::gpsr::RlsLocationService::LookupCallback")
+    .AddTraceSource ("LookupFailed", "A search is given up.",
+                     MakeTraceSourceAccessor (&RlsLocationService::m_lookupFailedTrace),
+                     "ns3::gpsr::RlsLocationService::LookupFailedCallback")
+  ;
+  return tid;
+}
+
+RlsLocationService::RlsLocationService ()
+  : CacheTimeout (Seconds (10)),
+    NodeTraversalTime (MilliSeconds (40)),
+    TtlStart (1),
+    TtlIncrement (2),
+    TtlThreshold (7),
+    NetDiameter (35),
+    MaxJitter (MilliSeconds (10)),
+    m_requestId (0)
+{
+  m_uniformRandomVariable = CreateObject<UniformRandomVariable> ();
+}
+
+RlsLocationService::~RlsLocationService ()
+{
+}
+
+void
+RlsLocationService::DoDispose ()
+{
+  Clear ();
+  m_purgeEvent.Cancel ();
+  m_flushEvent.Cancel ();
+  if (m_socket)
+    {
+      m_socket->Close ();
+      m_socket = 0;
+    }
+  m_ipv4 = 0;
+  m_searchDone = MakeNullCallback<void, Ipv4Address> ();
+  LocationService::DoDispose ();
+}
+
+void
+RlsLocationService::Start (Ptr<Ipv4> ipv4)
+{
+  NS_LOG_FUNCTION (this);
+  m_ipv4 = ipv4;
+  m_socket = Socket::CreateSocket (ipv4->GetObject<Node> (), UdpSocketFactory::GetTypeId ());
+  m_socket->SetAllowBroadcast (true);
+  m_socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), RLS_PORT));
+  m_socket->SetRecvCallback (MakeCallback (&RlsLocationService::Recv, this));
+  m_purgeEvent = Simulator::Schedule (CacheTimeout, &RlsLocationService::PurgeTimerExpire, this);
+}
+
+void
+RlsLocationService::PurgeTimerExpire ()
+{
+  Purge ();
+  m_purgeEvent = Simulator::Schedule (CacheTimeout, &RlsLocationService::PurgeTimerExpire, this);
+}
+
+Time
+RlsLocationService::GetEntryUpdateTime (Ipv4Address id)
+{
+  std::map<Ipv4Address, Entry>::const_iterator i = m_table.find (id);
+  if (i == m_table.end () || i->second.expire <= Simulator::Now ())
+    {
+      return Seconds (0);
+    }
+  return i->second.updated;
+}
+
+void
+RlsLocationService::AddEntry (Ipv4Address id, Vector position)
+{
+  UpdateEntry (id, position, Simulator::Now ());
+}
+
+void
+RlsLocationService::DeleteEntry (Ipv4Address id)
+{
+  m_table.erase (id);
+}
+
+Vector
+RlsLocationService::GetPosition (Ipv4Address id)
+{
+  std::map<Ipv4Address, Entry>::const_iterator i = m_table.find (id);
+  if (i != m_table.end () && i->second.expire > Simulator::Now ())
+    {
+      return i->second.position;
+    }
+  // cache miss: start a search unless one is running already
+  if (m_socket && m_searches.find (id) == m_searches.end () && !IsMyOwnAddress (id))
+    {
+      StartSearch (id);
+    }
+  return GetInvalidPosition ();
+}
+
+void
+RlsLocationService::ResolvePositions (const std::list<Ipv4Address> &ids, StatusMap &status)
+{
+  Time now = Simulator::Now ();
+  for (std::list<Ipv4Address>::const_iterator i = ids.begin (); i != ids.end (); ++i)
+    {
+      if (HasPosition (*i))
+        {
+          status[*i] = POSITION_FOUND;
+          continue;
+        }
+      if (IsInSearch (*i))
+        {
+          status[*i] = POSITION_IN_SEARCH;
+          continue;
+        }
+      std::map<Ipv4Address, Time>::const_iterator failed = m_failed.find (*i);
+      if (!m_socket || IsMyOwnAddress (*i) || (failed != m_failed.end () && failed->second > now))
+        {
+          status[*i] = POSITION_NOT_FOUND;
+          continue;
+        }
+      // expired cache entry of a destination that still has queued packets
+      StartSearch (*i);
+      status[*i] = POSITION_IN_SEARCH;
+    }
+}
+
+bool
+RlsLocationService::IsInSearch (Ipv4Address id)
+{
+  return m_searches.find (id) != m_searches.end ();
+}
+
+bool
+RlsLocationService::HasPosition (Ipv4Address id)
+{
+  std::map<Ipv4Address, Entry>::const_iterator i = m_table.find (id);
+  return i != m_table.end () && i->second.expire > Simulator::Now ();
+}
+
+void
+RlsLocationService::Purge ()
+{
+  Time now = Simulator::Now ();
+  for (std::map<Ipv4Address, Entry>::iterator i = m_table.begin (); i != m_table.end (); )
+    {
+      if (i->second.expire <= now)
+        {
+          m_table.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+  for (std::map<std::pair<Ipv4Address, uint32_t>, Time>::iterator i = m_seen.begin (); i != m_seen.end (); )
+    {
+      if (i->second <= now)
+        {
+          m_seen.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+  for (std::map<Ipv4Address, Time>::iterator i = m_failed.begin (); i != m_failed.end (); )
+    {
+      if (i->second <= now)
+        {
+          m_failed.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+}
+
+void
+RlsLocationService::Clear ()
+{
+  for (std::map<Ipv4Address, Search>::iterator i = m_searches.begin (); i != m_searches.end (); ++i)
+    {
+      i->second.timeout.Cancel ();
+    }
+  m_searches.clear ();
+  m_pending.clear ();
+  m_flushEvent.Cancel ();
+  m_table.clear ();
+  m_seen.clear ();
+  m_failed.clear ();
+}
+
+void
+RlsLocationService::StartSearch (Ipv4Address target)
+{
+  Search search;
+  search.ttl = TtlStart;
+  search.requestId = 0;
+  search.start = Simulator::Now ();
+  m_searches[target] = search;
+  m_pending.push_back (target);
+  // every search started in this instant goes into the same request
+  if (!m_flushEvent.IsRunning ())
+    {
+      m_flushEvent = Simulator::ScheduleNow (&RlsLocationService::FlushRequests, this);
+    }
+}
+
+void
+RlsLocationService::FlushRequests ()
+{
+  std::vector<Ipv4Address> targets;
+  for (std::vector<Ipv4Address>::const_iterator i = m_pending.begin (); i != m_pending.end (); ++i)
+    {
+      if (m_searches.find (*i) == m_searches.end ())
+        {
+          continue; // resolved meanwhile
+        }
+      targets.push_back (*i);
+      if (targets.size () == MAX_TARGETS)
+        {
+          SendRequest (targets, TtlStart);
+          targets.clear ();
+        }
+    }
+  m_pending.clear ();
+  if (!targets.empty ())
+    {
+      SendRequest (targets, TtlStart);
+    }
+}
+
+void
+RlsLocationService::SendRequest (const std::vector<Ipv4Address> &targets, uint8_t ttl)
+{
+  NS_LOG_FUNCTION (this << targets.size () << (uint32_t) ttl);
+  Vector myPos = m_ipv4->GetObject<MobilityModel> ()->GetPosition ();
+  uint32_t id = ++m_requestId;
+  RlsHeader request (RLSTYPE_REQUEST, ttl, id, GetMainAddress (), targets.front (),
+                     (uint64_t) myPos.x, (uint64_t) myPos.y,
+                     (uint32_t) Simulator::Now ().GetMilliSeconds ());
+  request.SetTargets (targets);
+  Time ringTime = Seconds (2 * NodeTraversalTime.GetSeconds () * (ttl + 2));
+  m_seen[std::make_pair (GetMainAddress (), id)] = Simulator::Now () + ringTime;
+
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (request);
+  Broadcast (packet);
+
+  EventId timeout = Simulator::Schedule (ringTime, &RlsLocationService::SearchTimeout, this, targets, id);
+  for (std::vector<Ipv4Address>::const_iterator i = targets.begin (); i != targets.end (); ++i)
+    {
+      Search &search = m_searches[*i];
+      search.ttl = ttl;
+      search.requestId = id;
+      search.timeout = timeout;
+    }
+}
+
+void
+RlsLocationService::SearchTimeout (std::vector<Ipv4Address> targets, uint32_t requestId)
+{
+  // targets resolved since, or searched again by a later request, are skipped
+  std::vector<Ipv4Address> retry;
+  std::vector<Ipv4Address> failed;
+  uint8_t lastTtl = 0;
+  for (std::vector<Ipv4Address>::const_iterator t = targets.begin (); t != targets.end (); ++t)
+    {
+      std::map<Ipv4Address, Search>::iterator i = m_searches.find (*t);
+      if (i == m_searches.end () || i->second.requestId != requestId)
+        {
+          continue;
+        }
+      lastTtl = i->second.ttl;
+      if (i->second.ttl >= NetDiameter)
+        {
+          NS_LOG_LOGIC ("No reply for " << *t << ", search given up");
+          m_searches.erase (i);
+          m_failed[*t] = Simulator::Now () + CacheTimeout;
+          failed.push_back (*t);
+        }
+      else
+        {
+          retry.push_back (*t);
+        }
+    }
+  if (!retry.empty ())
+    {
+      uint8_t ttl = lastTtl + TtlIncrement;
+      if (lastTtl >= TtlThreshold || ttl > TtlThreshold)
+        {
+          ttl = NetDiameter;
+        }
+      SendRequest (retry, ttl);
+    }
+  // the callback may queue or drop packets, run it once the state is consistent
+  for (std::vector<Ipv4Address>::const_iterator t = failed.begin (); t != failed.end (); ++t)
+    {
+      m_lookupFailedTrace (*t);
+      if (!m_searchDone.IsNull ())
+        {
+          m_searchDone (*t);
+        }
+    }
+}
+
+void
+RlsLocationService::Recv (Ptr<Socket> socket)
+{
+  Address sourceAddress;
+  Ptr<Packet> packet = socket->RecvFrom (sourceAddress);
+
+  // unicast replies routed by GPSR keep the headers RouteOutput put in front of the payload
+  TypeHeader tHeader (GPSRTYPE_POS);
+  packet->PeekHeader (tHeader);
+  if (tHeader.IsValid ())
+    {
+      packet->RemoveHeader (tHeader);
+      if (tHeader.Get () == GPSRTYPE_POS || tHeader.Get () == GPSRTYPE_POS_CTX)
+        {
+          PositionHeader phdr;
+          packet->RemoveHeader (phdr);
+        }
+      if (tHeader.Get () == GPSRTYPE_POS_CTX || tHeader.Get () == GPSRTYPE_CPOS)
+        {
+          FlowHeader flowHeader;
+          packet->RemoveHeader (flowHeader);
+        }
+    }
+
+  RlsHeader header;
+  packet->RemoveHeader (header);
+  if (!header.IsValid ())
+    {
+      NS_LOG_DEBUG ("RLS message " << packet->GetUid () << " with unknown type received. Ignored");
+      return;
+    }
+  if (header.GetType () == RLSTYPE_REQUEST || header.GetType () == RLSTYPE_MULTI_REQUEST)
+    {
+      RecvRequest (header);
+    }
+  else
+    {
+      RecvReply (header);
+    }
+}
+
+void
+RlsLocationService::RecvRequest (const RlsHeader &request)
+{
+  std::pair<Ipv4Address, uint32_t> key (request.GetRequester (), request.GetRequestId ());
+  if (m_seen.find (key) != m_seen.end ())
+    {
+      return;
+    }
+  m_seen[key] = Simulator::Now () + Seconds (2 * NodeTraversalTime.GetSeconds () * (NetDiameter + 2));
+
+  // the reply is routed back with GPSR, which needs the position of the requester
+  UpdateEntry (request.GetRequester (), Vector (request.GetPosx (), request.GetPosy (), 0),
+               MilliSeconds (request.GetTimestamp ()));
+
+  // answer for this node, keep looking for the other targets
+  std::vector<Ipv4Address> targets = request.GetTargets ();
+  std::vector<Ipv4Address> others;
+  for (std::vector<Ipv4Address>::const_iterator t = targets.begin (); t != targets.end (); ++t)
+    {
+      if (!IsMyOwnAddress (*t))
+        {
+          others.push_back (*t);
+          continue;
+        }
+      Vector myPos = m_ipv4->GetObject<MobilityModel> ()->GetPosition ();
+      RlsHeader reply (RLSTYPE_REPLY, 0, request.GetRequestId (), request.GetRequester (), *t,
+                       (uint64_t) myPos.x, (uint64_t) myPos.y,
+                       (uint32_t) Simulator::Now ().GetMilliSeconds ());
+      Ptr<Packet> packet = Create<Packet> ();
+      packet->AddHeader (reply);
+      m_replyTxTrace (packet);
+      NS_LOG_LOGIC ("Reply to " << request.GetRequester () << " for request " << request.GetRequestId ());
+      m_socket->SendTo (packet, 0, InetSocketAddress (request.GetRequester (), RLS_PORT));
+    }
+
+  if (!others.empty () && request.GetTtl () > 1)
+    {
+      RlsHeader forward = request;
+      forward.SetTargets (others);
+      forward.SetTtl (request.GetTtl () - 1);
+      Ptr<Packet> packet = Create<Packet> ();
+      packet->AddHeader (forward);
+      Simulator::Schedule (Seconds (m_uniformRandomVariable->GetValue (0, MaxJitter.GetSeconds ())),
+                           &RlsLocationService::Broadcast, this, packet);
+    }
+}
+
+void
+RlsLocationService::RecvReply (const RlsHeader &reply)
+{
+  if (!IsMyOwnAddress (reply.GetRequester ()))
+    {
+      return;
+    }
+  UpdateEntry (reply.GetTarget (), Vector (reply.GetPosx (), reply.GetPosy (), 0),
+               MilliSeconds (reply.GetTimestamp ()));
+
+  std::map<Ipv4Address, Search>::iterator i = m_searches.find (reply.GetTarget ());
+  if (i == m_searches.end ())
+    {
+      return; // late reply of a search already resolved
+    }
+  // the ring timeout is shared with the other targets of the request and skips this one
+  Time latency = Simulator::Now () - i->second.start;
+  m_searches.erase (i);
+  NS_LOG_LOGIC ("Found " << reply.GetTarget () << " after " << latency.GetSeconds () << " s");
+  m_lookupTrace (reply.GetTarget (), latency);
+  if (!m_searchDone.IsNull ())
+    {
+      m_searchDone (reply.GetTarget ());
+    }
+}
+
+void
+RlsLocationService::Broadcast (Ptr<Packet> packet)
+{
+  m_requestTxTrace (packet);
+  m_socket->SendTo (packet, 0, InetSocketAddress (m_ipv4->GetAddress (GetMainInterface (m_ipv4), 0).GetBroadcast (), RLS_PORT));
+}
+
+bool
+RlsLocationService::IsMyOwnAddress (Ipv4Address id)
+{
+  return m_ipv4 && m_ipv4->GetInterfaceForAddress (id) >= 0;
+}
+
+Ipv4Address
+RlsLocationService::GetMainAddress ()
+{
+  return m_ipv4->GetAddress (GetMainInterface (m_ipv4), 0).GetLocal ();
+}
+
+void
+RlsLocationService::UpdateEntry (Ipv4Address id, Vector position, Time updated)
+{
+  std::map<Ipv4Address, Entry>::iterator i = m_table.find (id);
+  if (i != m_table.end () && i->second.updated > updated)
+    {
+      return;
+    }
+  Entry entry;
+  entry.position = position;
+  entry.updated = updated;
+  entry.expire = Simulator::Now () + CacheTimeout;
+  m_table[id] = entry;
+  m_failed.erase (id);
+}
+
+}   // gpsr
+} // ns3
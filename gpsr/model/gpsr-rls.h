@@ -0,0 +1,252 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef GPSR_RLS_H
+#define GPSR_RLS_H
+
+#include <map>
+#include <vector>
+#include "ns3/header.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/socket.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/callback.h"
+#include "ns3/traced-callback.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/location-service.h"
+#include "gpsr-ls-batch.h"
+
+namespace ns3 {
+namespace gpsr {
+
+/**
+ * \ingroup gpsr
+ * \brief RLS message types
+ *
+ * Chosen apart from the GPSR MessageType values, so that a GPSR TypeHeader
+ * in front of an RLS message can be recognised and skipped.
+ */
+enum RlsMessageType
+{
+  RLSTYPE_REQUEST = 10,        //!< flooded location request
+  RLSTYPE_REPLY = 11,          //!< unicast location reply
+  RLSTYPE_MULTI_REQUEST = 12,  //!< flooded location request for several targets
+};
+
+/**
+ * \ingroup gpsr
+ * \brief RLS request/reply header
+ *
+ * A request carries the position of the requester (so that the reply can be
+ * routed back with GPSR), a reply carries the position of the target. A
+ * multi-target request appends the targets after the first one.
+ */
+class RlsHeader : public Header
+{
+public:
+  /// c-tor
+  RlsHeader (RlsMessageType type = RLSTYPE_REQUEST, uint8_t ttl = 0, uint32_t requestId = 0,
+             Ipv4Address requester = Ipv4Address (), Ipv4Address target = Ipv4Address (),
+             uint64_t posx = 0, uint64_t posy = 0, uint32_t timestamp = 0);
+
+  ///\name Header serialization/deserialization
+  //\{
+  static TypeId GetTypeId ();
+  TypeId GetInstanceTypeId () const;
+  uint32_t GetSerializedSize () const;
+  void Serialize (Buffer::Iterator start) const;
+  uint32_t Deserialize (Buffer::Iterator start);
+  void Print (std::ostream &os) const;
+  //\}
+
+  ///\name Fields
+  //\{
+  RlsMessageType GetType () const
+  {
+    return m_type;
+  }
+  bool IsValid () const
+  {
+    return m_valid;
+  }
+  void SetTtl (uint8_t ttl)
+  {
+    m_ttl = ttl;
+  }
+  uint8_t GetTtl () const
+  {
+    return m_ttl;
+  }
+  uint32_t GetRequestId () const
+  {
+    return m_requestId;
+  }
+  Ipv4Address GetRequester () const
+  {
+    return m_requester;
+  }
+  Ipv4Address GetTarget () const
+  {
+    return m_target;
+  }
+  /// All targets, the first one is GetTarget ()
+  std::vector<Ipv4Address> GetTargets () const;
+  /// Set the targets of a multi-target request, targets must not be empty
+  void SetTargets (const std::vector<Ipv4Address> &targets);
+  uint64_t GetPosx () const
+  {
+    return m_posx;
+  }
+  uint64_t GetPosy () const
+  {
+    return m_posy;
+  }
+  /// Time the position was measured, in milliseconds
+  uint32_t GetTimestamp () const
+  {
+    return m_timestamp;
+  }
+  //\}
+
+private:
+  RlsMessageType m_type;        ///< Message type
+  bool m_valid;                 ///< Indicates if the message is valid
+  uint8_t m_ttl;                ///< Remaining hops of a request
+  uint32_t m_requestId;         ///< Request ID, unique per requester
+  Ipv4Address m_requester;      ///< Node looking for the target
+  Ipv4Address m_target;         ///< Node whose position is looked for
+  std::vector<Ipv4Address> m_moreTargets; ///< Further targets of a multi-target request
+  uint64_t m_posx;              ///< Requester (request) or target (reply) position
+  uint64_t m_posy;              ///< Requester (request) or target (reply) position
+  uint32_t m_timestamp;         ///< Time of the position, ms
+};
+
+std::ostream & operator<< (std::ostream & os, RlsHeader const &);
+
+/**
+ * \ingroup gpsr
+ * \brief Reactive Location Service
+ *
+ * GetPosition() answers from a location cache. On a miss it floods a
+ * location request with an expanding-ring TTL; the target answers with a
+ * unicast reply routed by GPSR. IsInSearch() is true while the rings are
+ * being tried, HasPosition() is false once they all timed out, so that
+ * RoutingProtocol::SendPacketFromQueue drops the queued packets.
+ *
+ * Searches started in the same instant, by GetPosition() or
+ * ResolvePositions(), share multi-target requests.
+ */
+class RlsLocationService : public LocationService, public BatchLocationQuery
+{
+public:
+  static TypeId GetTypeId (void);
+  /// UDP port of RLS messages
+  static const uint32_t RLS_PORT;
+
+  /// c-tor
+  RlsLocationService ();
+  virtual ~RlsLocationService ();
+  virtual void DoDispose ();
+
+  ///\name From LocationService
+  //\{
+  virtual Time GetEntryUpdateTime (Ipv4Address id);
+  virtual void AddEntry (Ipv4Address id, Vector position);
+  virtual void DeleteEntry (Ipv4Address id);
+  virtual Vector GetPosition (Ipv4Address id);
+  virtual bool IsInSearch (Ipv4Address id);
+  virtual bool HasPosition (Ipv4Address id);
+  virtual void Purge ();
+  virtual void Clear ();
+  //\}
+
+  /// From BatchLocationQuery: misses start searches merged into one request
+  virtual void ResolvePositions (const std::list<Ipv4Address> &ids, StatusMap &status);
+
+  /// Open the RLS socket of the node owning ipv4
+  void Start (Ptr<Ipv4> ipv4);
+
+  /// Called with the target address when a search is resolved by a reply or given up
+  void SetSearchDoneCallback (Callback<void, Ipv4Address> cb)
+  {
+    m_searchDone = cb;
+  }
+
+  /**
+   * TracedCallback signature for resolved lookups.
+   * \param target the node that was looked for
+   * \param latency time from the first request to the reply
+   */
+  typedef void (* LookupCallback)(Ipv4Address target, Time latency);
+
+  /**
+   * TracedCallback signature for failed lookups.
+   * \param target the node that was looked for
+   */
+  typedef void (* LookupFailedCallback)(Ipv4Address target);
+
+private:
+  /// Cached position
+  struct Entry
+  {
+    Vector position;
+    Time updated;               ///< Time the position was measured
+    Time expire;                ///< Time the entry leaves the cache
+  };
+  /// Ongoing search
+  struct Search
+  {
+    uint8_t ttl;                ///< TTL of the last request
+    uint32_t requestId;         ///< ID of the last request, 0 until it is sent
+    Time start;                 ///< Time the first request was sent
+    EventId timeout;            ///< Expiry of the current ring, shared by the targets of the request
+  };
+  /// Most targets carried by one request
+  static const uint32_t MAX_TARGETS;
+
+  Time CacheTimeout;            ///< Lifetime of a cached position
+  Time NodeTraversalTime;       ///< Estimate of the per-hop request/reply time, sets the ring timeout
+  uint8_t TtlStart;             ///< TTL of the first request
+  uint8_t TtlIncrement;         ///< TTL increment between two rings
+  uint8_t TtlThreshold;         ///< Largest expanding-ring TTL, the next request is network wide
+  uint8_t NetDiameter;          ///< TTL of the network wide request
+  Time MaxJitter;               ///< Maximum rebroadcast jitter of a request
+
+  Ptr<Ipv4> m_ipv4;
+  Ptr<Socket> m_socket;
+  uint32_t m_requestId;
+  std::map<Ipv4Address, Entry> m_table;
+  std::map<Ipv4Address, Search> m_searches;
+  std::vector<Ipv4Address> m_pending;           ///< Searches whose first request is not sent yet
+  EventId m_flushEvent;
+  std::map<Ipv4Address, Time> m_failed;         ///< Given-up searches, not restarted by ResolvePositions until expiry
+  /// Requests already handled, (requester, request ID) -> expiry
+  std::map<std::pair<Ipv4Address, uint32_t>, Time> m_seen;
+  Ptr<UniformRandomVariable> m_uniformRandomVariable;
+  Callback<void, Ipv4Address> m_searchDone;
+  EventId m_purgeEvent;
+
+  TracedCallback<Ptr<const Packet> > m_requestTxTrace;
+  TracedCallback<Ptr<const Packet> > m_replyTxTrace;
+  TracedCallback<Ipv4Address, Time> m_lookupTrace;
+  TracedCallback<Ipv4Address> m_lookupFailedTrace;
+
+  void PurgeTimerExpire ();
+  void StartSearch (Ipv4Address target);
+  void FlushRequests ();
+  void SendRequest (const std::vector<Ipv4Address> &targets, uint8_t ttl);
+  void SearchTimeout (std::vector<Ipv4Address> targets, uint32_t requestId);
+  void Recv (Ptr<Socket> socket);
+  void RecvRequest (const RlsHeader &request);
+  void RecvReply (const RlsHeader &reply);
+  void Broadcast (Ptr<Packet> packet);
+  bool IsMyOwnAddress (Ipv4Address id);
+  Ipv4Address GetMainAddress ();
+  void UpdateEntry (Ipv4Address id, Vector position, Time updated);
+};
+
+}   // gpsr
+} // ns3
+#endif /* GPSR_RLS_H */
@@ -0,0 +1,133 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef GPSR_STRATEGY_H
+#define GPSR_STRATEGY_H
+
+#include <algorithm>
+#include <cmath>
+#include "ns3/vector.h"
+
+namespace ns3 {
+namespace gpsr {
+
+/**
+ * \ingroup gpsr
+ * \brief Greedy next-hop strategies, selected by RoutingProtocol::ForwardingStrategy
+ */
+enum NextHopStrategy
+{
+  GPSR_STRATEGY_LINK_DURATION = 0,     //!< longest expected link lifetime (the default)
+  GPSR_STRATEGY_GREEDY = 1,            //!< closest to the destination
+  GPSR_STRATEGY_MFR = 2,               //!< most forward within radius
+  GPSR_STRATEGY_NFP = 3,               //!< nearest with forward progress
+  GPSR_STRATEGY_COMPASS = 4,           //!< smallest angle to the destination
+  GPSR_STRATEGY_AIRTIME = 5,           //!< most progress per expected airtime
+};
+
+/// A greedy decision: where the packet is and where it goes
+struct StrategyContext
+{
+  Vector destination;
+  Vector nodePos;
+  Vector nodeVel;
+  double distance;                     ///< From nodePos to destination
+};
+
+/// A neighbour making progress, as seen by a strategy
+struct NeighborView
+{
+  Vector position;                     ///< Advertised position
+  Vector velocity;                     ///< Only filled for strategies with NeedsVelocity
+  double range;                        ///< Estimated radio range, meters
+  double airtime;                      ///< Expected airtime of a frame, seconds; only filled with NeedsAirtime
+};
+
+/**
+ * \brief Strategies are policies of PositionTable::SelectNeighbor
+ *
+ * Each one scores a neighbour that is closer to the destination than the
+ * node, the highest score wins. Score() is static and inline, so that the
+ * scan over the table is specialized for the strategy at compile time;
+ * NeedsVelocity and NeedsAirtime tell the scan which costly fields of the
+ * view to fill.
+ */
+struct LinkDurationStrategy
+{
+  static const bool NeedsVelocity = true;
+  static const bool NeedsAirtime = false;
+  /// Time until the neighbour leaves the range at the current relative velocity
+  static double Score (const StrategyContext &ctx, const NeighborView &n)
+  {
+    double alpha = n.velocity.x - ctx.nodeVel.x;
+    double beta = n.position.x - ctx.nodePos.x;
+    double gama = n.velocity.y - ctx.nodeVel.y;
+    double sita = n.position.y - ctx.nodePos.y;
+    return (std::sqrt (alpha * alpha + beta * beta * n.range * n.range - std::pow (alpha * sita - beta * gama, 2))
+            - (alpha * beta + gama * sita)) / (alpha * alpha + gama * gama);
+  }
+};
+
+/// Closest to the destination, the original GPSR greedy rule
+struct GreedyStrategy
+{
+  static const bool NeedsVelocity = false;
+  static const bool NeedsAirtime = false;
+  static double Score (const StrategyContext &ctx, const NeighborView &n)
+  {
+    return -CalculateDistance (n.position, ctx.destination);
+  }
+};
+
+/// Most forward within radius: largest projection onto the line to the destination
+struct MfrStrategy
+{
+  static const bool NeedsVelocity = false;
+  static const bool NeedsAirtime = false;
+  static double Score (const StrategyContext &ctx, const NeighborView &n)
+  {
+    return ((n.position.x - ctx.nodePos.x) * (ctx.destination.x - ctx.nodePos.x)
+            + (n.position.y - ctx.nodePos.y) * (ctx.destination.y - ctx.nodePos.y)) / ctx.distance;
+  }
+};
+
+/// Nearest with forward progress: short hops, fewer collisions and retries
+struct NfpStrategy
+{
+  static const bool NeedsVelocity = false;
+  static const bool NeedsAirtime = false;
+  static double Score (const StrategyContext &ctx, const NeighborView &n)
+  {
+    return -CalculateDistance (n.position, ctx.nodePos);
+  }
+};
+
+/// Compass: the cosine of the angle between the neighbour and the destination
+struct CompassStrategy
+{
+  static const bool NeedsVelocity = false;
+  static const bool NeedsAirtime = false;
+  static double Score (const StrategyContext &ctx, const NeighborView &n)
+  {
+    double hop = CalculateDistance (n.position, ctx.nodePos);
+    if (hop == 0)
+      {
+        return -1;
+      }
+    return MfrStrategy::Score (ctx, n) / hop;
+  }
+};
+
+/// Progress towards the destination per expected airtime of a frame
+struct AirtimeStrategy
+{
+  static const bool NeedsVelocity = false;
+  static const bool NeedsAirtime = true;
+  static double Score (const StrategyContext &ctx, const NeighborView &n)
+  {
+    return (ctx.distance - CalculateDistance (n.position, ctx.destination)) / std::max (n.airtime, 1e-9);
+  }
+};
+
+} // gpsr
+} // ns3
+#endif /* GPSR_STRATEGY_H */
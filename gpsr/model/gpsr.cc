@@ -9,14 +9,24 @@
 #include "gpsr.h"
 #include "ns3/log.h"
 #include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/udp-socket-factory.h"
 #include "ns3/wifi-net-device.h"
+#include "ns3/wifi-remote-station-manager.h"
 #include "ns3/adhoc-wifi-mac.h"
+#include "ns3/udp-l4-protocol.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/dca-txop.h"
+#include "ns3/wifi-mac-queue.h"
+#include "ns3/pointer.h"
+#include "ns3/hash.h"
 #include <algorithm>
 #include <limits>
+#include <cmath>
 #include <ns3/udp-header.h>
 #include "ns3/seq-ts-header.h"
 
@@ -25,6 +35,12 @@
 
 #define GPSR_LS_RLS 1
 
+#define GPSR_LS_GLS 2
+
+#define GPSR_LS_ORACLE 3
+
+#define GPSR_LS_HOME 4
+
 NS_LOG_COMPONENT_DEFINE ("GpsrRoutingProtocol");
 
 namespace ns3 {
@@ -76,6 +92,66 @@ struct DeferredRouteOutputTag : public Tag
         }
 };
 
+//RouteOutput计算好的路由信息，通过tag带给AddHeaders，避免重复查询位置服务和移动模型
+struct RouteContextTag : public Tag
+{
+        RouteContext m_ctx;
+
+        RouteContextTag (RouteContext ctx = RouteContext ()) : Tag (),
+                m_ctx (ctx)
+        {
+        }
+
+        static TypeId GetTypeId ()
+        {
+                static TypeId tid = TypeId ("ns3::gpsr::RouteContextTag").SetParent<Tag> ();
+                return tid;
+        }
+
+        TypeId  GetInstanceTypeId () const
+        {
+                return GetTypeId ();
+        }
+
+        uint32_t GetSerializedSize () const
+        {
+                return 8 * sizeof(double) + sizeof(int64_t) + sizeof(uint32_t);
+        }
+
+        void  Serialize (TagBuffer i) const
+        {
+                i.WriteDouble (m_ctx.myPos.x);
+                i.WriteDouble (m_ctx.myPos.y);
+                i.WriteDouble (m_ctx.myVel.x);
+                i.WriteDouble (m_ctx.myVel.y);
+                i.WriteDouble (m_ctx.dstPos.x);
+                i.WriteDouble (m_ctx.dstPos.y);
+                i.WriteDouble (m_ctx.dstVel.x);
+                i.WriteDouble (m_ctx.dstVel.y);
+                i.WriteU64 (m_ctx.dstUpdated.GetTimeStep ());
+                i.WriteU32 (m_ctx.nextHop.Get ());
+        }
+
+        void  Deserialize (TagBuffer i)
+        {
+                m_ctx.myPos.x = i.ReadDouble ();
+                m_ctx.myPos.y = i.ReadDouble ();
+                m_ctx.myVel.x = i.ReadDouble ();
+                m_ctx.myVel.y = i.ReadDouble ();
+                m_ctx.dstPos.x = i.ReadDouble ();
+                m_ctx.dstPos.y = i.ReadDouble ();
+                m_ctx.dstVel.x = i.ReadDouble ();
+                m_ctx.dstVel.y = i.ReadDouble ();
+                m_ctx.dstUpdated = TimeStep (i.ReadU64 ());
+                m_ctx.nextHop.Set (i.ReadU32 ());
+        }
+
+        void  Print (std::ostream &os) const
+        {
+                os << "RouteContextTag: dstPos = " << m_ctx.dstPos << " nextHop = " << m_ctx.nextHop;
+        }
+};
+
 Ptr<UniformRandomVariable> x = CreateObject<UniformRandomVariable> ();
 
 /********** Miscellaneous constants **********/
@@ -85,6 +161,14 @@ Ptr<UniformRandomVariable> x = CreateObject<UniformRandomVariable> ();
 /// Random number between [(-GPSR_MAXJITTER)-GPSR_MAXJITTER] used to jitter HELLO packet transmission.
 #define JITTER (Seconds (x->GetValue (-GPSR_MAXJITTER, GPSR_MAXJITTER)))
 #define FIRST_JITTER (Seconds (x->GetValue (0, GPSR_MAXJITTER))) //first Hello can not be in the past, used only on SetIpv4
+/// Jitter added to the polling period of the adaptive HELLO scheduler
+#define ADAPTIVE_JITTER (Seconds (x->GetValue (0, HelloMinInterval.GetSeconds () / 2)))
+/// Packets kept until the MAC reports on them
+#define GPSR_MAX_INFLIGHT 128
+/// Flows idle this long are forgotten
+#define GPSR_FLOW_EXPIRE (Seconds (10))
+/// Beaconless packets heard are remembered this long, to drop their duplicates
+#define GPSR_CONTENTION_MEMORY (Seconds (2))
 
 
 
@@ -93,16 +177,85 @@ NS_OBJECT_ENSURE_REGISTERED (RoutingProtocol);
 /// UDP Port for GPSR control traffic, not defined by IANA yet
 const uint32_t RoutingProtocol::GPSR_PORT = 666;
 
+std::map<Ipv4Address, GeocastHeader> RoutingProtocol::s_geocastRegions;
+
 //构造函数，初始化；
 RoutingProtocol::RoutingProtocol ()
         : HelloInterval (Seconds (1)),
+        HeaderCompression (false),
+        CompressionContextLifetime (Seconds (5)),
+        CompressionTolerance (10),
+        m_nextFlowId (0),
         MaxQueueLen (64),
         MaxQueueTime (Seconds (30)),
         m_queue (MaxQueueLen, MaxQueueTime),
         HelloIntervalTimer (Timer::CANCEL_ON_DESTROY),
-        PerimeterMode (false)
+        AdaptiveHello (false),
+        HelloMinInterval (Seconds (0.5)),
+        HelloMaxInterval (Seconds (5)),
+        HelloDistanceThreshold (10),
+        m_lastHelloTime (Seconds (0)),
+        m_helloSent (0),
+        DensityAwareHello (false),
+        HelloDensityThreshold (20),
+        HelloSlots (10),
+        m_helloSlot (0),
+        m_helloSeqNo (0),
+        TwoHopHello (false),
+        TwoHopMaxNeighbors (16),
+        TwoHopQuantum (4),
+        m_twoHopBytes (0),
+        m_perimeterEntries (0),
+        LoadTolerance (0),
+        MultipathCandidates (1),
+        MultipathTolerance (0.1),
+        FlowletGap (Seconds (0)),
+        Beaconless (false),
+        ContentionMaxDelay (MilliSeconds (10)),
+        m_contentionWins (0),
+        m_contentionsSuppressed (0),
+        CustodyBufferSize (0),
+        CustodyTimeout (Seconds (60)),
+        m_custodyTaken (0),
+        m_custodyForwarded (0),
+        m_custodyHandovers (0),
+        m_custodyDrops (0),
+        GeocastFlooding (false),
+        GeocastMaxDelay (MilliSeconds (10)),
+        GeocastSuppressDistance (100),
+        m_geocastDelivered (0),
+        m_geocastRebroadcasts (0),
+        m_geocastSuppressed (0),
+        MaxExtrapolation (Seconds (0)),
+        PiggybackMaxAge (Seconds (0)),
+        m_queriesAvoided (0),
+        m_piggybackedFixes (0),
+        GreedyFailureCell (0),
+        GreedyFailureLifetime (Seconds (1)),
+        m_greedyScansSaved (0),
+        m_greedyScans (0),
+        m_neighborsNotScanned (0),
+        m_retryCycle (Seconds (0)),
+        m_failovers (0),
+        m_retryAirtimeSaved (Seconds (0)),
+        ForwardingStrategy (GPSR_STRATEGY_LINK_DURATION),
+        AirtimeMetric (false),
+        AirtimeFrameSize (1000),
+        AirtimeOverhead (MicroSeconds (500)),
+        RangeEstimation (false),
+        DefaultRange (250),
+        RangeThreshold (-96),
+        m_fitX (0),
+        m_fitY (0),
+        m_fitXX (0),
+        m_fitXY (0),
+        m_fitSamples (0),
+        PerimeterMode (false),
+        MaxPerimeterHops (64),
+        PromiscuousLearning (false)
 {
-        m_neighbors = PositionTable ();
+        m_neighbors.SetLinkFailureCallback (MakeCallback (&RoutingProtocol::LinkFailure, this));
+        m_neighbors.SetAirtimeCallback (MakeCallback (&RoutingProtocol::GetAirtime, this));
 }
 
 
@@ -121,11 +274,185 @@ RoutingProtocol::GetTypeId (void)
                                            EnumValue (GPSR_LS_GOD),
                                            MakeEnumAccessor (&RoutingProtocol::LocationServiceName),
                                            MakeEnumChecker (GPSR_LS_GOD, "GOD",
-                                                            GPSR_LS_RLS, "RLS"))
+                                                            GPSR_LS_RLS, "RLS",
+                                                            GPSR_LS_GLS, "GLS",
+                                                            GPSR_LS_ORACLE, "Oracle",
+                                                            GPSR_LS_HOME, "Home"))
+                            .AddAttribute ("MaxExtrapolation", "Destination positions are extrapolated with their velocity for at most this long before greedy selection, 0 disables.",
+                                           TimeValue (Seconds (0)),
+                                           MakeTimeAccessor (&RoutingProtocol::MaxExtrapolation),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("PiggybackMaxAge", "Cached destination fixes (piggybacked by the destination, HELLOs) younger than this are used without asking the location service; 0 always asks and stamps no source position into originated packets.",
+                                           TimeValue (Seconds (0)),
+                                           MakeTimeAccessor (&RoutingProtocol::PiggybackMaxAge),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("GreedyFailureCell", "Side (m) of the destination cells greedy failures are remembered for, 0 disables the memory. A failure is reused only for targets provably no closer to any neighbour.",
+                                           DoubleValue (0),
+                                           MakeDoubleAccessor (&RoutingProtocol::GreedyFailureCell),
+                                           MakeDoubleChecker<double> (0))
+                            .AddAttribute ("GreedyFailureLifetime", "A greedy failure is remembered this long unless a neighbour is added or removed first.",
+                                           TimeValue (Seconds (1)),
+                                           MakeTimeAccessor (&RoutingProtocol::GreedyFailureLifetime),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("TwoHopHello", "Advertise the positions of the neighbours in every HELLO, so that greedy forwarding avoids neighbours with no onward progress.",
+                                           BooleanValue (false),
+                                           MakeBooleanAccessor (&RoutingProtocol::TwoHopHello),
+                                           MakeBooleanChecker ())
+                            .AddAttribute ("TwoHopMaxNeighbors", "Most neighbours advertised in a HELLO, two bytes each; the farthest are kept.",
+                                           UintegerValue (16),
+                                           MakeUintegerAccessor (&RoutingProtocol::TwoHopMaxNeighbors),
+                                           MakeUintegerChecker<uint32_t> (1, 255))
+                            .AddAttribute ("TwoHopQuantum", "Resolution of the advertised neighbour positions, meters; offsets reach 127 times this far.",
+                                           UintegerValue (4),
+                                           MakeUintegerAccessor (&RoutingProtocol::TwoHopQuantum),
+                                           MakeUintegerChecker<uint8_t> (1))
+                            .AddAttribute ("LoadTolerance", "A neighbour with a shorter advertised MAC queue is preferred to the greedy choice if it makes at most this much less progress, meters; 0 disables.",
+                                           DoubleValue (0),
+                                           MakeDoubleAccessor (&RoutingProtocol::LoadTolerance),
+                                           MakeDoubleChecker<double> (0))
+                            .AddAttribute ("MultipathCandidates", "Flows are hashed over up to this many greedy candidates whose scores are near the best one; 1 always takes the best.",
+                                           UintegerValue (1),
+                                           MakeUintegerAccessor (&RoutingProtocol::MultipathCandidates),
+                                           MakeUintegerChecker<uint32_t> (1))
+                            .AddAttribute ("MultipathTolerance", "A candidate is near-equal if its score is within this fraction of the best score.",
+                                           DoubleValue (0.1),
+                                           MakeDoubleAccessor (&RoutingProtocol::MultipathTolerance),
+                                           MakeDoubleChecker<double> (0))
+                            .AddAttribute ("FlowletGap", "A flow idle this long starts a new flowlet that may take another candidate; 0 keeps whole flows on one candidate.",
+                                           TimeValue (Seconds (0)),
+                                           MakeTimeAccessor (&RoutingProtocol::FlowletGap),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("Beaconless", "Send no HELLOs; data packets are broadcast and the receiver making the most progress forwards them.",
+                                           BooleanValue (false),
+                                           MakeBooleanAccessor (&RoutingProtocol::Beaconless),
+                                           MakeBooleanChecker ())
+                            .AddAttribute ("ContentionMaxDelay", "Beaconless receivers wait this long scaled by one minus their progress over DefaultRange before forwarding.",
+                                           TimeValue (MilliSeconds (10)),
+                                           MakeTimeAccessor (&RoutingProtocol::ContentionMaxDelay),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("CustodyBufferSize", "Packets Recovery-mode cannot deliver are carried, up to this many, until a new neighbour can take them; 0 drops them.",
+                                           UintegerValue (0),
+                                           MakeUintegerAccessor (&RoutingProtocol::CustodyBufferSize),
+                                           MakeUintegerChecker<uint32_t> ())
+                            .AddAttribute ("CustodyTimeout", "Carried packets are dropped after this long.",
+                                           TimeValue (Seconds (60)),
+                                           MakeTimeAccessor (&RoutingProtocol::CustodyTimeout),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("GeocastFlooding", "Flood packets sent to a geocast address through the whole network instead of routing them to their region (baseline).",
+                                           BooleanValue (false),
+                                           MakeBooleanAccessor (&RoutingProtocol::GeocastFlooding),
+                                           MakeBooleanChecker ())
+                            .AddAttribute ("GeocastMaxDelay", "Nodes inside a region wait this long scaled by one minus their distance to the transmitter over DefaultRange before rebroadcasting.",
+                                           TimeValue (MilliSeconds (10)),
+                                           MakeTimeAccessor (&RoutingProtocol::GeocastMaxDelay),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("GeocastSuppressDistance", "Nodes inside a region closer than this (m) to a transmitter of a geocast packet do not rebroadcast it.",
+                                           DoubleValue (100),
+                                           MakeDoubleAccessor (&RoutingProtocol::GeocastSuppressDistance),
+                                           MakeDoubleChecker<double> (0))
+                            .AddAttribute ("ForwardingStrategy", "How the greedy next hop is chosen among the neighbours closer to the destination.",
+                                           EnumValue (GPSR_STRATEGY_LINK_DURATION),
+                                           MakeEnumAccessor (&RoutingProtocol::ForwardingStrategy),
+                                           MakeEnumChecker (GPSR_STRATEGY_LINK_DURATION, "LinkDuration",
+                                                            GPSR_STRATEGY_GREEDY, "Greedy",
+                                                            GPSR_STRATEGY_MFR, "MFR",
+                                                            GPSR_STRATEGY_NFP, "NFP",
+                                                            GPSR_STRATEGY_COMPASS, "Compass",
+                                                            GPSR_STRATEGY_AIRTIME, "Airtime"))
+                            .AddAttribute ("AirtimeMetric", "Choose the greedy next hop by progress per expected airtime (rate of the last frame sent to each neighbour and observed retries) instead of geometry; same as ForwardingStrategy Airtime.",
+                                           BooleanValue (false),
+                                           MakeBooleanAccessor (&RoutingProtocol::AirtimeMetric),
+                                           MakeBooleanChecker ())
+                            .AddAttribute ("AirtimeFrameSize", "Frame size (bytes) the expected airtime of a neighbour is computed for.",
+                                           UintegerValue (1000),
+                                           MakeUintegerAccessor (&RoutingProtocol::AirtimeFrameSize),
+                                           MakeUintegerChecker<uint32_t> (1))
+                            .AddAttribute ("AirtimeOverhead", "Airtime of a transmission attempt besides the payload: preamble, interframe spaces, backoff and ACK.",
+                                           TimeValue (MicroSeconds (500)),
+                                           MakeTimeAccessor (&RoutingProtocol::AirtimeOverhead),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("RangeEstimation", "Estimate the radio range of every neighbour from the signal strength and loss of its HELLOs.",
+                                           BooleanValue (false),
+                                           MakeBooleanAccessor (&RoutingProtocol::RangeEstimation),
+                                           MakeBooleanChecker ())
+                            .AddAttribute ("DefaultRange", "Radio range assumed for neighbours without an estimate, meters.",
+                                           DoubleValue (250),
+                                           MakeDoubleAccessor (&RoutingProtocol::DefaultRange),
+                                           MakeDoubleChecker<double> (0))
+                            .AddAttribute ("RangeThreshold", "Weakest signal a frame is still received with, dBm; the PHY EnergyDetectionThreshold.",
+                                           DoubleValue (-96),
+                                           MakeDoubleAccessor (&RoutingProtocol::RangeThreshold),
+                                           MakeDoubleChecker<double> ())
                             .AddAttribute ("PerimeterMode", "Indicates if PerimeterMode is enabled",
                                            BooleanValue (false),
                                            MakeBooleanAccessor (&RoutingProtocol::PerimeterMode),
                                            MakeBooleanChecker ())
+                            .AddAttribute ("MaxPerimeterHops", "Packets are dropped after this many hops in Recovery-mode.",
+                                           UintegerValue (64),
+                                           MakeUintegerAccessor (&RoutingProtocol::MaxPerimeterHops),
+                                           MakeUintegerChecker<uint16_t> (1))
+                            .AddAttribute ("PromiscuousLearning", "Refresh neighbour positions from overheard GPSR data frames",
+                                           BooleanValue (false),
+                                           MakeBooleanAccessor (&RoutingProtocol::PromiscuousLearning),
+                                           MakeBooleanChecker ())
+                            .AddAttribute ("HeaderCompression", "Send a 6-byte flow header instead of the position header once the next hop holds the flow context",
+                                           BooleanValue (false),
+                                           MakeBooleanAccessor (&RoutingProtocol::HeaderCompression),
+                                           MakeBooleanChecker ())
+                            .AddAttribute ("CompressionContextLifetime", "Lifetime of a flow context at the receiving hop.",
+                                           TimeValue (Seconds (5)),
+                                           MakeTimeAccessor (&RoutingProtocol::CompressionContextLifetime),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("CompressionTolerance", "Side (m) of the grid destination positions are quantised to; a flow keeps its context while its destination stays in one square.",
+                                           DoubleValue (10),
+                                           MakeDoubleAccessor (&RoutingProtocol::CompressionTolerance),
+                                           MakeDoubleChecker<double> (1))
+                            .AddAttribute ("AdaptiveHello", "Send HELLOs on displacement or after HelloMaxInterval instead of every HelloInterval",
+                                           BooleanValue (false),
+                                           MakeBooleanAccessor (&RoutingProtocol::AdaptiveHello),
+                                           MakeBooleanChecker ())
+                            .AddAttribute ("HelloMinInterval", "Minimum time between two adaptive HELLOs.",
+                                           TimeValue (Seconds (0.5)),
+                                           MakeTimeAccessor (&RoutingProtocol::HelloMinInterval),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("HelloMaxInterval", "Maximum time between two adaptive or density-aware HELLOs.",
+                                           TimeValue (Seconds (5)),
+                                           MakeTimeAccessor (&RoutingProtocol::HelloMaxInterval),
+                                           MakeTimeChecker ())
+                            .AddAttribute ("HelloDistanceThreshold", "Displacement (m) since the last HELLO that triggers an adaptive HELLO.",
+                                           DoubleValue (10),
+                                           MakeDoubleAccessor (&RoutingProtocol::HelloDistanceThreshold),
+                                           MakeDoubleChecker<double> (0))
+                            .AddAttribute ("DensityAwareHello", "Scale the HELLO interval with the neighbour count and send in address-hashed slots",
+                                           BooleanValue (false),
+                                           MakeBooleanAccessor (&RoutingProtocol::DensityAwareHello),
+                                           MakeBooleanChecker ())
+                            .AddAttribute ("HelloDensityThreshold", "Neighbour count above which the density-aware HELLO interval grows linearly.",
+                                           UintegerValue (20),
+                                           MakeUintegerAccessor (&RoutingProtocol::HelloDensityThreshold),
+                                           MakeUintegerChecker<uint32_t> (1))
+                            .AddAttribute ("HelloSlots", "Number of slots a density-aware HELLO period is divided into.",
+                                           UintegerValue (10),
+                                           MakeUintegerAccessor (&RoutingProtocol::HelloSlots),
+                                           MakeUintegerChecker<uint32_t> (1))
+                            .AddTraceSource ("HelloTx", "A HELLO packet is sent.",
+                                             MakeTraceSourceAccessor (&RoutingProtocol::m_helloTxTrace),
+                                             "ns3::Packet::TracedCallback")
+                            .AddTraceSource ("HelloRx", "A HELLO packet is received.",
+                                             MakeTraceSourceAccessor (&RoutingProtocol::m_helloRxTrace),
+                                             "ns3::gpsr::RoutingProtocol::HelloRxCallback")
+                            .AddTraceSource ("PerimeterExit", "A packet left Recovery-mode, by returning to greedy mode or by delivery.",
+                                             MakeTraceSourceAccessor (&RoutingProtocol::m_perimeterExitTrace),
+                                             "ns3::gpsr::RoutingProtocol::PerimeterCallback")
+                            .AddTraceSource ("RangeEstimate", "The estimated radio range of a neighbour was updated.",
+                                             MakeTraceSourceAccessor (&RoutingProtocol::m_rangeTrace),
+                                             "ns3::gpsr::RoutingProtocol::RangeCallback")
+                            .AddTraceSource ("Failover", "A packet was re-routed after the MAC failed to reach its next hop.",
+                                             MakeTraceSourceAccessor (&RoutingProtocol::m_failoverTrace),
+                                             "ns3::gpsr::RoutingProtocol::FailoverCallback")
+                            .AddTraceSource ("PerimeterDrop", "A packet was dropped in Recovery-mode.",
+                                             MakeTraceSourceAccessor (&RoutingProtocol::m_perimeterDropTrace),
+                                             "ns3::gpsr::RoutingProtocol::PerimeterCallback")
         ;
         return tid;
 }
@@ -138,6 +465,8 @@ void
 RoutingProtocol::DoDispose ()
 {
         m_ipv4 = 0;
+        m_homeRegion = 0;
+        s_geocastRegions.clear ();
         Ipv4RoutingProtocol::DoDispose ();
 }
 
@@ -212,15 +541,37 @@ bool RoutingProtocol::RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
                         return false;
                 }
                 NS_LOG_DEBUG ("Received packet");
+                //竞争转发的包可能从几个转发者先后到达，只交付第一份
+                if (tHeader.Get () == GPSRTYPE_CBF)
+                {
+                        ContentionKey key (std::make_pair (origin, dst), header.GetIdentification ());
+                        if (m_contentionSeen.count (key))
+                        {
+                                NS_LOG_LOGIC ("Duplicate of beaconless packet " << p->GetUid () << " dropped");
+                                return true;
+                        }
+                        m_contentionSeen[key] = Simulator::Now ();
+                }
                 //如果是POS的包，就把POS的包头再去掉，所以不需要了解pos的信息了，直接去掉）
-                if (tHeader.Get () == GPSRTYPE_POS)
+                if (tHeader.Get () == GPSRTYPE_POS || tHeader.Get () == GPSRTYPE_POS_CTX || tHeader.Get () == GPSRTYPE_CBF)
                 {
                         PositionHeader phdr;
                         packet->RemoveHeader (phdr);
+                        //源节点带来的位置，回复时不用再查询位置服务
+                        LearnSource (origin, phdr);
+                        if (phdr.GetInRec ())
+                        {
+                                m_perimeterExitTrace (dst, phdr.GetPerimeterHops ());
+                        }
+                }
+                if (tHeader.Get () == GPSRTYPE_POS_CTX || tHeader.Get () == GPSRTYPE_CPOS)
+                {
+                        FlowHeader flowHeader;
+                        packet->RemoveHeader (flowHeader);
                 }
 
                 //判断是广播接受还是单播接受到的包
-                if (dst != m_ipv4->GetAddress (1, 0).GetBroadcast ())
+                if (GetBroadcastInterface (dst) == 0)
                 {
                         //通过unicast传到的
                         NS_LOG_LOGIC ("Unicast local delivery to " << dst);
@@ -236,6 +587,35 @@ bool RoutingProtocol::RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
                 lcb (packet, header, iif);
                 return true;
         }
+        //发往地理区域的包：区域外贪婪转发，区域内交付并重广播
+        if (IsGeocastAddress (dst))
+        {
+                return RecvGeocast (p, header, iif, ucb, lcb);
+        }
+        //发往home region的包到达区域内的第一个节点时，交给位置服务处理，不再继续转发
+        if (m_homeRegion != 0 && m_homeRegion->IsRegionAddress (dst)
+            && m_homeRegion->IsInRegion (dst, m_ipv4->GetObject<MobilityModel> ()->GetPosition ()))
+        {
+                Ptr<Packet> packet = p->Copy ();
+                TypeHeader tHeader (GPSRTYPE_POS);
+                packet->RemoveHeader (tHeader);
+                if (tHeader.Get () == GPSRTYPE_POS || tHeader.Get () == GPSRTYPE_POS_CTX || tHeader.Get () == GPSRTYPE_CBF)
+                {
+                        PositionHeader phdr;
+                        packet->RemoveHeader (phdr);
+                        LearnSource (origin, phdr);
+                }
+                if (tHeader.Get () == GPSRTYPE_POS_CTX || tHeader.Get () == GPSRTYPE_CPOS)
+                {
+                        FlowHeader flowHeader;
+                        packet->RemoveHeader (flowHeader);
+                }
+                UdpHeader udpHeader;
+                packet->RemoveHeader (udpHeader);
+                NS_LOG_LOGIC ("Home region " << dst << " reached, message of " << origin);
+                m_homeRegion->RecvInRegion (packet);
+                return true;
+        }
         // //如果收到是hello，就不往前传了？
         // if (dst == m_ipv4->GetAddress (1, 0).GetBroadcast ())
         // {
@@ -244,23 +624,17 @@ bool RoutingProtocol::RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
         // }
         Ptr<Packet> packet = p->Copy ();
         //如果不是目的节点继续向前传递
-        // if(packet->GetSize()!=86) //防止回去的不丢
-        // {
-        if(packet->GetSize()!=90)
+        //源节点发出的包以GPSR包头开始；前面多一个UDP包头的先去掉，转发时再放回去
+        bool udp = false;
+        TypeHeader tHeader (GPSRTYPE_POS);
+        packet->PeekHeader (tHeader);
+        if (!tHeader.IsValid ())
         {
                 UdpHeader udpHeader;
-
-                packet->RemoveHeader(udpHeader);
-                NS_LOG_DEBUG("packet input"<<packet->GetSize());
-        }
-        else
-        {
-                packet->RemoveAtStart(4);
-                NS_LOG_DEBUG("packet input"<<packet->GetSize());
+                packet->RemoveHeader (udpHeader);
+                udp = true;
         }
-      //}
-        return Forwarding (packet, header, ucb, ecb);
-        //return Forwarding (p, header, ucb, ecb);
+        return Forwarding (packet, header, ucb, ecb, udp);
 }
 
 
@@ -289,21 +663,15 @@ RoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
         Ipv4Address dst = header.GetDestination ();
 
 
-        Vector dstPos = Vector (1, 0, 0);
-
-        if (!(dst == m_ipv4->GetAddress (1, 0).GetBroadcast ()))
-        {
-                dstPos = m_locationService->GetPosition (dst);
-        }
-        //if received hello boardcast  TODO 还需要验证,应该如何处理
-        else
+        if (GetBroadcastInterface (dst) != 0)
         {
+                //if received hello boardcast  TODO 还需要验证,应该如何处理
                 NS_LOG_DEBUG("send broadcast hello from"<<header.GetSource()<<"TODO fix it ");
 
                 route->SetDestination (dst);
                 if (header.GetSource () == Ipv4Address ("102.102.102.102"))
                 {
-                        route->SetSource (m_ipv4->GetAddress (1, 0).GetLocal ());
+                        route->SetSource (m_ipv4->GetAddress (GetBroadcastInterface (dst), 0).GetLocal ());
                 }
                 else
                 {
@@ -320,16 +688,16 @@ RoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
                         return Ptr<Ipv4Route> ();
                 }
                 return route;
-                // DeferredRouteOutputTag tag;
-                // if (!p->PeekPacketTag (tag))
-                // {
-                //         p->AddPacketTag (tag);
-                // }
-                // return LoopbackRoute (header, oif);
         }
 
+        if (IsGeocastAddress (dst))
+        {
+                return GeocastRouteOutput (p, header, oif, sockerr);
+        }
 
-        if (CalculateDistance (dstPos, m_locationService->GetInvalidPosition ()) == 0 && m_locationService->IsInSearch (dst))
+        RouteContext ctx = ComputeRouteContext (dst);
+
+        if (CalculateDistance (ctx.dstPos, m_locationService->GetInvalidPosition ()) == 0 && m_locationService->IsInSearch (dst))
         {
                 NS_LOG_DEBUG("Cant get desitant position to delay");
                 DeferredRouteOutputTag tag;
@@ -337,52 +705,56 @@ RoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
                 {
                         p->AddPacketTag (tag);
                 }
+                AttachRouteContext (p, ctx);
                 return LoopbackRoute (header, oif);
         }
 
-        Vector myPos;
-        Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
-        myPos.x = MM->GetPosition ().x;
-        myPos.y = MM->GetPosition ().y;
-        Vector myVec;
-        myVec=MM->GetVelocity();
-
-
-        Ipv4Address nextHop;
-
-        if(m_neighbors.isNeighbour (dst))
+        //无信标模式不查邻居表，广播给所有邻居
+        if (Beaconless)
         {
-                nextHop = dst;
+                ctx.nextHop = GetContentionGateway ();
         }
         else
         {
-                nextHop = m_neighbors.BestNeighbor (dstPos, myPos,myVec);
+                ctx.flowHash = GetFlowHash (header.GetSource (), dst);
+                SelectNextHop (dst, ctx);
         }
+        Ipv4Address nextHop = ctx.nextHop;
+        //AddHeaders 会从tag中取出同一份路由信息
+        AttachRouteContext (p, ctx);
 
         if (nextHop != Ipv4Address::GetZero ())
         {
                 //packet add header
                 NS_LOG_DEBUG("Add header in Output");
-                uint32_t updated = (uint32_t) m_locationService->GetEntryUpdateTime (dst).GetSeconds ();
+                //压缩包头时不再在载荷前面重复一份位置头，路由只看AddHeaders加的那一份
+                if (!HeaderCompression)
+                {
+                        uint32_t updated = (uint32_t) ctx.dstUpdated.GetMilliSeconds ();
 
-                TypeHeader tHeader (GPSRTYPE_POS);
-                PositionHeader posHeader (dstPos.x, dstPos.y,  updated, (uint64_t) 0, (uint64_t) 0, (uint8_t) 0, myPos.x, myPos.y);
-                p->AddHeader (posHeader);
-                p->AddHeader (tHeader);
+                        TypeHeader tHeader (GPSRTYPE_POS);
+                        PositionHeader posHeader (ctx.dstPos.x, ctx.dstPos.y,  updated, (uint64_t) 0, (uint64_t) 0, (uint8_t) 0, ctx.myPos.x, ctx.myPos.y);
+                        posHeader.SetDstVelocity (ctx.dstVel);
+                        StampSource (posHeader, ctx);
+                        p->AddHeader (posHeader);
+                        p->AddHeader (tHeader);
+                }
 
-                NS_LOG_DEBUG ("Destination: " << dst<<"Position"<<dstPos); //需要考虑boardcast的地址，位置再1.0.0,source 设置是102.102.102.102
+                NS_LOG_DEBUG ("Destination: " << dst<<"Position"<<ctx.dstPos); //需要考虑boardcast的地址，位置再1.0.0,source 设置是102.102.102.102
 
+                //多个接口时从下一跳所在的接口发出
+                uint32_t interface = Beaconless ? GetMainInterface (m_ipv4) : GetOutputInterface (nextHop);
                 route->SetDestination (dst);
                 if (header.GetSource () == Ipv4Address ("102.102.102.102"))
                 {
-                        route->SetSource (m_ipv4->GetAddress (1, 0).GetLocal ());
+                        route->SetSource (m_ipv4->GetAddress (interface, 0).GetLocal ());
                 }
                 else
                 {
                         route->SetSource (header.GetSource ());
                 }
                 route->SetGateway (nextHop);
-                route->SetOutputDevice (m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (route->GetSource ())));
+                route->SetOutputDevice (m_ipv4->GetNetDevice (interface));
                 route->SetDestination (header.GetDestination ());
                 NS_ASSERT (route != 0);
                 NS_LOG_DEBUG ("Exist route to " << route->GetDestination () << " from interface " << route->GetSource ());
@@ -453,10 +825,28 @@ RoutingProtocol::CheckQueue ()
 
         std::list<Ipv4Address> toRemove;
 
+        //一次查询所有排队目的节点的位置，位置服务可以把需要搜索的目的合并到一个请求里
+        BatchLocationQuery::StatusMap status;
+        BatchLocationQuery::Query (m_locationService, m_queuedAddresses, status);
+
         for (std::list<Ipv4Address>::iterator i = m_queuedAddresses.begin (); i != m_queuedAddresses.end (); ++i)
         {
+                //没有给出结果的目的当作还在搜索，不能按默认值当成已找到
+                BatchLocationQuery::StatusMap::const_iterator result = status.find (*i);
+                if (result == status.end () || result->second == BatchLocationQuery::POSITION_IN_SEARCH)
+                {
+                        continue;
+                }
+                if (result->second == BatchLocationQuery::POSITION_NOT_FOUND)
+                {
+                        m_queue.DropPacketWithDst (*i);
+                        NS_LOG_LOGIC ("Location Service did not find dst. Drop packet to " << *i);
+                        toRemove.insert (toRemove.begin (), *i);
+                        continue;
+                }
+                //批量找到的目的同样经过SendQueuedPackets，用新位置重写包头后再发送；
                 //如果该地址发送了,那么就把地址放到需要删除的列表中，之后一起删除
-                if (SendPacketFromQueue (*i)) //判断的过程同时调用发送packet函数
+                if (SendQueuedPackets (*i))
                 {
                         //Insert in a list to remove later
                         toRemove.insert (toRemove.begin (), *i);
@@ -475,14 +865,23 @@ RoutingProtocol::CheckQueue ()
         }
 }
 
+//位置服务找到（或放弃寻找）目的节点时立即处理队列，不用等CheckQueueTimer
+void
+RoutingProtocol::SearchDone (Ipv4Address dst)
+{
+        NS_LOG_FUNCTION (this << dst);
+        if (SendPacketFromQueue (dst))
+        {
+                m_queuedAddresses.remove (dst);
+        }
+}
+
 
 //从queue中发送，前面是直接发送？
 bool
 RoutingProtocol::SendPacketFromQueue (Ipv4Address dst)
 {
         NS_LOG_FUNCTION (this);
-        bool recovery = false;
-        QueueEntry queueEntry;
         NS_LOG_DEBUG ("SendPacketFromQueue ");
         //先通过locationService找到目的节点的位置
         if (m_locationService->IsInSearch (dst))
@@ -498,39 +897,66 @@ RoutingProtocol::SendPacketFromQueue (Ipv4Address dst)
                 return true;
         }
 
-        Vector myPos;
-        Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
-        myPos= MM->GetPosition ();
-        Vector myVec;
-        myVec=MM->GetVelocity();
-        Ipv4Address nextHop;
+        return SendQueuedPackets (dst);
+}
 
-        //如果目的节点就是邻居节点，那么直接传给目的节点
-        if(m_neighbors.isNeighbour (dst))
+//目的节点位置已知，发送它的排队包（必要时进入recovery mode）
+bool
+RoutingProtocol::SendQueuedPackets (Ipv4Address dst)
+{
+        NS_LOG_FUNCTION (this << dst);
+        bool recovery = false;
+        QueueEntry queueEntry;
+        RouteContext ctx = ComputeRouteContext (dst);
+        if (CalculateDistance (ctx.dstPos, m_locationService->GetInvalidPosition ()) == 0)
         {
-                nextHop = dst;
+                m_queue.DropPacketWithDst (dst);
+                NS_LOG_LOGIC ("No valid position of " << dst << ". Drop its queued packets");
+                return true;
         }
-        //否则，就寻找距离目的最近的邻居节点
-        else{
-                //找到目标节点坐标的位置
-                Vector dstPos = m_locationService->GetPosition (dst);
 
-                nextHop = m_neighbors.BestNeighbor (dstPos, myPos,myVec);
-                if (nextHop == Ipv4Address::GetZero ())
+        if (Beaconless)
+        {
+                //无信标模式：直接广播，由邻居竞争转发
+                Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+                route->SetDestination (dst);
+                route->SetGateway (GetContentionGateway ());
+                route->SetOutputDevice (m_ipv4->GetNetDevice (GetMainInterface (m_ipv4)));
+                while (m_queue.Dequeue (dst, queueEntry))
                 {
-                        NS_LOG_LOGIC ("Fallback to recovery-mode. Packets to " << dst);
-                        recovery = true;
+                        Ptr<Packet> p = ConstCast<Packet> (queueEntry.GetPacket ());
+                        Ipv4Header header = queueEntry.GetIpv4Header ();
+                        PositionHeader posHeader;
+                        if (!RestampQueuedPacket (p, ctx, posHeader))
+                        {
+                                continue;
+                        }
+                        p->AddHeader (posHeader);
+                        p->AddHeader (TypeHeader (GPSRTYPE_CBF));
+                        if (header.GetSource () == Ipv4Address ("102.102.102.102"))
+                        {
+                                header.SetSource (GetMainAddress ());
+                        }
+                        route->SetSource (header.GetSource ());
+                        queueEntry.GetUnicastForwardCallback () (route, p, header);
                 }
+                return true;
+        }
 
+        //如果目的节点就是邻居节点，那么直接传给目的节点，否则寻找距离目的最近的邻居节点
+        ctx.flowHash = GetFlowHash (Ipv4Address::GetAny (), dst);
+        SelectNextHop (dst, ctx);
+        Vector myPos = ctx.myPos;
+        Ipv4Address nextHop = ctx.nextHop;
+        if (nextHop == Ipv4Address::GetZero ())
+        {
+                NS_LOG_LOGIC ("Fallback to recovery-mode. Packets to " << dst);
+                recovery = true;
         }
         //开启recovery mode
         if(recovery)
         {
 
-                Vector Position;
-                Vector previousHop;
-                uint32_t updated;
-
                 //将目的节点的发送request出队，修改发送包的信息，更新包里面的本节点的地理位置信息（之前如果不是recovery）
                 //因为调用recovery mode需要记录当前开始recovery mode的节点位置（recvPos），因而需要展开包给与当前节点的位置信息
 
@@ -540,26 +966,20 @@ RoutingProtocol::SendPacketFromQueue (Ipv4Address dst)
                         UnicastForwardCallback ucb = queueEntry.GetUnicastForwardCallback ();
                         Ipv4Header header = queueEntry.GetIpv4Header ();
 
-                        TypeHeader tHeader (GPSRTYPE_POS);
-                        p->RemoveHeader (tHeader);
-                        if (!tHeader.IsValid ())
-                        {
-                                NS_LOG_DEBUG ("GPSR message " << p->GetUid () << " with unknown type received: " << tHeader.Get () << ". Drop");
-                                NS_LOG_DEBUG ("recovery-mode meet error");
-                                return false;         // drop
-                        }
-                        if (tHeader.Get () == GPSRTYPE_POS)
+                        PositionHeader posHeader;
+                        if (!RestampQueuedPacket (p, ctx, posHeader))
                         {
-                                PositionHeader hdr;
-                                p->RemoveHeader (hdr);
-                                Position.x = hdr.GetDstPosx ();
-                                Position.y = hdr.GetDstPosy ();
-                                updated = hdr.GetUpdated ();
+                                continue;
                         }
-
-                        PositionHeader posHeader (Position.x, Position.y,  updated, myPos.x, myPos.y, (uint8_t) 1, Position.x, Position.y);
+                        posHeader.SetRecPosx (myPos.x);
+                        posHeader.SetRecPosy (myPos.y);
+                        posHeader.SetInRec (1);
+                        posHeader.SetLastPosx (ctx.dstPos.x);
+                        posHeader.SetLastPosy (ctx.dstPos.y);
+                        posHeader.StartPerimeter (myPos);
+                        m_perimeterEntries++;
                         p->AddHeader (posHeader);         //enters in recovery with last edge from Dst
-                        p->AddHeader (tHeader);
+                        p->AddHeader (TypeHeader (GPSRTYPE_POS));
 
                         RecoveryMode(dst, p, ucb, header);
                 }
@@ -571,8 +991,7 @@ RoutingProtocol::SendPacketFromQueue (Ipv4Address dst)
         route->SetDestination (dst);
         route->SetGateway (nextHop);
 
-        // FIXME: Does not work for multiple interfaces
-        route->SetOutputDevice (m_ipv4->GetNetDevice (1));
+        route->SetOutputDevice (m_ipv4->GetNetDevice (GetOutputInterface (nextHop)));
 
         while (m_queue.Dequeue (dst, queueEntry))
         {
@@ -584,36 +1003,139 @@ RoutingProtocol::SendPacketFromQueue (Ipv4Address dst)
 
                 if (header.GetSource () == Ipv4Address ("102.102.102.102"))
                 {
-                        route->SetSource (m_ipv4->GetAddress (1, 0).GetLocal ());
-                        header.SetSource (m_ipv4->GetAddress (1, 0).GetLocal ());
+                        route->SetSource (m_ipv4->GetAddress (GetOutputInterface (nextHop), 0).GetLocal ());
+                        header.SetSource (route->GetSource ());
                 }
                 else
                 {
                         route->SetSource (header.GetSource ());
                 }
-                ucb (route, p, header);
+                PositionHeader posHeader;
+                if (!RestampQueuedPacket (p, ctx, posHeader))
+                {
+                        continue;
+                }
+                uint16_t flowId = 0;
+                bool hasFlow = HeaderCompression && GetFlowId (dst, flowId);
+                AddPositionHeaders (p, header.GetSource (), nextHop, posHeader, hasFlow, FlowHeader (flowId));
+                SendTracked (ucb, route, p, header, ctx.dstPos);
         }
         return true;
 }
 
+//排队的包是在目的位置未知时加的包头，位置还是无效的；去掉这些包头，按现在的路由信息重新生成位置包头
+bool
+RoutingProtocol::RestampQueuedPacket (Ptr<Packet> p, const RouteContext &ctx, PositionHeader &posHeader)
+{
+        TypeHeader tHeader (GPSRTYPE_POS);
+        p->RemoveHeader (tHeader);
+        if (!tHeader.IsValid ())
+        {
+                NS_LOG_DEBUG ("Queued packet " << p->GetUid () << " with unknown type " << tHeader.Get () << ". Drop");
+                return false;
+        }
+        if (tHeader.Get () == GPSRTYPE_POS || tHeader.Get () == GPSRTYPE_POS_CTX || tHeader.Get () == GPSRTYPE_CBF)
+        {
+                PositionHeader stale;
+                p->RemoveHeader (stale);
+        }
+        if (tHeader.Get () == GPSRTYPE_POS_CTX || tHeader.Get () == GPSRTYPE_CPOS)
+        {
+                FlowHeader flowHeader;
+                p->RemoveHeader (flowHeader);
+        }
 
-void
-RoutingProtocol::RecoveryMode(Ipv4Address dst, Ptr<Packet> p, UnicastForwardCallback ucb, Ipv4Header header){
+        uint32_t updated = (uint32_t) ctx.dstUpdated.GetMilliSeconds ();
+        posHeader = PositionHeader (ctx.dstPos.x, ctx.dstPos.y, updated, (uint64_t) 0, (uint64_t) 0, (uint8_t) 0, ctx.myPos.x, ctx.myPos.y);
+        posHeader.SetDstVelocity (ctx.dstVel);
+        StampSource (posHeader, ctx);
+        return true;
+}
 
-        Vector Position;
-        Vector previousHop;
-        uint32_t updated;
-        uint64_t positionX;
-        uint64_t positionY;
+
+//线段a-b与c-d的交点，平行或不相交时返回false
+static bool
+SegmentIntersection (Vector a, Vector b, Vector c, Vector d, Vector &point)
+{
+        double den = (b.x - a.x) * (d.y - c.y) - (b.y - a.y) * (d.x - c.x);
+        if (den == 0)
+        {
+                return false;
+        }
+        double t = ((c.x - a.x) * (d.y - c.y) - (c.y - a.y) * (d.x - c.x)) / den;
+        double u = ((c.x - a.x) * (b.y - a.y) - (c.y - a.y) * (b.x - a.x)) / den;
+        if (t < 0 || t > 1 || u < 0 || u > 1)
+        {
+                return false;
+        }
+        point = Vector (a.x + t * (b.x - a.x), a.y + t * (b.y - a.y), 0);
+        return true;
+}
+
+//右手准则在平面图上选下一跳；下一条边在比Lf更靠近目的的地方穿过Lp-D线段时换到下一个面。
+//选到下一跳时把面的状态和本节点位置写回hdr，否则hdr不变
+Ipv4Address
+RoutingProtocol::PerimeterNextHop (Ipv4Address dst, PositionHeader &hdr)
+{
+        Vector mmPos = m_ipv4->GetObject<MobilityModel> ()->GetPosition ();
         Vector myPos;
-        Vector recPos;
+        myPos.x = (uint64_t) mmPos.x;
+        myPos.y = (uint64_t) mmPos.y;
+        Vector Position (hdr.GetDstPosx (), hdr.GetDstPosy (), 0);
+        Vector recPos (hdr.GetRecPosx (), hdr.GetRecPosy (), 0);
+        Vector previousHop (hdr.GetLastPosx (), hdr.GetLastPosy (), 0);
+
+        Ipv4Address me = GetMainAddress ();
+        Vector facePos = hdr.GetFacePos ();
+        Vector reference = previousHop;
+        Vector nextPos;
+        Ipv4Address nextHop = Ipv4Address::GetZero ();
+        bool newFace = hdr.GetFirstEdgeFrom () == Ipv4Address::GetZero ();
+        for (uint32_t k = 0; k <= m_neighbors.GetNeighborCount (); k++)
+        {
+                nextHop = m_neighbors.PlanarRightHand (reference, myPos, nextPos);
+                Vector crossing;
+                if (nextHop == Ipv4Address::GetZero ()
+                    || !SegmentIntersection (myPos, nextPos, recPos, Position, crossing)
+                    || CalculateDistance (crossing, Position) >= CalculateDistance (facePos, Position) - 1)
+                {
+                        break;
+                }
+                facePos = crossing;
+                reference = nextPos;
+                newFace = true;
+        }
+        if (nextHop == Ipv4Address::GetZero ())
+        {
+                NS_LOG_LOGIC ("Recovery-mode to " << dst << " without neighbours");
+                return nextHop;
+        }
+        if (!newFace && hdr.GetFirstEdgeFrom () == me && hdr.GetFirstEdgeTo () == nextHop)
+        {
+                //又回到这个面的第一条边，整个面已经绕过一圈，目的不可达
+                NS_LOG_LOGIC ("Face toured without reaching " << dst);
+                return Ipv4Address::GetZero ();
+        }
+        if (hdr.GetPerimeterHops () >= MaxPerimeterHops)
+        {
+                NS_LOG_LOGIC ("Recovery-mode to " << dst << " exceeded " << MaxPerimeterHops << " hops");
+                return Ipv4Address::GetZero ();
+        }
 
-        Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
-        positionX = MM->GetPosition ().x;
-        positionY = MM->GetPosition ().y;
-        myPos.x = positionX;
-        myPos.y = positionY;
+        if (newFace)
+        {
+                hdr.SetFirstEdge (me, nextHop);
+        }
+        hdr.SetInRec (1);
+        hdr.SetLastPosx (myPos.x);
+        hdr.SetLastPosy (myPos.y);
+        hdr.SetFacePos (facePos);
+        hdr.SetPerimeterHops (hdr.GetPerimeterHops () + 1);
+        return nextHop;
+}
 
+void
+RoutingProtocol::RecoveryMode(Ipv4Address dst, Ptr<Packet> p, UnicastForwardCallback ucb, Ipv4Header header){
 
         //因为recovery需要记录中途节点的位置（lastPos），需要展开包，记录下当前节点的位置信息
         TypeHeader tHeader (GPSRTYPE_POS);
@@ -623,37 +1145,31 @@ RoutingProtocol::RecoveryMode(Ipv4Address dst, Ptr<Packet> p, UnicastForwardCall
                 NS_LOG_DEBUG ("GPSR message " << p->GetUid () << " with unknown type received: " << tHeader.Get () << ". Drop");
                 return; // drop
         }
+        PositionHeader hdr;
         if (tHeader.Get () == GPSRTYPE_POS)
         {
-                PositionHeader hdr;
                 p->RemoveHeader (hdr);
-                Position.x = hdr.GetDstPosx ();
-                Position.y = hdr.GetDstPosy ();
-                updated = hdr.GetUpdated ();
-                recPos.x = hdr.GetRecPosx ();
-                recPos.y = hdr.GetRecPosy ();
-                previousHop.x = hdr.GetLastPosx ();
-                previousHop.y = hdr.GetLastPosy ();
         }
 
-        PositionHeader posHeader (Position.x, Position.y,  updated, recPos.x, recPos.y, (uint8_t) 1, myPos.x, myPos.y);
-        p->AddHeader (posHeader);
-        p->AddHeader (tHeader);
-
-
-
-        Ipv4Address nextHop = m_neighbors.BestAngle (previousHop, myPos); // best angle 来寻找
+        PositionHeader posHeader = hdr;
+        Ipv4Address nextHop = PerimeterNextHop (dst, posHeader);
         if (nextHop == Ipv4Address::GetZero ())
         {
+                if (!TakeCustody (p, header, ucb, hdr))
+                {
+                        NS_LOG_LOGIC ("Recovery-mode packet to " << dst << " dropped");
+                        m_perimeterDropTrace (dst, hdr.GetPerimeterHops ());
+                }
                 return;
         }
+        p->AddHeader (posHeader);
+        p->AddHeader (tHeader);
 
         Ptr<Ipv4Route> route = Create<Ipv4Route> ();
         route->SetDestination (dst);
         route->SetGateway (nextHop);
 
-        // FIXME: Does not work for multiple interfaces
-        route->SetOutputDevice (m_ipv4->GetNetDevice (1));
+        route->SetOutputDevice (m_ipv4->GetNetDevice (GetOutputInterface (nextHop)));
         route->SetSource (header.GetSource ());
 
         ucb (route, p, header);
@@ -704,7 +1220,30 @@ RoutingProtocol::NotifyInterfaceUp (uint32_t interface)
                 return;
         }
 
+        //位置表先删掉失败的邻居，ProcessTxError再为失败的包选下一跳
         mac->TraceConnectWithoutContext ("TxErrHeader", m_neighbors.GetTxErrorCallback ());
+        mac->TraceConnectWithoutContext ("TxErrHeader", MakeCallback (&RoutingProtocol::ProcessTxError, this));
+        mac->TraceConnectWithoutContext ("TxOkHeader", MakeCallback (&RoutingProtocol::ProcessTxOk, this));
+        wifi->GetPhy ()->TraceConnectWithoutContext ("PhyTxBegin", MakeCallback (&RoutingProtocol::ProcessPhyTxBegin, this));
+        wifi->GetRemoteStationManager ()->TraceConnectWithoutContext ("MacTxDataFailed",
+                                                                      MakeCallback (&RoutingProtocol::ProcessTxDataFailed, this));
+        if (RangeEstimation)
+        {
+                wifi->GetPhy ()->TraceConnectWithoutContext ("MonitorSnifferRx",
+                                                             MakeCallback (&RoutingProtocol::MonitorSnifferRx, this));
+        }
+        if (AirtimeMetric || ForwardingStrategy == GPSR_STRATEGY_AIRTIME)
+        {
+                wifi->GetPhy ()->TraceConnectWithoutContext ("MonitorSnifferTx",
+                                                             MakeCallback (&RoutingProtocol::MonitorSnifferTx, this));
+        }
+        m_neighbors.AddArpCache (l3->GetInterface (interface)->GetArpCache ());
+
+        if (PromiscuousLearning)
+        {
+                GetObject<Node> ()->RegisterProtocolHandler (MakeCallback (&RoutingProtocol::PromiscReceive, this),
+                                                             Ipv4L3Protocol::PROT_NUMBER, dev, true);
+        }
 
 }
 
@@ -740,42 +1279,150 @@ RoutingProtocol::RecvGPSR (Ptr<Socket> socket)
         InetSocketAddress inetSourceAddr = InetSocketAddress::ConvertFrom (sourceAddress);
         Ipv4Address sender = inetSourceAddr.GetIpv4 ();
         Ipv4Address receiver = m_socketAddresses[socket].GetLocal ();
+        m_helloRxTrace (sender, receiver, hdr.GetSeqNo ());
         NS_LOG_DEBUG("update position"<<Position.x<<Position.y );
         //更新neighbor的信息
         UpdateRouteToNeighbor (sender, receiver, Position);
+        if (hdr.HasLoad ())
+        {
+                m_neighbors.SetLoad (sender, hdr.GetLoad ());
+        }
+        if (tHeader.Get () == GPSRTYPE_HELLO_EXT)
+        {
+                //邻居的邻居：还原成绝对位置
+                NeighborSummaryHeader summary;
+                packet->RemoveHeader (summary);
+                std::vector<Vector> twoHop;
+                for (uint32_t k = 0; k < summary.GetNeighborCount (); ++k)
+                {
+                        Vector offset = summary.GetNeighbor (k);
+                        twoHop.push_back (Vector (Position.x + offset.x, Position.y + offset.y, 0));
+                }
+                m_neighbors.SetTwoHop (sender, twoHop);
+        }
+        m_dstCache.Update (sender, Position, Simulator::Now ());
+        if (RangeEstimation)
+        {
+                UpdateRange (sender, Position, hdr.GetSeqNo ());
+        }
 
 }
 
 
+//监听到的不是发给自己的数据包，只解析GPSR的type和position包头，更新邻居位置
 void
-RoutingProtocol::UpdateRouteToNeighbor (Ipv4Address sender, Ipv4Address receiver, Vector Pos)
-{
-        m_neighbors.AddEntry (sender, Pos);
-}
-
-
-//关闭interface的socket
-void
-RoutingProtocol::NotifyInterfaceDown (uint32_t interface)
+RoutingProtocol::PromiscReceive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                 const Address &from, const Address &to, NetDevice::PacketType packetType)
 {
-        NS_LOG_FUNCTION (this << m_ipv4->GetAddress (interface, 0).GetLocal ());
+        if (packetType != NetDevice::PACKET_OTHERHOST && packetType != NetDevice::PACKET_BROADCAST)
+        {
+                return;
+        }
+        Ptr<Packet> p = packet->Copy ();
+        Ipv4Header ipHeader;
+        p->RemoveHeader (ipHeader);
+        Mac48Address transmitter = Mac48Address::ConvertFrom (from);
 
-        // Disable layer 2 link state monitoring (if possible)
-        Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol> ();
-        Ptr<NetDevice> dev = l3->GetNetDevice (interface);
-        Ptr<WifiNetDevice> wifi = dev->GetObject<WifiNetDevice> ();
-        if (wifi != 0)
+        if (packetType == NetDevice::PACKET_BROADCAST)
         {
-                Ptr<WifiMac> mac = wifi->GetMac ()->GetObject<AdhocWifiMac> ();
-                if (mac != 0)
+                //GPSR never relays broadcasts, so the IP source of a broadcast frame is its transmitter;
+                //beaconless data frames are relayed broadcasts to a unicast address
+                if (ipHeader.GetDestination ().IsBroadcast () || GetBroadcastInterface (ipHeader.GetDestination ()) != 0)
                 {
-                        mac->TraceDisconnectWithoutContext ("TxErrHeader",
-                                                            m_neighbors.GetTxErrorCallback ());
+                        m_macToIp[transmitter] = ipHeader.GetSource ();
                 }
+                return;
         }
 
-        // Close socket
-        Ptr<Socket> socket = FindSocketWithInterfaceAddress (m_ipv4->GetAddress (interface, 0));
+        std::map<Mac48Address, Ipv4Address>::const_iterator i = m_macToIp.find (transmitter);
+        if (i == m_macToIp.end () || ipHeader.GetProtocol () != UdpL4Protocol::PROT_NUMBER)
+        {
+                return;
+        }
+
+        //originated frames start with the GPSR headers, relayed ones carry the UDP header in front of them
+        TypeHeader tHeader (GPSRTYPE_POS);
+        p->PeekHeader (tHeader);
+        if (!tHeader.IsValid ())
+        {
+                UdpHeader udpHeader;
+                p->RemoveHeader (udpHeader);
+                p->PeekHeader (tHeader);
+        }
+        if (!tHeader.IsValid () || (tHeader.Get () != GPSRTYPE_POS && tHeader.Get () != GPSRTYPE_POS_CTX))
+        {
+                return;
+        }
+        p->RemoveHeader (tHeader);
+        PositionHeader hdr;
+        p->RemoveHeader (hdr);
+
+        Vector Position;
+        Position.x = hdr.GetLastPosx ();
+        Position.y = hdr.GetLastPosy ();
+        NS_LOG_DEBUG ("Overheard " << i->second << " at " << Position);
+        m_neighbors.AddEntry (i->second, Position, m_ipv4->GetInterfaceForDevice (device));
+}
+
+
+void
+RoutingProtocol::UpdateRouteToNeighbor (Ipv4Address sender, Ipv4Address receiver, Vector Pos)
+{
+        bool appeared = !m_neighbors.isNeighbour (sender);
+        m_neighbors.AddEntry (sender, Pos, m_ipv4->GetInterfaceForAddress (receiver));
+        //新邻居出现时看看携带的包能不能交出去；等这个hello处理完再看
+        if (appeared && !m_custody.empty ())
+        {
+                Simulator::ScheduleNow (&RoutingProtocol::ReleaseCustody, this);
+        }
+}
+
+
+//关闭interface的socket
+void
+RoutingProtocol::NotifyInterfaceDown (uint32_t interface)
+{
+        NS_LOG_FUNCTION (this << m_ipv4->GetAddress (interface, 0).GetLocal ());
+
+        // Disable layer 2 link state monitoring (if possible)
+        Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol> ();
+        Ptr<NetDevice> dev = l3->GetNetDevice (interface);
+        Ptr<WifiNetDevice> wifi = dev->GetObject<WifiNetDevice> ();
+        if (wifi != 0)
+        {
+                Ptr<WifiMac> mac = wifi->GetMac ()->GetObject<AdhocWifiMac> ();
+                if (mac != 0)
+                {
+                        mac->TraceDisconnectWithoutContext ("TxErrHeader",
+                                                            m_neighbors.GetTxErrorCallback ());
+                        mac->TraceDisconnectWithoutContext ("TxErrHeader",
+                                                            MakeCallback (&RoutingProtocol::ProcessTxError, this));
+                        mac->TraceDisconnectWithoutContext ("TxOkHeader",
+                                                            MakeCallback (&RoutingProtocol::ProcessTxOk, this));
+                }
+                wifi->GetPhy ()->TraceDisconnectWithoutContext ("PhyTxBegin",
+                                                                MakeCallback (&RoutingProtocol::ProcessPhyTxBegin, this));
+                wifi->GetRemoteStationManager ()->TraceDisconnectWithoutContext ("MacTxDataFailed",
+                                                                                 MakeCallback (&RoutingProtocol::ProcessTxDataFailed, this));
+                if (RangeEstimation)
+                {
+                        wifi->GetPhy ()->TraceDisconnectWithoutContext ("MonitorSnifferRx",
+                                                                        MakeCallback (&RoutingProtocol::MonitorSnifferRx, this));
+                }
+                if (AirtimeMetric || ForwardingStrategy == GPSR_STRATEGY_AIRTIME)
+                {
+                        wifi->GetPhy ()->TraceDisconnectWithoutContext ("MonitorSnifferTx",
+                                                                        MakeCallback (&RoutingProtocol::MonitorSnifferTx, this));
+                }
+                m_neighbors.DelArpCache (l3->GetInterface (interface)->GetArpCache ());
+                if (PromiscuousLearning)
+                {
+                        GetObject<Node> ()->UnregisterProtocolHandler (MakeCallback (&RoutingProtocol::PromiscReceive, this));
+                }
+        }
+
+        // Close socket
+        Ptr<Socket> socket = FindSocketWithInterfaceAddress (m_ipv4->GetAddress (interface, 0));
         NS_ASSERT (socket);
         socket->Close ();
         m_socketAddresses.erase (socket);
@@ -874,129 +1521,1523 @@ RoutingProtocol::NotifyRemoveAddress (uint32_t i, Ipv4InterfaceAddress address)
                         // Add local broadcast record to the routing table
                         Ptr<NetDevice> dev = m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (iface.GetLocal ()));
 
-                }
-                if (m_socketAddresses.empty ())
+                }
+                if (m_socketAddresses.empty ())
+                {
+                        NS_LOG_LOGIC ("No gpsr interfaces");
+                        m_neighbors.Clear ();
+                        m_locationService->Clear ();
+                        return;
+                }
+        }
+        else
+        {
+                NS_LOG_LOGIC ("Remove address not participating in GPSR operation");
+        }
+}
+
+void
+RoutingProtocol::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+        NS_ASSERT (ipv4 != 0);
+        NS_ASSERT (m_ipv4 == 0);
+
+        m_ipv4 = ipv4;
+
+        //当HelloIntercalTimer到时间了 就在FIRST_JITTER时间后调用HelloTimerExpire
+        HelloIntervalTimer.SetFunction (&RoutingProtocol::HelloTimerExpire, this);
+        HelloIntervalTimer.Schedule (FIRST_JITTER);
+
+        //Schedule only when it has packets on queue
+        CheckQueueTimer.SetFunction (&RoutingProtocol::CheckQueue, this);
+
+        Simulator::ScheduleNow (&RoutingProtocol::Start, this);
+}
+
+void
+RoutingProtocol::HelloTimerExpire ()
+{
+        m_dstCache.Purge ();
+        for (std::map<ContentionKey, Time>::iterator i = m_contentionSeen.begin (); i != m_contentionSeen.end (); )
+        {
+                if (i->second + GPSR_CONTENTION_MEMORY <= Simulator::Now ())
+                {
+                        m_contentionSeen.erase (i++);
+                }
+                else
+                {
+                        ++i;
+                }
+        }
+        for (std::list<CustodyEntry>::iterator i = m_custody.begin (); i != m_custody.end (); )
+        {
+                if (i->expire <= Simulator::Now ())
+                {
+                        NS_LOG_LOGIC ("Carried packet to " << i->header.GetDestination () << " timed out. Drop");
+                        m_custodyDrops++;
+                        i = m_custody.erase (i);
+                }
+                else
+                {
+                        ++i;
+                }
+        }
+        for (std::map<std::pair<Ipv4Address, Ipv4Address>, Flowlet>::iterator i = m_flowlets.begin (); i != m_flowlets.end (); )
+        {
+                if (i->second.last + GPSR_FLOW_EXPIRE <= Simulator::Now ())
+                {
+                        m_flowlets.erase (i++);
+                }
+                else
+                {
+                        ++i;
+                }
+        }
+        for (std::map<Cell, GreedyFailure>::iterator i = m_greedyFailures.begin (); i != m_greedyFailures.end (); )
+        {
+                if (i->second.expire <= Simulator::Now () || i->second.version != m_neighbors.GetVersion ())
+                {
+                        m_greedyFailures.erase (i++);
+                }
+                else
+                {
+                        ++i;
+                }
+        }
+        //邻居表里已经没有的节点，射程估计和没用掉的信号强度也一起删掉
+        m_neighbors.Purge ();
+        for (std::map<Ipv4Address, RangeEstimate>::iterator i = m_ranges.begin (); i != m_ranges.end (); )
+        {
+                if (!m_neighbors.isNeighbour (i->first))
+                {
+                        m_ranges.erase (i++);
+                }
+                else
+                {
+                        ++i;
+                }
+        }
+        for (std::map<Ipv4Address, double>::iterator i = m_helloSignal.begin (); i != m_helloSignal.end (); )
+        {
+                if (!m_neighbors.isNeighbour (i->first))
+                {
+                        m_helloSignal.erase (i++);
+                }
+                else
+                {
+                        ++i;
+                }
+        }
+        for (std::map<Mac48Address, LinkStats>::iterator i = m_linkStats.begin (); i != m_linkStats.end (); )
+        {
+                if (m_neighbors.LookupNeighbor (i->first) == Ipv4Address::GetZero ())
+                {
+                        m_linkStats.erase (i++);
+                }
+                else
+                {
+                        ++i;
+                }
+        }
+        if (Beaconless)
+        {
+                //无信标模式不发hello，定时器只用来清理缓存
+                HelloIntervalTimer.Cancel ();
+                HelloIntervalTimer.Schedule (HelloInterval);
+                return;
+        }
+        if (DensityAwareHello)
+        {
+                //密集场景：按邻居数量放大hello间隔，按地址hash固定发送时隙，避免抖动hello相互碰撞
+                SendHello ();
+                m_neighbors.SetEntryLifeTime (DensityHelloInterval () + DensityHelloInterval ());
+                HelloIntervalTimer.Cancel ();
+                HelloIntervalTimer.Schedule (NextHelloSlot ());
+                return;
+        }
+
+        if (!AdaptiveHello)
+        {
+                SendHello ();
+                HelloIntervalTimer.Cancel ();
+                //新建一个时间延时为HelloInterval + JITTER的Timer
+                HelloIntervalTimer.Schedule (HelloInterval + JITTER);
+                return;
+        }
+
+        //自适应hello：移动超过阈值或者超过最大间隔才发送，静止节点不再按HelloInterval发送
+        Vector myPos = m_ipv4->GetObject<MobilityModel> ()->GetPosition ();
+        if (m_helloSent == 0
+            || CalculateDistance (myPos, m_lastHelloPos) >= HelloDistanceThreshold
+            || Simulator::Now () - m_lastHelloTime >= HelloMaxInterval)
+        {
+                SendHello ();
+        }
+        HelloIntervalTimer.Cancel ();
+        HelloIntervalTimer.Schedule (HelloMinInterval + ADAPTIVE_JITTER);
+}
+
+Time
+RoutingProtocol::DensityHelloInterval ()
+{
+        uint32_t neighbors = m_neighbors.GetNeighborCount ();
+        Time interval = HelloInterval;
+        if (neighbors > HelloDensityThreshold)
+        {
+                interval = Seconds (HelloInterval.GetSeconds () * neighbors / HelloDensityThreshold);
+        }
+        return std::min (interval, std::max (HelloMaxInterval, HelloInterval));
+}
+
+Time
+RoutingProtocol::NextHelloSlot ()
+{
+        if (m_helloSlot == 0)
+        {
+                //Knuth multiplicative hash, so neighbours with consecutive addresses get spread slots
+                uint32_t addr = GetMainAddress ().Get ();
+                m_helloSlot = ((addr * 2654435761u) >> 16) % HelloSlots + 1;
+        }
+        double period = DensityHelloInterval ().GetSeconds ();
+        double slotLength = period / HelloSlots;
+        double now = Simulator::Now ().GetSeconds ();
+        //periods are aligned on a global grid so that nodes with the same density use disjoint slots
+        double next = std::floor (now / period) * period + (m_helloSlot - 1) * slotLength;
+        while (next < now + slotLength / 2)
+        {
+                next += period;
+        }
+        return Seconds (next - now);
+}
+
+//Hello包的发送
+void
+RoutingProtocol::SendHello ()
+{
+        NS_LOG_FUNCTION (this);
+        double positionX;
+        double positionY;
+
+        Vector mmPos = m_ipv4->GetObject<MobilityModel> ()->GetPosition ();
+
+        positionX = mmPos.x;
+        positionY = mmPos.y;
+
+        m_lastHelloPos = Vector (positionX, positionY, 0);
+        m_lastHelloTime = Simulator::Now ();
+        m_helloSent++;
+
+        for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin (); j != m_socketAddresses.end (); ++j)
+        {
+                Ptr<Socket> socket = j->first;
+                Ipv4InterfaceAddress iface = j->second;
+                //接口metric可能在运行中被修改，每次发hello时同步给邻居表
+                uint32_t interface = m_ipv4->GetInterfaceForAddress (iface.GetLocal ());
+                m_neighbors.SetInterfaceMetric (interface, m_ipv4->GetMetric (interface));
+                HelloHeader helloHeader (((uint64_t) positionX),((uint64_t) positionY), m_helloSeqNo);
+                //只有按负载绕路时才采样队列并通告，默认的hello大小不变
+                if (LoadTolerance > 0)
+                {
+                        helloHeader.SetLoad (GetQueueLoad (interface));
+                }
+
+                Ptr<Packet> packet = Create<Packet> ();
+                TypeHeader tHeader (GPSRTYPE_HELLO);
+                if (TwoHopHello)
+                {
+                        NeighborSummaryHeader summary = GetNeighborSummary (mmPos);
+                        packet->AddHeader (summary);
+                        m_twoHopBytes += summary.GetSerializedSize ();
+                        tHeader = TypeHeader (GPSRTYPE_HELLO_EXT);
+                }
+                packet->AddHeader (helloHeader);
+                packet->AddHeader (tHeader);
+                // Send to all-hosts broadcast if on /32 addr, subnet-directed otherwise
+                Ipv4Address destination;
+                if (iface.GetMask () == Ipv4Mask::GetOnes ())
+                {
+                        destination = Ipv4Address ("255.255.255.255");
+                        NS_LOG_DEBUG("Send hello to destination"<<destination );
+                }
+                else
+                {
+                        destination = iface.GetBroadcast ();
+                        NS_LOG_DEBUG("Send hello to destination"<<destination );
+                }
+                m_helloTxTrace (packet);
+                socket->SendTo (packet, 0, InetSocketAddress (destination, GPSR_PORT));
+
+        }
+        m_helloSeqNo++;
+}
+
+//同一个流（或流片）在本节点总是哈希到同一个候选，流内不会乱序；间隔超过FlowletGap后前面的包已经走完，可以换路
+uint32_t
+RoutingProtocol::GetFlowHash (Ipv4Address origin, Ipv4Address dst)
+{
+        if (MultipathCandidates < 2)
+        {
+                return 0;
+        }
+        //本节点发出的包，不管源地址是否已经填好都算同一个流
+        if (origin == Ipv4Address ("102.102.102.102") || IsMyOwnAddress (origin))
+        {
+                origin = Ipv4Address::GetAny ();
+        }
+        Flowlet &flowlet = m_flowlets[std::make_pair (origin, dst)];
+        if (FlowletGap > Seconds (0) && Simulator::Now () - flowlet.last > FlowletGap)
+        {
+                flowlet.id++;
+        }
+        flowlet.last = Simulator::Now ();
+        //salted with the node, so that consecutive hops split a flow set independently
+        uint32_t key[4] = { origin.Get (), dst.Get (), flowlet.id, m_ipv4->GetObject<Node> ()->GetId () };
+        uint32_t hash = Hash32 ((const char *) key, sizeof (key));
+        return hash ? hash : 1;
+}
+
+Ipv4Address
+RoutingProtocol::GetContentionGateway () const
+{
+        return m_ipv4->GetAddress (GetMainInterface (m_ipv4), 0).GetBroadcast ();
+}
+
+//收到广播的数据包：比发送者更接近目的的节点按前进距离设置等待时间，前进越多等得越短；
+//等待中听到别的节点转发了同一个包就放弃
+bool
+RoutingProtocol::Contend (Ptr<Packet> p, const Ipv4Header &header, Vector senderPos, Vector target,
+                          const PositionHeader &posHeader, bool udp, UnicastForwardCallback ucb)
+{
+        ContentionKey key (std::make_pair (header.GetSource (), header.GetDestination ()), header.GetIdentification ());
+        std::map<ContentionKey, Contention>::iterator i = m_contentions.find (key);
+        if (i != m_contentions.end ())
+        {
+                NS_LOG_LOGIC ("Beaconless packet " << p->GetUid () << " forwarded by another node, contention given up");
+                i->second.timer.Cancel ();
+                m_contentions.erase (i);
+                m_contentionsSuppressed++;
+                return true;
+        }
+        if (m_contentionSeen.count (key))
+        {
+                return true;
+        }
+        m_contentionSeen[key] = Simulator::Now ();
+
+        Vector myPos = m_ipv4->GetObject<MobilityModel> ()->GetPosition ();
+        double progress = CalculateDistance (senderPos, target) - CalculateDistance (myPos, target);
+        if (progress <= 0)
+        {
+                return true;
+        }
+        Contention contention;
+        contention.packet = p;
+        contention.header = header;
+        contention.ucb = ucb;
+        contention.posHeader = posHeader;
+        contention.udp = udp;
+        Time delay = Seconds (ContentionMaxDelay.GetSeconds () * (1 - std::min (progress, DefaultRange) / DefaultRange));
+        contention.timer = Simulator::Schedule (delay, &RoutingProtocol::ContentionExpire, this, key);
+        m_contentions[key] = contention;
+        NS_LOG_LOGIC ("Contend for beaconless packet " << p->GetUid () << ", progress " << progress << " m, delay " << delay.GetSeconds ());
+        return true;
+}
+
+void
+RoutingProtocol::ContentionExpire (ContentionKey key)
+{
+        std::map<ContentionKey, Contention>::iterator i = m_contentions.find (key);
+        if (i == m_contentions.end ())
+        {
+                return;
+        }
+        Contention contention = i->second;
+        m_contentions.erase (i);
+
+        //发送者位置是转发时的位置
+        Vector myPos = m_ipv4->GetObject<MobilityModel> ()->GetPosition ();
+        Ptr<Packet> p = contention.packet;
+        contention.posHeader.SetLastPosx (myPos.x);
+        contention.posHeader.SetLastPosy (myPos.y);
+        p->AddHeader (contention.posHeader);
+        p->AddHeader (TypeHeader (GPSRTYPE_CBF));
+        if (contention.udp)
+        {
+                UdpHeader udpHeader;
+                p->AddHeader (udpHeader);
+        }
+
+        Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+        route->SetDestination (contention.header.GetDestination ());
+        route->SetSource (contention.header.GetSource ());
+        route->SetGateway (GetContentionGateway ());
+        route->SetOutputDevice (m_ipv4->GetNetDevice (GetMainInterface (m_ipv4)));
+        m_contentionWins++;
+        contention.ucb (route, p, contention.header);
+}
+
+Ipv4Address
+RoutingProtocol::AddGeocastRegion (const std::vector<Vector> &polygon, GeocastMode mode)
+{
+        NS_ASSERT_MSG (polygon.size () >= 3 && polygon.size () <= 255, "A region needs 3 to 255 vertices");
+        GeocastHeader geoHeader (mode);
+        for (std::vector<Vector>::const_iterator i = polygon.begin (); i != polygon.end (); ++i)
+        {
+                NS_ASSERT_MSG (i->x >= 0 && i->y >= 0, "Region vertices cannot be negative");
+                geoHeader.AddVertex (*i);
+        }
+        Ipv4Address address (Ipv4Address ("240.0.0.0").Get () + s_geocastRegions.size () + 1);
+        s_geocastRegions[address] = geoHeader;
+        return address;
+}
+
+void
+RoutingProtocol::ClearGeocastRegions ()
+{
+        s_geocastRegions.clear ();
+}
+
+bool
+RoutingProtocol::IsGeocastAddress (Ipv4Address dst)
+{
+        return s_geocastRegions.count (dst) != 0;
+}
+
+//发往区域的包：区域外按区域中心贪婪选下一跳；区域内的地理广播直接广播；
+//任播的源节点在区域内又没有更靠近中心的邻居，就交给自己
+Ptr<Ipv4Route>
+RoutingProtocol::GeocastRouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif, Socket::SocketErrno &sockerr)
+{
+        Ipv4Address dst = header.GetDestination ();
+        const GeocastHeader &region = s_geocastRegions[dst];
+        Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
+        RouteContext ctx;
+        ctx.myPos = MM->GetPosition ();
+        ctx.myVel = MM->GetVelocity ();
+        ctx.dstPos = region.GetCentroid ();
+        ctx.dstVel = Vector (0, 0, 0);
+        ctx.dstUpdated = Simulator::Now ();
+        ctx.nextHop = Ipv4Address::GetZero ();
+        ctx.flowHash = 0;
+        bool inside = region.IsInside (ctx.myPos);
+
+        if (GeocastFlooding || (inside && region.GetMode () == GPSR_GEOCAST))
+        {
+                ctx.nextHop = GetContentionGateway ();
+        }
+        else
+        {
+                ctx.flowHash = GetFlowHash (header.GetSource (), dst);
+                SelectNextHop (dst, ctx);
+        }
+        AttachRouteContext (p, ctx);
+        if (ctx.nextHop == Ipv4Address::GetZero ())
+        {
+                //区域外没有贪婪下一跳：经回环交给RecvGeocast，由它开始绕面转发
+                if (inside)
+                {
+                        NS_LOG_LOGIC ("Anycast to " << dst << " delivered locally");
+                }
+                else
+                {
+                        NS_LOG_LOGIC ("No greedy next hop towards region " << dst << ", recovery-mode from the loopback");
+                }
+                return LoopbackRoute (header, oif);
+        }
+
+        uint32_t interface = ctx.nextHop == GetContentionGateway () ? GetMainInterface (m_ipv4) : GetOutputInterface (ctx.nextHop);
+        Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+        route->SetDestination (dst);
+        if (header.GetSource () == Ipv4Address ("102.102.102.102"))
+        {
+                route->SetSource (m_ipv4->GetAddress (interface, 0).GetLocal ());
+        }
+        else
+        {
+                route->SetSource (header.GetSource ());
+        }
+        route->SetGateway (ctx.nextHop);
+        route->SetOutputDevice (m_ipv4->GetNetDevice (interface));
+        if (oif != 0 && route->GetOutputDevice () != oif)
+        {
+                NS_LOG_DEBUG ("Output device doesn't match. Dropped.");
+                sockerr = Socket::ERROR_NOROUTETOHOST;
+                return Ptr<Ipv4Route> ();
+        }
+        return route;
+}
+
+//区域外：贪婪转发，失败时以区域中心为目的绕面转发，区域内重广播传到区域外的忽略；区域内：交付，任播到此为止，
+//地理广播按离发送者的距离等待后重广播，越远越早，等待中听到近处的节点已经广播就放弃
+bool
+RoutingProtocol::RecvGeocast (Ptr<const Packet> p, const Ipv4Header &header, int32_t iif,
+                              UnicastForwardCallback ucb, LocalDeliverCallback lcb)
+{
+        Ipv4Address origin = header.GetSource ();
+        Ipv4Address dst = header.GetDestination ();
+        //自己发出的包被邻居重广播回来；回环接口上的是交给自己的任播包
+        if (IsMyOwnAddress (origin) && iif != 0)
+        {
+                return true;
+        }
+        Ptr<Packet> packet = p->Copy ();
+        TypeHeader tHeader (GPSRTYPE_GEO);
+        packet->RemoveHeader (tHeader);
+        if (!tHeader.IsValid () || tHeader.Get () != GPSRTYPE_GEO)
+        {
+                NS_LOG_DEBUG ("Packet " << p->GetUid () << " to geocast address " << dst << " without region. Ignored");
+                return false;
+        }
+        GeocastHeader geoHeader;
+        packet->RemoveHeader (geoHeader);
+        PositionHeader perimeter;
+        if (geoHeader.IsPerimeter ())
+        {
+                packet->RemoveHeader (perimeter);
+        }
+
+        ContentionKey key (std::make_pair (origin, dst), header.GetIdentification ());
+        Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
+        Vector myPos = MM->GetPosition ();
+        Vector lastPos = geoHeader.GetLastPos ();
+        double distance = CalculateDistance (myPos, lastPos);
+        bool inside = geoHeader.IsInside (myPos);
+
+        //绕面转发的包可能两次经过同一个节点，区域外不按收到过去重；进入区域后不再绕面
+        if (!geoHeader.IsPerimeter () || inside)
+        {
+                geoHeader.SetPerimeter (false);
+                std::map<ContentionKey, GeocastPending>::iterator i = m_geocastPending.find (key);
+                if (i != m_geocastPending.end ())
+                {
+                        if (!GeocastFlooding && distance < GeocastSuppressDistance)
+                        {
+                                NS_LOG_LOGIC ("Geocast packet " << p->GetUid () << " rebroadcast " << distance << " m away, own rebroadcast given up");
+                                i->second.timer.Cancel ();
+                                m_geocastPending.erase (i);
+                                m_geocastSuppressed++;
+                        }
+                        return true;
+                }
+                if (m_contentionSeen.count (key))
+                {
+                        return true;
+                }
+                m_contentionSeen[key] = Simulator::Now ();
+        }
+
+        Time delay;
+        if (GeocastFlooding)
+        {
+                if (inside)
+                {
+                        lcb (packet->Copy (), header, iif);
+                        m_geocastDelivered++;
+                        if (geoHeader.GetMode () == GPSR_ANYCAST)
+                        {
+                                return true;
+                        }
+                }
+                delay = Seconds (x->GetValue (0, GeocastMaxDelay.GetSeconds ()));
+        }
+        else if (!inside)
+        {
+                if (geoHeader.IsInside (lastPos))
+                {
+                        return true;
+                }
+                RouteContext ctx;
+                ctx.myPos = myPos;
+                ctx.myVel = MM->GetVelocity ();
+                ctx.dstPos = geoHeader.GetCentroid ();
+                ctx.dstVel = Vector (0, 0, 0);
+                ctx.dstUpdated = Simulator::Now ();
+                ctx.nextHop = Ipv4Address::GetZero ();
+                ctx.flowHash = GetFlowHash (origin, dst);
+                //和单播一样：比进入recovery的位置更靠近区域中心时回到贪婪转发
+                if (geoHeader.IsPerimeter ()
+                    && CalculateDistance (myPos, ctx.dstPos) < CalculateDistance (Vector (perimeter.GetRecPosx (), perimeter.GetRecPosy (), 0), ctx.dstPos))
+                {
+                        m_perimeterExitTrace (dst, perimeter.GetPerimeterHops ());
+                        geoHeader.SetPerimeter (false);
+                        NS_LOG_LOGIC ("No longer in Recovery to region " << dst << " in " << myPos);
+                }
+                if (!geoHeader.IsPerimeter ())
+                {
+                        SelectNextHop (dst, ctx);
+                }
+                if (ctx.nextHop == Ipv4Address::GetZero ())
+                {
+                        //贪婪失败，以区域中心为目的绕面转发，第一条边从中心方向开始
+                        if (!geoHeader.IsPerimeter ())
+                        {
+                                perimeter = PositionHeader (ctx.dstPos.x, ctx.dstPos.y, (uint32_t) Simulator::Now ().GetMilliSeconds ());
+                                perimeter.StartPerimeter (myPos);
+                                perimeter.SetLastPosx (ctx.dstPos.x);
+                                perimeter.SetLastPosy (ctx.dstPos.y);
+                                geoHeader.SetPerimeter (true);
+                                m_perimeterEntries++;
+                                NS_LOG_LOGIC ("Entering recovery-mode to region " << dst << " in " << GetMainAddress ());
+                        }
+                        ctx.nextHop = PerimeterNextHop (dst, perimeter);
+                        if (ctx.nextHop == Ipv4Address::GetZero ())
+                        {
+                                NS_LOG_LOGIC ("No next hop towards region " << dst << " for packet " << p->GetUid () << ". Drop");
+                                m_perimeterDropTrace (dst, perimeter.GetPerimeterHops ());
+                                return false;
+                        }
+                        packet->AddHeader (perimeter);
+                }
+                geoHeader.SetLastPos (myPos);
+                packet->AddHeader (geoHeader);
+                packet->AddHeader (tHeader);
+                Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+                route->SetDestination (dst);
+                route->SetSource (origin);
+                route->SetGateway (ctx.nextHop);
+                route->SetOutputDevice (m_ipv4->GetNetDevice (GetOutputInterface (ctx.nextHop)));
+                SendTracked (ucb, route, packet, header, ctx.dstPos);
+                return true;
+        }
+        else
+        {
+                NS_LOG_LOGIC ("Region " << dst << " reached, packet " << p->GetUid () << " of " << origin << " delivered");
+                lcb (packet->Copy (), header, iif);
+                m_geocastDelivered++;
+                if (geoHeader.GetMode () == GPSR_ANYCAST)
+                {
+                        return true;
+                }
+                //从区域外进来的第一个节点马上广播
+                if (geoHeader.IsInside (lastPos))
+                {
+                        if (distance < GeocastSuppressDistance)
+                        {
+                                m_geocastSuppressed++;
+                                return true;
+                        }
+                        delay = Seconds (GeocastMaxDelay.GetSeconds () * (1 - std::min (distance, DefaultRange) / DefaultRange));
+                }
+        }
+
+        GeocastPending pending;
+        pending.packet = packet;
+        pending.header = header;
+        pending.ucb = ucb;
+        pending.geoHeader = geoHeader;
+        pending.timer = Simulator::Schedule (delay, &RoutingProtocol::GeocastExpire, this, key);
+        m_geocastPending[key] = pending;
+        return true;
+}
+
+void
+RoutingProtocol::GeocastExpire (ContentionKey key)
+{
+        std::map<ContentionKey, GeocastPending>::iterator i = m_geocastPending.find (key);
+        if (i == m_geocastPending.end ())
+        {
+                return;
+        }
+        GeocastPending pending = i->second;
+        m_geocastPending.erase (i);
+
+        Ptr<Packet> p = pending.packet;
+        pending.geoHeader.SetLastPos (m_ipv4->GetObject<MobilityModel> ()->GetPosition ());
+        p->AddHeader (pending.geoHeader);
+        p->AddHeader (TypeHeader (GPSRTYPE_GEO));
+
+        Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+        route->SetDestination (pending.header.GetDestination ());
+        route->SetSource (pending.header.GetSource ());
+        route->SetGateway (GetContentionGateway ());
+        route->SetOutputDevice (m_ipv4->GetNetDevice (GetMainInterface (m_ipv4)));
+        m_geocastRebroadcasts++;
+        pending.ucb (route, p, pending.header);
+}
+
+bool
+RoutingProtocol::TakeCustody (Ptr<Packet> p, const Ipv4Header &header, UnicastForwardCallback ucb, const PositionHeader &posHeader)
+{
+        if (CustodyBufferSize == 0)
+        {
+                return false;
+        }
+        if (m_custody.size () >= CustodyBufferSize)
+        {
+                //缓存满了丢掉最旧的包，它也最可能已经过时
+                NS_LOG_LOGIC ("Custody buffer full, carried packet to " << m_custody.front ().header.GetDestination () << " dropped");
+                m_custody.pop_front ();
+                m_custodyDrops++;
+        }
+        CustodyEntry entry;
+        entry.packet = p;
+        entry.header = header;
+        entry.ucb = ucb;
+        entry.posHeader = posHeader;
+        entry.expire = Simulator::Now () + CustodyTimeout;
+        m_custody.push_back (entry);
+        m_custodyTaken++;
+        NS_LOG_LOGIC ("Carrying packet " << p->GetUid () << " to " << header.GetDestination ());
+        return true;
+}
+
+//携带的包：有邻居更接近目的就贪婪转发，否则交给比自己更快驶向目的的邻居，都没有就继续携带
+void
+RoutingProtocol::ReleaseCustody ()
+{
+        Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
+        for (std::list<CustodyEntry>::iterator i = m_custody.begin (); i != m_custody.end (); )
+        {
+                if (i->expire <= Simulator::Now ())
+                {
+                        m_custodyDrops++;
+                        i = m_custody.erase (i);
+                        continue;
+                }
+                Ipv4Address dst = i->header.GetDestination ();
+                RouteContext ctx;
+                ctx.myPos = MM->GetPosition ();
+                ctx.myVel = MM->GetVelocity ();
+                ctx.dstPos = Vector (i->posHeader.GetDstPosx (), i->posHeader.GetDstPosy (), 0);
+                ctx.dstVel = i->posHeader.GetDstVelocity ();
+                ctx.dstUpdated = MilliSeconds (i->posHeader.GetUpdated ());
+                ctx.nextHop = Ipv4Address::GetZero ();
+                //携带期间目的可能已经走远：用位置服务或缓存里更新的位置
+                Time lsUpdated = m_locationService->GetEntryUpdateTime (dst);
+                if (lsUpdated > ctx.dstUpdated)
+                {
+                        Vector lsPos = m_locationService->GetPosition (dst);
+                        if (CalculateDistance (lsPos, m_locationService->GetInvalidPosition ()) != 0)
+                        {
+                                m_dstCache.Update (dst, lsPos, lsUpdated);
+                        }
+                }
+                m_dstCache.Lookup (dst, ctx.dstPos, ctx.dstVel, ctx.dstUpdated);
+                ctx.flowHash = GetFlowHash (i->header.GetSource (), dst);
+                SelectNextHop (dst, ctx);
+                Ipv4Address nextHop = ctx.nextHop;
+                if (nextHop != Ipv4Address::GetZero ())
+                {
+                        m_custodyForwarded++;
+                }
+                else
+                {
+                        nextHop = m_neighbors.BestCarrier (ctx.dstPos, PositionTable::ApproachSpeed (ctx.myPos, ctx.myVel, ctx.dstPos));
+                        if (nextHop == Ipv4Address::GetZero ())
+                        {
+                                ++i;
+                                continue;
+                        }
+                        m_custodyHandovers++;
+                }
+                NS_LOG_LOGIC ("Carried packet to " << dst << " handed to " << nextHop);
+
+                PositionHeader posHeader (ctx.dstPos.x, ctx.dstPos.y, (uint32_t) ctx.dstUpdated.GetMilliSeconds (), (uint64_t) 0, (uint64_t) 0, (uint8_t) 0, ctx.myPos.x, ctx.myPos.y);
+                posHeader.SetDstVelocity (ctx.dstVel);
+                posHeader.CopySource (i->posHeader);
+                Ptr<Packet> p = i->packet;
+                p->AddHeader (posHeader);
+                p->AddHeader (TypeHeader (GPSRTYPE_POS));
+
+                Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+                route->SetDestination (dst);
+                route->SetSource (i->header.GetSource ());
+                route->SetGateway (nextHop);
+                route->SetOutputDevice (m_ipv4->GetNetDevice (GetOutputInterface (nextHop)));
+                SendTracked (i->ucb, route, p, i->header, ctx.dstPos);
+                i = m_custody.erase (i);
+        }
+}
+
+//发送队列的占用率，LoadTolerance打开时每次发HELLO采样并平滑，0到255
+uint8_t
+RoutingProtocol::GetQueueLoad (uint32_t interface)
+{
+        Ptr<WifiNetDevice> wifi = m_ipv4->GetNetDevice (interface)->GetObject<WifiNetDevice> ();
+        if (wifi == 0)
+        {
+                return 0;
+        }
+        PointerValue dcaTxop;
+        wifi->GetMac ()->GetAttribute ("DcaTxop", dcaTxop);
+        Ptr<DcaTxop> dca = dcaTxop.Get<DcaTxop> ();
+        if (dca == 0 || dca->GetQueue ()->GetMaxSize () == 0)
+        {
+                return 0;
+        }
+        Ptr<WifiMacQueue> queue = dca->GetQueue ();
+        double sample = std::min (1.0, (double) queue->GetSize () / queue->GetMaxSize ());
+        double &load = m_queueLoad[interface];
+        load = 0.5 * load + 0.5 * sample;
+        return (uint8_t) (load * 255 + 0.5);
+}
+
+static bool
+CompareFirst (const std::pair<double, Vector> &a, const std::pair<double, Vector> &b)
+{
+        return a.first < b.first;
+}
+
+//离自己最远的邻居最能说明往哪个方向还能前进，超出上限时优先保留
+NeighborSummaryHeader
+RoutingProtocol::GetNeighborSummary (Vector myPos)
+{
+        std::vector<Vector> positions;
+        m_neighbors.GetNeighborPositions (positions);
+        std::vector<std::pair<double, Vector> > byDistance;
+        for (std::vector<Vector>::const_iterator i = positions.begin (); i != positions.end (); ++i)
+        {
+                byDistance.push_back (std::make_pair (-CalculateDistance (*i, myPos), *i));
+        }
+        std::sort (byDistance.begin (), byDistance.end (), CompareFirst);
+
+        NeighborSummaryHeader summary (TwoHopQuantum);
+        for (std::vector<std::pair<double, Vector> >::const_iterator i = byDistance.begin ();
+             i != byDistance.end () && summary.GetNeighborCount () < TwoHopMaxNeighbors; ++i)
+        {
+                summary.AddNeighbor (Vector (i->second.x - myPos.x, i->second.y - myPos.y, 0));
+        }
+        return summary;
+}
+
+uint32_t
+RoutingProtocol::GetNeighborCount ()
+{
+        return m_neighbors.GetNeighborCount ();
+}
+
+uint32_t
+RoutingProtocol::GetNeighborCount (uint32_t interface)
+{
+        return m_neighbors.GetNeighborCount (interface);
+}
+
+uint32_t
+RoutingProtocol::GetOutputInterface (Ipv4Address nextHop)
+{
+        uint32_t interface = m_neighbors.GetInterface (nextHop);
+        if (interface == 0)
+        {
+                //not (or no longer) a neighbour: the main interface
+                return GetMainInterface (m_ipv4);
+        }
+        return interface;
+}
+
+Ipv4Address
+RoutingProtocol::GetMainAddress () const
+{
+        return m_ipv4->GetAddress (GetMainInterface (m_ipv4), 0).GetLocal ();
+}
+
+uint32_t
+RoutingProtocol::GetBroadcastInterface (Ipv4Address dst)
+{
+        for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin (); j != m_socketAddresses.end (); ++j)
+        {
+                if (dst == j->second.GetBroadcast ())
+                {
+                        return m_ipv4->GetInterfaceForAddress (j->second.GetLocal ());
+                }
+        }
+        return 0;
+}
+
+bool
+RoutingProtocol::IsMyOwnAddress (Ipv4Address src)
+{
+        NS_LOG_FUNCTION (this << src);
+        for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j =
+                     m_socketAddresses.begin (); j != m_socketAddresses.end (); ++j)
+        {
+                Ipv4InterfaceAddress iface = j->second;
+                if (src == iface.GetLocal ())
+                {
+                        return true;
+                }
+        }
+        return false;
+}
+
+
+
+
+void
+RoutingProtocol::Start ()
+{
+        NS_LOG_FUNCTION (this);
+        m_queuedAddresses.clear ();
+
+        //FIXME ajustar timer, meter valor parametrizavel
+        Time tableTime ("2s");
+        if (AdaptiveHello)
+        {
+                //a neighbour that does not move only beacons every HelloMaxInterval
+                m_neighbors.SetEntryLifeTime (HelloMaxInterval + HelloMaxInterval);
+        }
+        m_neighbors.SetDefaultRange (DefaultRange);
+        m_neighbors.SetLoadTolerance (LoadTolerance);
+        m_neighbors.SetMultipath (MultipathCandidates, MultipathTolerance);
+
+        switch (LocationServiceName)
+        {
+        case GPSR_LS_GOD:
+                NS_LOG_DEBUG ("GodLS in use");
+                m_locationService = CreateObject<GodLocationService> ();
+                break;
+        case GPSR_LS_RLS:
+        {
+                NS_LOG_DEBUG ("RLS in use");
+                Ptr<RlsLocationService> rls = CreateObject<RlsLocationService> ();
+                //aggregated so that its trace sources are reachable from the node
+                m_ipv4->GetObject<Node> ()->AggregateObject (rls);
+                rls->Start (m_ipv4);
+                rls->SetSearchDoneCallback (MakeCallback (&RoutingProtocol::SearchDone, this));
+                m_locationService = rls;
+                break;
+        }
+        case GPSR_LS_GLS:
+        {
+                NS_LOG_DEBUG ("GLS in use");
+                Ptr<GlsLocationService> gls = CreateObject<GlsLocationService> ();
+                m_ipv4->GetObject<Node> ()->AggregateObject (gls);
+                gls->Start (GetMainAddress (), m_ipv4->GetObject<MobilityModel> ());
+                m_locationService = gls;
+                break;
+        }
+        case GPSR_LS_ORACLE:
+                NS_LOG_DEBUG ("Indexed oracle LS in use");
+                m_locationService = CreateObject<OracleLocationService> ();
+                break;
+        case GPSR_LS_HOME:
+        {
+                NS_LOG_DEBUG ("Home region LS in use");
+                Ptr<HomeRegionLocationService> home = CreateObject<HomeRegionLocationService> ();
+                m_ipv4->GetObject<Node> ()->AggregateObject (home);
+                home->Start (m_ipv4);
+                home->SetSearchDoneCallback (MakeCallback (&RoutingProtocol::SearchDone, this));
+                m_homeRegion = home;
+                m_locationService = home;
+                break;
+        }
+        }
+
+}
+
+
+RouteContext
+RoutingProtocol::ComputeRouteContext (Ipv4Address dst)
+{
+        RouteContext ctx;
+        Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
+        ctx.myPos = MM->GetPosition ();
+        ctx.myVel = MM->GetVelocity ();
+        ctx.dstPos = Vector (0, 0, 0);
+        ctx.dstVel = Vector (0, 0, 0);
+        ctx.dstUpdated = Seconds (0);
+        ctx.nextHop = Ipv4Address::GetZero ();
+        ctx.flowHash = 0;
+        if (GetBroadcastInterface (dst) == 0)
+        {
+                //足够新的缓存位置（目的节点捎带的或者hello）直接使用，不再查询位置服务
+                Time cached;
+                if (PiggybackMaxAge > Seconds (0) && m_dstCache.Lookup (dst, ctx.dstPos, ctx.dstVel, cached)
+                    && Simulator::Now () - cached < PiggybackMaxAge)
+                {
+                        ctx.dstUpdated = cached;
+                        m_queriesAvoided++;
+                        return ctx;
+                }
+                ctx.dstPos = m_locationService->GetPosition (dst);
+                ctx.dstUpdated = m_locationService->GetEntryUpdateTime (dst);
+                if (CalculateDistance (ctx.dstPos, m_locationService->GetInvalidPosition ()) != 0)
+                {
+                        m_dstCache.Update (dst, ctx.dstPos, ctx.dstUpdated);
+                }
+                //缓存里可能有比位置服务更新的位置（来自hello或者转发过的包）
+                Time updated;
+                if (m_dstCache.Lookup (dst, ctx.dstPos, ctx.dstVel, updated))
+                {
+                        ctx.dstUpdated = updated;
+                }
+        }
+        return ctx;
+}
+
+void
+RoutingProtocol::StampSource (PositionHeader &posHeader, const RouteContext &ctx)
+{
+        //没有打开捎带时不加源位置，位置头保持原来的大小
+        if (PiggybackMaxAge > Seconds (0))
+        {
+                posHeader.SetSource (ctx.myPos, ctx.myVel, (uint32_t) Simulator::Now ().GetMilliSeconds ());
+        }
+}
+
+void
+RoutingProtocol::LearnSource (Ipv4Address origin, const PositionHeader &posHeader)
+{
+        if (posHeader.GetSrcUpdated () == 0 || IsMyOwnAddress (origin))
+        {
+                return;
+        }
+        m_dstCache.Update (origin, posHeader.GetSrcPosition (), posHeader.GetSrcVelocity (), MilliSeconds (posHeader.GetSrcUpdated ()));
+        m_piggybackedFixes++;
+}
+
+void
+RoutingProtocol::AttachRouteContext (Ptr<Packet> p, const RouteContext &ctx)
+{
+        RouteContextTag ctxTag (ctx);
+        if (!p->ReplacePacketTag (ctxTag))
+        {
+                p->AddPacketTag (ctxTag);
+        }
+}
+
+void
+RoutingProtocol::SelectNextHop (Ipv4Address dst, RouteContext &ctx)
+{
+        if (m_neighbors.isNeighbour (dst))
+        {
+                ctx.nextHop = dst;
+        }
+        else
+        {
+                //按速度把目的位置外推到当前时刻再做贪婪选择
+                Vector target = ctx.dstPos;
+                if (MaxExtrapolation > Seconds (0))
+                {
+                        target = DestinationCache::Extrapolate (ctx.dstPos, ctx.dstVel, ctx.dstUpdated, MaxExtrapolation);
+                }
+                ctx.nextHop = GreedyNextHop (target, ctx);
+                if (!m_evicted.empty ())
+                {
+                        CountRetrySaved (target, ctx);
+                }
+        }
+}
+
+Ipv4Address
+RoutingProtocol::GreedyNextHop (Vector target, const RouteContext &ctx)
+{
+        if (GreedyFailureCell <= 0)
+        {
+                return ScanNeighbors (target, ctx);
+        }
+
+        //同一区域的目的最近贪婪失败过：所有邻居都比本节点离那个目的至少远margin。
+        //新目的偏了d，邻居累计移动了drift，本节点移动了e，只要2d+drift+e不超过margin，
+        //仍然没有邻居比本节点更近，不用再扫一遍邻居表，直接进入周边转发
+        Cell cell = GetGreedyCell (target);
+        std::map<Cell, GreedyFailure>::iterator i = m_greedyFailures.find (cell);
+        if (i != m_greedyFailures.end ())
+        {
+                if (i->second.version != m_neighbors.GetVersion () || i->second.expire <= Simulator::Now ())
+                {
+                        m_greedyFailures.erase (i);
+                }
+                else if (2 * CalculateDistance (i->second.target, target) + m_neighbors.GetDrift () - i->second.drift
+                         + CalculateDistance (i->second.myPos, ctx.myPos) <= i->second.margin)
+                {
+                        m_greedyScansSaved++;
+                        m_neighborsNotScanned += m_neighbors.GetNeighborCount ();
+                        return Ipv4Address::GetZero ();
+                }
+        }
+        m_greedyScans++;
+        Ipv4Address nextHop = ScanNeighbors (target, ctx);
+        if (nextHop == Ipv4Address::GetZero ())
+        {
+                GreedyFailure failure;
+                failure.version = m_neighbors.GetVersion ();
+                failure.drift = m_neighbors.GetDrift ();
+                failure.target = target;
+                failure.margin = m_neighbors.GetProgressMargin (target, ctx.myPos);
+                failure.myPos = ctx.myPos;
+                failure.expire = Simulator::Now () + GreedyFailureLifetime;
+                m_greedyFailures[cell] = failure;
+        }
+        return nextHop;
+}
+
+//被MAC反馈删掉的邻居如果还留在表里，会比这次选出的下一跳更靠近目的，这个包就会在它身上耗完一轮重传
+void
+RoutingProtocol::CountRetrySaved (Vector target, const RouteContext &ctx)
+{
+        double best = CalculateDistance (ctx.myPos, target);
+        if (ctx.nextHop != Ipv4Address::GetZero ())
+        {
+                best = std::min (best, CalculateDistance (m_neighbors.GetPosition (ctx.nextHop), target));
+        }
+        for (std::map<Ipv4Address, EvictedNeighbor>::iterator i = m_evicted.begin (); i != m_evicted.end (); )
+        {
+                if (i->second.expire <= Simulator::Now () || m_neighbors.isNeighbour (i->first))
+                {
+                        m_evicted.erase (i++);
+                        continue;
+                }
+                if (CalculateDistance (i->second.position, target) < best)
+                {
+                        m_retryAirtimeSaved += m_retryCycle;
+                        return;
+                }
+                ++i;
+        }
+}
+
+void
+RoutingProtocol::SendTracked (UnicastForwardCallback ucb, Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Header &header, Vector dstPos)
+{
+        //按UID记下包，MAC报告成功或失败时按帧的序号找到它；超过邻居表寿命还没有报告的就不再等
+        while (!m_inFlightOrder.empty ())
+        {
+                std::map<uint64_t, InFlight>::iterator i = m_inFlight.find (m_inFlightOrder.front ());
+                if (i != m_inFlight.end ())
+                {
+                        if (m_inFlight.size () < GPSR_MAX_INFLIGHT && i->second.sent + m_neighbors.GetEntryLifeTime () > Simulator::Now ())
+                        {
+                                break;
+                        }
+                        EraseInFlight (i);
+                }
+                m_inFlightOrder.pop_front ();
+        }
+        std::map<uint64_t, InFlight>::iterator old = m_inFlight.find (p->GetUid ());
+        if (old != m_inFlight.end ())
+        {
+                EraseInFlight (old);
+        }
+        InFlight f;
+        f.packet = p->Copy ();
+        f.header = header;
+        f.ucb = ucb;
+        f.dstPos = dstPos;
+        f.sent = Simulator::Now ();
+        f.nextHop = route->GetGateway ();
+        f.transmitted = false;
+        f.seq = 0;
+        m_inFlight[p->GetUid ()] = f;
+        m_inFlightOrder.push_back (p->GetUid ());
+        ucb (route, p, header);
+}
+
+//MAC的报告只带MAC包头：帧第一次发送时按包的UID记下MAC给它的序号
+void
+RoutingProtocol::ProcessPhyTxBegin (Ptr<const Packet> packet)
+{
+        if (m_inFlight.empty ())
+        {
+                return;
+        }
+        WifiMacHeader hdr;
+        if (packet->PeekHeader (hdr) == 0 || !hdr.IsData () || hdr.GetAddr1 ().IsGroup ())
+        {
+                return;
+        }
+        std::map<uint64_t, InFlight>::iterator f = m_inFlight.find (packet->GetUid ());
+        if (f == m_inFlight.end () || f->second.transmitted)
+        {
+                //重传的帧序号不变
+                return;
+        }
+        f->second.transmitted = true;
+        f->second.mac = hdr.GetAddr1 ();
+        f->second.seq = hdr.GetSequenceNumber ();
+        f->second.firstTx = Simulator::Now ();
+        m_inFlightFrames[FrameKey (f->second.mac, f->second.seq)] = f->first;
+}
+
+bool
+RoutingProtocol::TakeInFlight (WifiMacHeader const &hdr, InFlight &f)
+{
+        std::map<FrameKey, uint64_t>::iterator frame = m_inFlightFrames.find (FrameKey (hdr.GetAddr1 (), hdr.GetSequenceNumber ()));
+        if (frame == m_inFlightFrames.end ())
+        {
+                return false;
+        }
+        std::map<uint64_t, InFlight>::iterator i = m_inFlight.find (frame->second);
+        if (i == m_inFlight.end ())
+        {
+                m_inFlightFrames.erase (frame);
+                return false;
+        }
+        f = i->second;
+        EraseInFlight (i);
+        return true;
+}
+
+void
+RoutingProtocol::EraseInFlight (std::map<uint64_t, InFlight>::iterator i)
+{
+        if (i->second.transmitted)
+        {
+                std::map<FrameKey, uint64_t>::iterator frame = m_inFlightFrames.find (FrameKey (i->second.mac, i->second.seq));
+                if (frame != m_inFlightFrames.end () && frame->second == i->first)
+                {
+                        m_inFlightFrames.erase (frame);
+                }
+        }
+        m_inFlight.erase (i);
+}
+
+void
+RoutingProtocol::ProcessTxOk (WifiMacHeader const &hdr)
+{
+        if (!hdr.IsData () || hdr.GetAddr1 ().IsGroup ())
+        {
+                return;
+        }
+        //这一帧用了几次发送，平滑后作为这个邻居的重传率
+        LinkStats &stats = FindLinkStats (hdr.GetAddr1 ());
+        stats.etx = 0.8 * stats.etx + 0.2 * (1 + stats.failures);
+        stats.failures = 0;
+        InFlight f;
+        TakeInFlight (hdr, f);
+}
+
+//MAC放弃了这一帧（位置表已经删掉了这个邻居）：只有这个包改走下一个最好的邻居，
+//还在MAC队列里的包由它们自己的报告处理
+void
+RoutingProtocol::ProcessTxError (WifiMacHeader const &hdr)
+{
+        if (!hdr.IsData () || hdr.GetAddr1 ().IsGroup ())
+        {
+                return;
+        }
+        InFlight f;
+        if (!TakeInFlight (hdr, f))
+        {
+                return;
+        }
+        //从第一次发送到MAC放弃的时间就是这一轮重传实际占用的时间
+        Time cycle = Simulator::Now () - f.firstTx;
+        m_retryCycle = m_retryCycle.IsZero () ? cycle : Seconds (0.8 * m_retryCycle.GetSeconds () + 0.2 * cycle.GetSeconds ());
+        if (f.sent + m_neighbors.GetEntryLifeTime () <= Simulator::Now ())
+        {
+                return;
+        }
+        Ipv4Address dst = f.header.GetDestination ();
+        Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
+        RouteContext ctx;
+        ctx.myPos = MM->GetPosition ();
+        ctx.myVel = MM->GetVelocity ();
+        ctx.dstPos = f.dstPos;
+        ctx.dstVel = Vector (0, 0, 0);
+        ctx.dstUpdated = Simulator::Now ();
+        ctx.flowHash = GetFlowHash (f.header.GetSource (), dst);
+        SelectNextHop (dst, ctx);
+        if (ctx.nextHop == Ipv4Address::GetZero () || ctx.nextHop == f.nextHop)
+        {
+                NS_LOG_LOGIC ("No failover for packet " << f.packet->GetUid () << " to " << dst << " after " << f.nextHop << " failed");
+                return;
+        }
+
+        //包头是为旧的下一跳建的：压缩的包头新的下一跳没有上下文，要重建
+        Ptr<Packet> p = f.packet->Copy ();
+        if (!RebuildHeaders (p, f.header.GetSource (), f.nextHop, ctx.nextHop, ctx.myPos))
+        {
+                NS_LOG_LOGIC ("Cannot rebuild the headers of packet " << f.packet->GetUid () << " to " << dst);
+                return;
+        }
+
+        Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+        route->SetDestination (dst);
+        route->SetSource (f.header.GetSource ());
+        route->SetGateway (ctx.nextHop);
+        route->SetOutputDevice (m_ipv4->GetNetDevice (GetOutputInterface (ctx.nextHop)));
+        NS_LOG_LOGIC ("Packet " << f.packet->GetUid () << " to " << dst << " moved from " << f.nextHop << " to " << ctx.nextHop);
+        m_failovers++;
+        m_failoverTrace (f.nextHop, ctx.nextHop);
+        SendTracked (f.ucb, route, p, f.header, f.dstPos);
+}
+
+bool
+RoutingProtocol::RebuildHeaders (Ptr<Packet> p, Ipv4Address origin, Ipv4Address oldHop, Ipv4Address nextHop, Vector myPos)
+{
+        //转发的包在GPSR包头前面还有一个UDP包头
+        bool udp = false;
+        TypeHeader tHeader (GPSRTYPE_POS);
+        p->PeekHeader (tHeader);
+        if (!tHeader.IsValid ())
+        {
+                UdpHeader udpHeader;
+                p->RemoveHeader (udpHeader);
+                p->PeekHeader (tHeader);
+                udp = true;
+        }
+        if (!tHeader.IsValid ())
+        {
+                return false;
+        }
+
+        //geocast包头和下一跳无关
+        if (tHeader.Get () != GPSRTYPE_GEO)
+        {
+                p->RemoveHeader (tHeader);
+                PositionHeader hdr;
+                FlowHeader flowHeader;
+                bool hasFlow = false;
+                switch (tHeader.Get ())
                 {
-                        NS_LOG_LOGIC ("No gpsr interfaces");
-                        m_neighbors.Clear ();
-                        m_locationService->Clear ();
-                        return;
+                case GPSRTYPE_POS:
+                        p->RemoveHeader (hdr);
+                        break;
+                case GPSRTYPE_POS_CTX:
+                        p->RemoveHeader (hdr);
+                        p->RemoveHeader (flowHeader);
+                        hasFlow = true;
+                        break;
+                case GPSRTYPE_CPOS:
+                        {
+                                //目的位置取自装在旧下一跳的上下文
+                                p->RemoveHeader (flowHeader);
+                                std::pair<Ipv4Address, FlowKey> key (oldHop, FlowKey (origin, flowHeader.GetFlowId ()));
+                                std::map<std::pair<Ipv4Address, FlowKey>, FlowContext>::const_iterator i = m_flowContextsSent.find (key);
+                                if (i == m_flowContextsSent.end () || i->second.version != flowHeader.GetVersion ())
+                                {
+                                        return false;
+                                }
+                                hdr = PositionHeader ((uint64_t) i->second.dstPos.x, (uint64_t) i->second.dstPos.y, i->second.updated,
+                                                      (uint64_t) 0, (uint64_t) 0, (uint8_t) 0, (uint64_t) myPos.x, (uint64_t) myPos.y);
+                                hdr.SetDstVelocity (i->second.dstVel);
+                                hasFlow = true;
+                                break;
+                        }
+                default:
+                        return false;
                 }
+                AddPositionHeaders (p, origin, nextHop, hdr, hasFlow, flowHeader);
         }
-        else
+
+        if (udp)
         {
-                NS_LOG_LOGIC ("Remove address not participating in GPSR operation");
+                UdpHeader udpHeader;
+                p->AddHeader (udpHeader);
         }
+        return true;
 }
 
-void
-RoutingProtocol::SetIpv4 (Ptr<Ipv4> ipv4)
+RoutingProtocol::LinkStats &
+RoutingProtocol::FindLinkStats (Mac48Address address)
 {
-        NS_ASSERT (ipv4 != 0);
-        NS_ASSERT (m_ipv4 == 0);
-
-        m_ipv4 = ipv4;
-
-        //当HelloIntercalTimer到时间了 就在FIRST_JITTER时间后调用HelloTimerExpire
-        HelloIntervalTimer.SetFunction (&RoutingProtocol::HelloTimerExpire, this);
-        HelloIntervalTimer.Schedule (FIRST_JITTER);
-
-        //Schedule only when it has packets on queue
-        CheckQueueTimer.SetFunction (&RoutingProtocol::CheckQueue, this);
-
-        Simulator::ScheduleNow (&RoutingProtocol::Start, this);
+        std::map<Mac48Address, LinkStats>::iterator stats = m_linkStats.find (address);
+        if (stats == m_linkStats.end ())
+        {
+                LinkStats fresh;
+                fresh.etx = 1;
+                fresh.failures = 0;
+                fresh.rate = 0;
+                stats = m_linkStats.insert (std::make_pair (address, fresh)).first;
+        }
+        return stats->second;
 }
 
 void
-RoutingProtocol::HelloTimerExpire ()
+RoutingProtocol::ProcessTxDataFailed (Mac48Address address)
 {
-        SendHello ();
-        HelloIntervalTimer.Cancel ();
-        //新建一个时间延时为HelloInterval + JITTER的Timer
-        HelloIntervalTimer.Schedule (HelloInterval + JITTER);
+        FindLinkStats (address).failures++;
 }
 
-//Hello包的发送
+//速率控制（Minstrel等）每发一帧才选一次速率：记下实际用的，不去问station manager，免得打乱它的统计
 void
-RoutingProtocol::SendHello ()
+RoutingProtocol::MonitorSnifferTx (Ptr<const Packet> packet, uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+                                   WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu)
 {
-        NS_LOG_FUNCTION (this);
-        double positionX;
-        double positionY;
-
-        Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
-
-        positionX = MM->GetPosition ().x;
-        positionY = MM->GetPosition ().y;
-
-        for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin (); j != m_socketAddresses.end (); ++j)
+        WifiMacHeader hdr;
+        if (packet->PeekHeader (hdr) == 0 || !hdr.IsData () || hdr.GetAddr1 ().IsGroup ())
         {
-                Ptr<Socket> socket = j->first;
-                Ipv4InterfaceAddress iface = j->second;
-                HelloHeader helloHeader (((uint64_t) positionX),((uint64_t) positionY));
-
-                Ptr<Packet> packet = Create<Packet> ();
-                packet->AddHeader (helloHeader);
-                TypeHeader tHeader (GPSRTYPE_HELLO);
-                packet->AddHeader (tHeader);
-                // Send to all-hosts broadcast if on /32 addr, subnet-directed otherwise
-                Ipv4Address destination;
-                if (iface.GetMask () == Ipv4Mask::GetOnes ())
-                {
-                        destination = Ipv4Address ("255.255.255.255");
-                        NS_LOG_DEBUG("Send hello to destination"<<destination );
-                }
-                else
-                {
-                        destination = iface.GetBroadcast ();
-                        NS_LOG_DEBUG("Send hello to destination"<<destination );
-                }
-                socket->SendTo (packet, 0, InetSocketAddress (destination, GPSR_PORT));
+                return;
+        }
+        FindLinkStats (hdr.GetAddr1 ()).rate = txVector.GetMode ().GetDataRate (txVector.GetChannelWidth (), txVector.IsShortGuardInterval (), txVector.GetNss ());
+}
 
+Ipv4Address
+RoutingProtocol::ScanNeighbors (Vector target, const RouteContext &ctx)
+{
+        //每次决策只在这里分支一次，邻居循环按策略在编译期展开
+        switch (AirtimeMetric ? (uint8_t) GPSR_STRATEGY_AIRTIME : ForwardingStrategy)
+        {
+        case GPSR_STRATEGY_GREEDY:
+                return m_neighbors.SelectNeighbor<GreedyStrategy> (target, ctx.myPos, ctx.myVel, ctx.flowHash);
+        case GPSR_STRATEGY_MFR:
+                return m_neighbors.SelectNeighbor<MfrStrategy> (target, ctx.myPos, ctx.myVel, ctx.flowHash);
+        case GPSR_STRATEGY_NFP:
+                return m_neighbors.SelectNeighbor<NfpStrategy> (target, ctx.myPos, ctx.myVel, ctx.flowHash);
+        case GPSR_STRATEGY_COMPASS:
+                return m_neighbors.SelectNeighbor<CompassStrategy> (target, ctx.myPos, ctx.myVel, ctx.flowHash);
+        case GPSR_STRATEGY_AIRTIME:
+                return m_neighbors.SelectNeighbor<AirtimeStrategy> (target, ctx.myPos, ctx.myVel, ctx.flowHash);
+        default:
+                return m_neighbors.SelectNeighbor<LinkDurationStrategy> (target, ctx.myPos, ctx.myVel, ctx.flowHash);
         }
 }
 
-bool
-RoutingProtocol::IsMyOwnAddress (Ipv4Address src)
+Time
+RoutingProtocol::GetAirtime (Ipv4Address neighbor, uint32_t interface)
 {
-        NS_LOG_FUNCTION (this << src);
-        for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j =
-                     m_socketAddresses.begin (); j != m_socketAddresses.end (); ++j)
+        Ptr<WifiNetDevice> wifi = m_ipv4->GetNetDevice (interface)->GetObject<WifiNetDevice> ();
+        if (wifi == 0)
         {
-                Ipv4InterfaceAddress iface = j->second;
-                if (src == iface.GetLocal ())
+                return AirtimeOverhead;
+        }
+        Mac48Address mac = m_neighbors.LookupMacAddress (neighbor);
+        //还没有发过帧的邻居按最低的默认速率算
+        uint64_t rate = wifi->GetRemoteStationManager ()->GetDefaultMode ().GetDataRate (20, false, 1);
+        double etx = 1;
+        std::map<Mac48Address, LinkStats>::const_iterator stats = m_linkStats.find (mac);
+        if (mac != Mac48Address () && stats != m_linkStats.end ())
+        {
+                if (stats->second.rate != 0)
                 {
-                        return true;
+                        rate = stats->second.rate;
                 }
+                //还在重传的帧也算进去
+                etx = std::max (stats->second.etx, (double) (1 + stats->second.failures));
         }
-        return false;
+        if (rate == 0)
+        {
+                return AirtimeOverhead;
+        }
+        return Seconds (etx * (AirtimeFrameSize * 8.0 / rate + AirtimeOverhead.GetSeconds ()));
 }
 
+//PHY收到的帧：只记下GPSR HELLO的信号强度，等RecvGPSR拿到HELLO里的位置再算
+void
+RoutingProtocol::MonitorSnifferRx (Ptr<const Packet> packet, uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+                                   WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu,
+                                   struct signalNoiseDbm signalNoise)
+{
+        Ptr<Packet> p = packet->Copy ();
+        WifiMacHeader macHeader;
+        p->RemoveHeader (macHeader);
+        if (!macHeader.IsData () || !macHeader.GetAddr1 ().IsBroadcast ())
+        {
+                return;
+        }
+        LlcSnapHeader llc;
+        p->RemoveHeader (llc);
+        if (llc.GetType () != Ipv4L3Protocol::PROT_NUMBER)
+        {
+                return;
+        }
+        Ipv4Header ipHeader;
+        p->RemoveHeader (ipHeader);
+        if (ipHeader.GetProtocol () != UdpL4Protocol::PROT_NUMBER)
+        {
+                return;
+        }
+        //广播的hello前面还有AddHeaders加的位置头
+        TypeHeader outer;
+        p->RemoveHeader (outer);
+        if (!outer.IsValid () || outer.Get () != GPSRTYPE_POS)
+        {
+                return;
+        }
+        PositionHeader posHeader;
+        p->RemoveHeader (posHeader);
+        UdpHeader udpHeader;
+        p->RemoveHeader (udpHeader);
+        if (udpHeader.GetDestinationPort () != GPSR_PORT)
+        {
+                return;
+        }
+        TypeHeader tHeader;
+        p->RemoveHeader (tHeader);
+        if (!tHeader.IsValid () || (tHeader.Get () != GPSRTYPE_HELLO && tHeader.Get () != GPSRTYPE_HELLO_EXT))
+        {
+                return;
+        }
+        m_helloSignal[ipHeader.GetSource ()] = signalNoise.signal;
+}
 
+double
+RoutingProtocol::GetPathLossExponent () const
+{
+        double variance = m_fitXX - m_fitX * m_fitX;
+        if (m_fitSamples < 10 || variance < 0.01)
+        {
+                return 3;
+        }
+        //signal = P - 10 n log10 (d)
+        double exponent = -(m_fitXY - m_fitX * m_fitY) / variance / 10;
+        return std::min (std::max (exponent, 2.0), 6.0);
+}
 
-
+//射程 = 信号衰减到接收门限的距离；HELLO丢得越多，越往当前距离收缩（链路快断了）
 void
-RoutingProtocol::Start ()
+RoutingProtocol::UpdateRange (Ipv4Address sender, Vector position, uint16_t seqNo)
 {
-        NS_LOG_FUNCTION (this);
-        m_queuedAddresses.clear ();
-
-        //FIXME ajustar timer, meter valor parametrizavel
-        Time tableTime ("2s");
+        std::map<Ipv4Address, RangeEstimate>::iterator e = m_ranges.find (sender);
+        if (e == m_ranges.end ())
+        {
+                RangeEstimate fresh;
+                fresh.power = 0;
+                fresh.delivery = 1;
+                fresh.lastSeqNo = seqNo;
+                fresh.hellos = 0;
+                e = m_ranges.insert (std::make_pair (sender, fresh)).first;
+        }
+        else
+        {
+                uint16_t gap = seqNo - e->second.lastSeqNo;
+                if (gap == 0)
+                {
+                        //the same HELLO heard on another interface
+                        return;
+                }
+                e->second.delivery = 0.8 * e->second.delivery + 0.2 / gap;
+                e->second.lastSeqNo = seqNo;
+        }
 
-        switch (LocationServiceName)
+        std::map<Ipv4Address, double>::iterator signal = m_helloSignal.find (sender);
+        if (signal == m_helloSignal.end ())
         {
-        case GPSR_LS_GOD:
-                NS_LOG_DEBUG ("GodLS in use");
-                m_locationService = CreateObject<GodLocationService> ();
-                break;
-        case GPSR_LS_RLS:
-                NS_LOG_UNCOND ("RLS not yet implemented");
-                break;
+                //not heard through a wifi PHY
+                return;
+        }
+        double rss = signal->second;
+        m_helloSignal.erase (signal);
+        double distance = CalculateDistance (m_ipv4->GetObject<MobilityModel> ()->GetPosition (), position);
+        if (distance < 1)
+        {
+                return;
         }
 
+        double x = std::log10 (distance);
+        double w = m_fitSamples < 20 ? 1.0 / (m_fitSamples + 1) : 0.05;
+        m_fitX = (1 - w) * m_fitX + w * x;
+        m_fitY = (1 - w) * m_fitY + w * rss;
+        m_fitXX = (1 - w) * m_fitXX + w * x * x;
+        m_fitXY = (1 - w) * m_fitXY + w * x * rss;
+        m_fitSamples++;
+
+        double exponent = GetPathLossExponent ();
+        double power = rss + 10 * exponent * x;
+        e->second.power = e->second.hellos ? 0.8 * e->second.power + 0.2 * power : power;
+        e->second.hellos++;
+
+        double range = std::max (std::pow (10, (e->second.power - RangeThreshold) / (10 * exponent)), distance);
+        range = distance + (range - distance) * e->second.delivery;
+        m_neighbors.SetRange (sender, range);
+        m_rangeTrace (sender, range);
+}
+
+//邻居因为发送失败被删掉：记下来，之后的重传统计要用；发给它的包在ProcessTxError里改走别的邻居
+void
+RoutingProtocol::LinkFailure (Ipv4Address neighbor, Vector position, Time expire)
+{
+        EvictedNeighbor evicted;
+        evicted.position = position;
+        evicted.expire = expire;
+        m_evicted[neighbor] = evicted;
 }
 
+RoutingProtocol::Cell
+RoutingProtocol::GetGreedyCell (Vector position) const
+{
+        return Cell ((int32_t) std::floor (position.x / GreedyFailureCell), (int32_t) std::floor (position.y / GreedyFailureCell));
+}
 
 //返回开始的节点
 Ptr<Ipv4Route>
@@ -1048,39 +3089,45 @@ RoutingProtocol::AddHeaders (Ptr<Packet> p, Ipv4Address source, Ipv4Address dest
 
         NS_LOG_FUNCTION (this << " source " << source << " destination " << destination);
         NS_LOG_DEBUG ("Call Add Headers function");
-        Vector myPos;
-        Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
-        myPos.x = MM->GetPosition ().x;
-        myPos.y = MM->GetPosition ().y;
-        Vector myVec;
-        myVec=MM->GetVelocity();
-        //这里没有recoverymode？因为后面forward的函数使用了，这里的nexthop只是一个初始化而已
-        Ipv4Address nextHop;
 
-        if(m_neighbors.isNeighbour (destination))
+        //RouteOutput已经算好的路由信息直接使用，只有没经过RouteOutput的包（如hello）才重新查询
+        RouteContext ctx;
+        RouteContextTag ctxTag;
+        if (p->RemovePacketTag (ctxTag))
         {
-                nextHop = destination;
+                ctx = ctxTag.m_ctx;
         }
         else
         {
-                nextHop = m_neighbors.BestNeighbor (m_locationService->GetPosition (destination), myPos,myVec);
+                ctx = ComputeRouteContext (destination);
         }
 
-        uint16_t positionX = 0;
-        uint16_t positionY = 0;
-        uint32_t hdrTime = 0;
-
-        if(destination != m_ipv4->GetAddress (1, 0).GetBroadcast ())
+        if (IsGeocastAddress (destination))
         {
-                positionX = m_locationService->GetPosition (destination).x;
-                positionY = m_locationService->GetPosition (destination).y;
-                hdrTime = (uint32_t) m_locationService->GetEntryUpdateTime (destination).GetSeconds ();
+                GeocastHeader geoHeader = s_geocastRegions[destination];
+                geoHeader.SetLastPos (ctx.myPos);
+                p->AddHeader (geoHeader);
+                p->AddHeader (TypeHeader (GPSRTYPE_GEO));
+                m_downTarget (p, source, destination, protocol, route);
+                return;
         }
 
-        PositionHeader posHeader (positionX, positionY,  hdrTime, (uint64_t) 0,(uint64_t) 0, (uint8_t) 0, myPos.x, myPos.y);
-        p->AddHeader (posHeader);
-        TypeHeader tHeader (GPSRTYPE_POS);
-        p->AddHeader (tHeader);
+        uint32_t hdrTime = (uint32_t) ctx.dstUpdated.GetMilliSeconds ();
+
+        PositionHeader posHeader (ctx.dstPos.x, ctx.dstPos.y,  hdrTime, (uint64_t) 0,(uint64_t) 0, (uint8_t) 0, ctx.myPos.x, ctx.myPos.y);
+        posHeader.SetDstVelocity (ctx.dstVel);
+        StampSource (posHeader, ctx);
+        if (Beaconless && GetBroadcastInterface (destination) == 0)
+        {
+                p->AddHeader (posHeader);
+                p->AddHeader (TypeHeader (GPSRTYPE_CBF));
+                m_downTarget (p, source, destination, protocol, route);
+                return;
+        }
+        //只有单播的数据流才压缩包头
+        uint16_t flowId = 0;
+        bool hasFlow = HeaderCompression && GetBroadcastInterface (destination) == 0 && GetFlowId (destination, flowId);
+        AddPositionHeaders (p, source, ctx.nextHop, posHeader, hasFlow, FlowHeader (flowId));
 
         m_downTarget (p, source, destination, protocol, route);
 
@@ -1089,7 +3136,7 @@ RoutingProtocol::AddHeaders (Ptr<Packet> p, Ipv4Address source, Ipv4Address dest
 //fowading 是中间点传输
 bool
 RoutingProtocol::Forwarding (Ptr<const Packet> packet, const Ipv4Header & header,
-                             UnicastForwardCallback ucb, ErrorCallback ecb)
+                             UnicastForwardCallback ucb, ErrorCallback ecb, bool udp)
 {
         Ptr<Packet> p = packet->Copy ();
         NS_LOG_FUNCTION (this);
@@ -1120,28 +3167,51 @@ RoutingProtocol::Forwarding (Ptr<const Packet> packet, const Ipv4Header & header
                 NS_LOG_DEBUG ("Forwarding meet packet drop because tHeader Deserialize failed "<<tHeader.IsValid ());
                 return false; // drop
         }
-        if (tHeader.Get () == GPSRTYPE_POS)
+        FlowHeader flowHeader;
+        bool hasFlow = false;
+        bool contention = tHeader.Get () == GPSRTYPE_CBF;
+        if (tHeader.Get () == GPSRTYPE_POS || tHeader.Get () == GPSRTYPE_POS_CTX || contention)
         {
 
                 p->RemoveHeader (hdr);
-                Position.x = hdr.GetDstPosx ();
-                Position.y = hdr.GetDstPosy ();
-                updated = hdr.GetUpdated ();
-                RecPosition.x = hdr.GetRecPosx ();
-                RecPosition.y = hdr.GetRecPosy ();
-                inRec = hdr.GetInRec ();
+                LearnSource (origin, hdr);
+                if (tHeader.Get () == GPSRTYPE_POS_CTX)
+                {
+                        p->RemoveHeader (flowHeader);
+                        InstallFlowContext (origin, flowHeader, hdr);
+                        hasFlow = true;
+                }
         }
-
-        Vector myPos;
+        else if (tHeader.Get () == GPSRTYPE_CPOS)
+        {
+                p->RemoveHeader (flowHeader);
+                if (!RestoreFlowContext (origin, flowHeader, hdr))
+                {
+                        NS_LOG_DEBUG ("No context for flow " << flowHeader.GetFlowId () << " of " << origin << " Drop");
+                        return false;
+                }
+                hasFlow = true;
+        }
+        Position.x = hdr.GetDstPosx ();
+        Position.y = hdr.GetDstPosy ();
+        updated = hdr.GetUpdated ();
+        RecPosition.x = hdr.GetRecPosx ();
+        RecPosition.y = hdr.GetRecPosy ();
+        inRec = hdr.GetInRec ();
+        //之后重新加的包头都是完整的position包头，压缩与否由AddPositionHeaders决定
+        tHeader = TypeHeader (GPSRTYPE_POS);
+
+        //目的节点位置以包头为准，只有位置服务的信息更新时才查询一次位置
+        RouteContext ctx;
         Ptr<MobilityModel> MM = m_ipv4->GetObject<MobilityModel> ();
-        myPos.x = MM->GetPosition ().x;
-        myPos.y = MM->GetPosition ().y;
-        Vector myVec;
-        myVec=MM->GetVelocity();
+        ctx.myPos = MM->GetPosition ();
+        ctx.myVel = MM->GetVelocity ();
+        Vector myPos = ctx.myPos;
 
 
         //如果找到的节点比之前开始的位置节点到终点的距离近，就跳出recovery mode
         if(inRec == 1 && CalculateDistance (myPos, Position) < CalculateDistance (RecPosition, Position)) {
+                m_perimeterExitTrace (dst, hdr.GetPerimeterHops ());
                 inRec = 0;
                 hdr.SetInRec(0);
                 NS_LOG_LOGIC ("No longer in Recovery to " << dst << " in " << myPos);
@@ -1156,37 +3226,60 @@ RoutingProtocol::Forwarding (Ptr<const Packet> packet, const Ipv4Header & header
         }
 
 
-        //更新目的节点的位置信息
-        uint32_t myUpdated = (uint32_t) m_locationService->GetEntryUpdateTime (dst).GetSeconds ();
-        if (myUpdated > updated) //check if node has an update to the position of destination
+        //更新目的节点的位置信息：包头、位置服务和缓存里最新的一个
+        m_dstCache.Update (dst, Position, hdr.GetDstVelocity (), MilliSeconds (updated));
+        Time lsUpdated = m_locationService->GetEntryUpdateTime (dst);
+        if ((uint32_t) lsUpdated.GetMilliSeconds () > updated) //check if node has an update to the position of destination
         {
-                Position.x = m_locationService->GetPosition (dst).x;
-                Position.y = m_locationService->GetPosition (dst).y;
-                updated = myUpdated;
+                Vector lsPos = m_locationService->GetPosition (dst);
+                if (CalculateDistance (lsPos, m_locationService->GetInvalidPosition ()) != 0)
+                {
+                        m_dstCache.Update (dst, lsPos, lsUpdated);
+                }
         }
-
-
-        Ipv4Address nextHop;
-
-        if(m_neighbors.isNeighbour (dst))
+        ctx.dstPos = Position;
+        ctx.dstVel = hdr.GetDstVelocity ();
+        ctx.dstUpdated = MilliSeconds (updated);
+        m_dstCache.Lookup (dst, ctx.dstPos, ctx.dstVel, ctx.dstUpdated);
+        //压缩的流：更新的位置还在同一个格子里就沿用包头的位置，版本不变，下一跳的上下文还能用
+        if (hasFlow && GetPositionVersion (ctx.dstPos) == GetPositionVersion (Position))
         {
-                nextHop = dst;
+                ctx.dstPos = Position;
+                ctx.dstVel = hdr.GetDstVelocity ();
+                ctx.dstUpdated = MilliSeconds (updated);
         }
-        else
+        Position = ctx.dstPos;
+        updated = (uint32_t) ctx.dstUpdated.GetMilliSeconds ();
+
+        if (contention)
         {
-                nextHop = m_neighbors.BestNeighbor (Position, myPos, myVec);
+                Vector target = ctx.dstPos;
+                if (MaxExtrapolation > Seconds (0))
+                {
+                        target = DestinationCache::Extrapolate (ctx.dstPos, ctx.dstVel, ctx.dstUpdated, MaxExtrapolation);
+                }
+                PositionHeader posHeader (Position.x, Position.y,  updated, (uint64_t) 0, (uint64_t) 0, (uint8_t) 0, myPos.x, myPos.y);
+                posHeader.SetDstVelocity (ctx.dstVel);
+                posHeader.CopySource (hdr);
+                return Contend (p, header, Vector (hdr.GetLastPosx (), hdr.GetLastPosy (), 0), target,
+                                posHeader, udp, ucb);
         }
 
+        ctx.flowHash = GetFlowHash (origin, dst);
+        SelectNextHop (dst, ctx);
+        Ipv4Address nextHop = ctx.nextHop;
+
         if (nextHop != Ipv4Address::GetZero ())
         {
                 //如果是position 就新建新的破碎Header 增加到里面
 
                 PositionHeader posHeader (Position.x, Position.y,  updated, (uint64_t) 0, (uint64_t) 0, (uint8_t) 0, myPos.x, myPos.y);
-                p->AddHeader (posHeader);
-                p->AddHeader (tHeader);
+                posHeader.SetDstVelocity (ctx.dstVel);
+                posHeader.CopySource (hdr);
+                AddPositionHeaders (p, origin, nextHop, posHeader, hasFlow, flowHeader);
 
                 //add udp headers
-                if(packet->GetSize()!=86)
+                if (udp)
                 {
                         UdpHeader udpHeader;
                         p->AddHeader(udpHeader);
@@ -1198,15 +3291,13 @@ RoutingProtocol::Forwarding (Ptr<const Packet> packet, const Ipv4Header & header
                 route->SetSource (header.GetSource ());
                 route->SetGateway (nextHop);
 
-                // FIXME: Does not work for multiple interfaces
-                route->SetOutputDevice (m_ipv4->GetNetDevice (1));
+                route->SetOutputDevice (m_ipv4->GetNetDevice (GetOutputInterface (nextHop)));
                 route->SetDestination (header.GetDestination ());
                 NS_ASSERT (route != 0);
                 NS_LOG_DEBUG ("Exist route to " << route->GetDestination () << " from interface " << route->GetOutputDevice ());
                 NS_LOG_DEBUG (route->GetOutputDevice () << " forwarding to " << dst << " from " << origin << " through " << route->GetGateway () << " packet " << p->GetUid ());
 
-                ucb (route, p, header);
-                //ucb (route, p, header);
+                SendTracked (ucb, route, p, header, Position);
                 return true;
 
         }
@@ -1244,9 +3335,8 @@ RoutingProtocol::Forwarding (Ptr<const Packet> packet, const Ipv4Header & header
         // }
         //}
 
-        hdr.SetInRec(1);
-        hdr.SetRecPosx (myPos.x);
-        hdr.SetRecPosy (myPos.y);
+        hdr.StartPerimeter (myPos);
+        m_perimeterEntries++;
         hdr.SetLastPosx (Position.x); //when entering Recovery, the first edge is the Dst
         hdr.SetLastPosy (Position.y);
 
@@ -1255,11 +3345,156 @@ RoutingProtocol::Forwarding (Ptr<const Packet> packet, const Ipv4Header & header
         p->AddHeader (tHeader);
         RecoveryMode (dst, p, ucb, header);
 
-        NS_LOG_LOGIC ("Entering recovery-mode to " << dst << " in " << m_ipv4->GetAddress (1, 0).GetLocal ());
+        NS_LOG_LOGIC ("Entering recovery-mode to " << dst << " in " << GetMainAddress ());
+        return true;
+}
+
+
+
+//空闲超过上下文寿命的流，各跳的上下文都已经过期，它的ID可以给新的流用
+bool
+RoutingProtocol::GetFlowId (Ipv4Address dst, uint16_t &flowId)
+{
+        Time now = Simulator::Now ();
+        std::map<Ipv4Address, LocalFlow>::iterator i = m_flowIds.find (dst);
+        if (i != m_flowIds.end ())
+        {
+                i->second.used = now;
+                flowId = i->second.id;
+                return true;
+        }
+        for (i = m_flowIds.begin (); i != m_flowIds.end (); )
+        {
+                if (i->second.used + CompressionContextLifetime <= now)
+                {
+                        m_freeFlowIds.push_back (i->second.id);
+                        m_flowIds.erase (i++);
+                }
+                else
+                {
+                        ++i;
+                }
+        }
+        LocalFlow flow;
+        if (!m_freeFlowIds.empty ())
+        {
+                flow.id = m_freeFlowIds.back ();
+                m_freeFlowIds.pop_back ();
+        }
+        else if (m_nextFlowId <= 0xffff)
+        {
+                flow.id = m_nextFlowId++;
+        }
+        else
+        {
+                return false;
+        }
+        flow.used = now;
+        m_flowIds[dst] = flow;
+        flowId = flow.id;
+        return true;
+}
+
+void
+RoutingProtocol::AddPositionHeaders (Ptr<Packet> p, Ipv4Address origin, Ipv4Address nextHop,
+                                     const PositionHeader &posHeader, bool hasFlow, FlowHeader flowHeader)
+{
+        //recovery模式的包和没有下一跳的包总是带完整包头
+        if (!hasFlow || posHeader.GetInRec () != 0 || nextHop == Ipv4Address::GetZero ())
+        {
+                p->AddHeader (posHeader);
+                p->AddHeader (TypeHeader (GPSRTYPE_POS));
+                return;
+        }
+
+        //version是目的位置所在的格子：目的只在格子里移动时下一跳的上下文仍然可用，不用因为定位时间变了就重发
+        flowHeader.SetVersion (GetPositionVersion (Vector (posHeader.GetDstPosx (), posHeader.GetDstPosy (), 0)));
+        std::pair<Ipv4Address, FlowKey> key (nextHop, FlowKey (origin, flowHeader.GetFlowId ()));
+        std::map<std::pair<Ipv4Address, FlowKey>, FlowContext>::const_iterator i = m_flowContextsSent.find (key);
+        if (i != m_flowContextsSent.end () && i->second.version == flowHeader.GetVersion () && i->second.expire > Simulator::Now ())
+        {
+                p->AddHeader (flowHeader);
+                p->AddHeader (TypeHeader (GPSRTYPE_CPOS));
+                return;
+        }
+
+        //下一跳还没有（或者是旧的）上下文，发送完整包头并安装
+        PurgeFlowContexts ();
+        FlowContext sent;
+        sent.dstPos = Vector (posHeader.GetDstPosx (), posHeader.GetDstPosy (), 0);
+        sent.dstVel = posHeader.GetDstVelocity ();
+        sent.updated = posHeader.GetUpdated ();
+        sent.version = flowHeader.GetVersion ();
+        sent.expire = Simulator::Now () + Seconds (CompressionContextLifetime.GetSeconds () / 2);
+        m_flowContextsSent[key] = sent;
+        NS_LOG_DEBUG ("Install context of flow " << flowHeader.GetFlowId () << " of " << origin << " at " << nextHop);
+
+        p->AddHeader (flowHeader);
+        p->AddHeader (posHeader);
+        p->AddHeader (TypeHeader (GPSRTYPE_POS_CTX));
+}
+
+void
+RoutingProtocol::InstallFlowContext (Ipv4Address origin, const FlowHeader &flowHeader, const PositionHeader &posHeader)
+{
+        PurgeFlowContexts ();
+        FlowContext ctx;
+        ctx.dstPos = Vector (posHeader.GetDstPosx (), posHeader.GetDstPosy (), 0);
+        ctx.dstVel = posHeader.GetDstVelocity ();
+        ctx.updated = posHeader.GetUpdated ();
+        ctx.version = flowHeader.GetVersion ();
+        ctx.expire = Simulator::Now () + CompressionContextLifetime;
+        m_flowContexts[FlowKey (origin, flowHeader.GetFlowId ())] = ctx;
+}
+
+bool
+RoutingProtocol::RestoreFlowContext (Ipv4Address origin, const FlowHeader &flowHeader, PositionHeader &posHeader)
+{
+        std::map<FlowKey, FlowContext>::const_iterator i = m_flowContexts.find (FlowKey (origin, flowHeader.GetFlowId ()));
+        if (i == m_flowContexts.end () || i->second.version != flowHeader.GetVersion () || i->second.expire <= Simulator::Now ())
+        {
+                return false;
+        }
+        posHeader = PositionHeader (i->second.dstPos.x, i->second.dstPos.y, i->second.updated);
+        posHeader.SetDstVelocity (i->second.dstVel);
         return true;
 }
 
+void
+RoutingProtocol::PurgeFlowContexts ()
+{
+        Time now = Simulator::Now ();
+        for (std::map<FlowKey, FlowContext>::iterator i = m_flowContexts.begin (); i != m_flowContexts.end (); )
+        {
+                if (i->second.expire <= now)
+                {
+                        m_flowContexts.erase (i++);
+                }
+                else
+                {
+                        ++i;
+                }
+        }
+        for (std::map<std::pair<Ipv4Address, FlowKey>, FlowContext>::iterator i = m_flowContextsSent.begin (); i != m_flowContextsSent.end (); )
+        {
+                if (i->second.expire <= now)
+                {
+                        m_flowContextsSent.erase (i++);
+                }
+                else
+                {
+                        ++i;
+                }
+        }
+}
 
+uint32_t
+RoutingProtocol::GetPositionVersion (Vector position) const
+{
+        uint16_t x = (uint16_t) (int32_t) std::floor (position.x / CompressionTolerance);
+        uint16_t y = (uint16_t) (int32_t) std::floor (position.y / CompressionTolerance);
+        return ((uint32_t) x << 16) | y;
+}
 
 void
 RoutingProtocol::SetDownTarget (IpL4Protocol::DownTargetCallback callback)
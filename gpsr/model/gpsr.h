@@ -18,18 +18,63 @@
 
 #include "ns3/mobility-model.h"
 #include "gpsr-rqueue.h"
+#include "gpsr-rls.h"
+#include "gpsr-gls.h"
+#include "gpsr-oracle.h"
+#include "gpsr-home.h"
+#include "gpsr-dcache.h"
+#include "gpsr-ls-batch.h"
 
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv4-route.h"
+#include "ns3/mac48-address.h"
+#include "ns3/wifi-phy.h"
 #include "ns3/location-service.h"
 #include "ns3/god.h"
+#include "ns3/traced-callback.h"
 
 #include <map>
 #include <complex>
 
 namespace ns3 {
 namespace gpsr {
+
+/**
+ * \ingroup gpsr
+ * \brief Per-packet routing state
+ *
+ * Computed once per packet and carried from RouteOutput to AddHeaders (in a
+ * packet tag), so that the location service and the mobility model are only
+ * queried once for each packet.
+ */
+struct RouteContext
+{
+  Vector myPos;                 ///< Position of this node
+  Vector myVel;                 ///< Velocity of this node
+  Vector dstPos;                ///< Last known destination position
+  Vector dstVel;                ///< Destination velocity at dstUpdated
+  Time dstUpdated;              ///< Time the destination position was last updated
+  Ipv4Address nextHop;          ///< Chosen next hop, Ipv4Address::GetZero () if none
+  uint32_t flowHash;            ///< Flow (or flowlet) of the packet for multipath spreading, 0 if none
+};
+
+/**
+ * \ingroup gpsr
+ * \brief Per-hop state of a compressed flow
+ *
+ * Held by the receiver of a GPSRTYPE_POS_CTX packet (what the upstream hop
+ * installed) and by its sender (what it believes the next hop holds).
+ */
+struct FlowContext
+{
+  Vector dstPos;                ///< Destination position of the flow
+  Vector dstVel;                ///< Destination velocity of the flow
+  uint32_t updated;             ///< Update time of dstPos, as in the PositionHeader
+  uint32_t version;             ///< dstPos quantised to CompressionTolerance, the version of the context
+  Time expire;                  ///< Receiver: context removal time; sender: time a full header is resent
+};
+
 /**
  * \ingroup gpsr
  *
@@ -66,6 +111,161 @@ public:
   virtual void SendHello ();
   virtual bool IsMyOwnAddress (Ipv4Address src);
 
+  /// Number of neighbours currently in the position table
+  uint32_t GetNeighborCount ();
+  /// Number of neighbours heard on the given interface
+  uint32_t GetNeighborCount (uint32_t interface);
+  /// Number of routing decisions taken from the destination cache instead of the location service
+  uint32_t GetQueriesAvoided () const
+  {
+    return m_queriesAvoided;
+  }
+  /// Number of source stamps learned from received packets
+  uint32_t GetPiggybackedFixes () const
+  {
+    return m_piggybackedFixes;
+  }
+  /// Number of greedy selections answered from the greedy failure memory
+  uint32_t GetGreedyScansSaved () const
+  {
+    return m_greedyScansSaved;
+  }
+  /// Neighbour entries those selections did not have to scan
+  uint64_t GetNeighborsNotScanned () const
+  {
+    return m_neighborsNotScanned;
+  }
+  /// Greedy selections that scanned the neighbour table while the memory was on
+  uint32_t GetGreedyScans () const
+  {
+    return m_greedyScans;
+  }
+  /// Number of packets re-routed after the MAC failed to deliver them to their next hop
+  uint32_t GetFailovers () const
+  {
+    return m_failovers;
+  }
+  /// MAC retry time not spent on neighbours evicted after a TX error, one measured retry cycle per avoided neighbour
+  Time GetRetryAirtimeSaved () const
+  {
+    return m_retryAirtimeSaved;
+  }
+  /// Number of packets that entered Recovery-mode at this node
+  uint32_t GetPerimeterEntries () const
+  {
+    return m_perimeterEntries;
+  }
+  /// Greedy choices steered away from a neighbour that advertised no onward progress
+  uint32_t GetPerimeterEntriesAvoided () const
+  {
+    return m_neighbors.GetDeadEndsAvoided ();
+  }
+  /// Greedy choices spread to another of the near-equal candidates
+  uint32_t GetMultipathSpreads () const
+  {
+    return m_neighbors.GetMultipathSpreads ();
+  }
+  /// Greedy choices moved to a less loaded neighbour
+  uint32_t GetLoadDetours () const
+  {
+    return m_neighbors.GetLoadDetours ();
+  }
+  /// Bytes of neighbour summaries sent in extended HELLOs
+  uint64_t GetTwoHopOverhead () const
+  {
+    return m_twoHopBytes;
+  }
+  /// Beaconless packets this node forwarded after winning the contention
+  uint32_t GetContentionWins () const
+  {
+    return m_contentionWins;
+  }
+  /// Contentions given up on overhearing another forwarder of the packet
+  uint32_t GetContentionsSuppressed () const
+  {
+    return m_contentionsSuppressed;
+  }
+  /// Packets taken into custody instead of being dropped in Recovery-mode
+  uint32_t GetCustodyTaken () const
+  {
+    return m_custodyTaken;
+  }
+  /// Carried packets forwarded once a neighbour made progress
+  uint32_t GetCustodyForwarded () const
+  {
+    return m_custodyForwarded;
+  }
+  /// Carried packets handed to a neighbour moving towards their destination
+  uint32_t GetCustodyHandovers () const
+  {
+    return m_custodyHandovers;
+  }
+  /// Carried packets dropped, on overflow or timeout
+  uint32_t GetCustodyDrops () const
+  {
+    return m_custodyDrops;
+  }
+  /// Geocast and anycast packets delivered to this node
+  uint32_t GetGeocastDelivered () const
+  {
+    return m_geocastDelivered;
+  }
+  /// Geocast packets this node rebroadcast
+  uint32_t GetGeocastRebroadcasts () const
+  {
+    return m_geocastRebroadcasts;
+  }
+  /// Rebroadcasts given up on overhearing a close transmitter of the packet
+  uint32_t GetGeocastSuppressed () const
+  {
+    return m_geocastSuppressed;
+  }
+
+  /**
+   * \brief Register a target region
+   *
+   * Packets an application on any node sends to the returned address are
+   * routed to the polygon and delivered to every node inside it
+   * (GPSR_GEOCAST) or to the first one they reach (GPSR_ANYCAST). The
+   * addresses are taken from 240.0.0.0/8 and shared by the whole simulation
+   * until Simulator::Destroy disposes the routing protocols; vertices are
+   * meters, in order, with non-negative coordinates.
+   */
+  static Ipv4Address AddGeocastRegion (const std::vector<Vector> &polygon, GeocastMode mode);
+  /// Forget the registered regions
+  static void ClearGeocastRegions ();
+  /// Whether dst was returned by AddGeocastRegion
+  static bool IsGeocastAddress (Ipv4Address dst);
+
+  /**
+   * TracedCallback signature for received HELLOs.
+   * \param sender HELLO originator
+   * \param receiver local interface address the HELLO arrived on
+   * \param seqNo HELLO sequence number of the originator
+   */
+  typedef void (* HelloRxCallback)(Ipv4Address sender, Ipv4Address receiver, uint16_t seqNo);
+
+  /**
+   * TracedCallback signature for packets leaving Recovery-mode.
+   * \param dst destination of the packet
+   * \param hops hops the packet made in Recovery-mode
+   */
+  typedef void (* PerimeterCallback)(Ipv4Address dst, uint16_t hops);
+
+  /**
+   * TracedCallback signature for packets re-routed after a TX error.
+   * \param failedHop the next hop the MAC failed to reach
+   * \param nextHop the next hop the packet was handed to instead
+   */
+  typedef void (* FailoverCallback)(Ipv4Address failedHop, Ipv4Address nextHop);
+
+  /**
+   * TracedCallback signature for radio range estimates.
+   * \param neighbor the neighbour the estimate is for
+   * \param range estimated range of the link, meters
+   */
+  typedef void (* RangeCallback)(Ipv4Address neighbor, double range);
+
   Ptr<Ipv4> m_ipv4;
   /// Raw socket per each IP interface, map socket -> iface address (IP + mask)
   std::map< Ptr<Socket>, Ipv4InterfaceAddress > m_socketAddresses;
@@ -106,20 +306,79 @@ private:
   /// Queue packet and send route request
   Ptr<Ipv4Route> LoopbackRoute (const Ipv4Header & header, Ptr<NetDevice> oif);
 
-  /// If route exists and valid, forward packet.
-  bool Forwarding (Ptr<const Packet> p, const Ipv4Header & header, UnicastForwardCallback ucb, ErrorCallback ecb);
+  /// If route exists and valid, forward packet. udp: the received packet had a UDP header in front of the GPSR headers
+  bool Forwarding (Ptr<const Packet> p, const Ipv4Header & header, UnicastForwardCallback ucb, ErrorCallback ecb, bool udp);
 
   /// Find socket with local interface address iface
   Ptr<Socket> FindSocketWithInterfaceAddress (Ipv4InterfaceAddress iface) const;
 
+  /// Fill own position/velocity and destination position/freshness (one query each)
+  RouteContext ComputeRouteContext (Ipv4Address dst);
+  /// Choose the greedy next hop for a context whose positions are already filled
+  void SelectNextHop (Ipv4Address dst, RouteContext &ctx);
+  /// Carry the context to AddHeaders for this packet
+  void AttachRouteContext (Ptr<Packet> p, const RouteContext &ctx);
+
+  /**
+   * \brief Promiscuous receive hook installed on the WifiNetDevice when PromiscuousLearning is enabled
+   *
+   * Overheard GPSR data frames carry the position of their transmitter in the
+   * PositionHeader; only the GPSR type and position headers are parsed and the
+   * neighbour table is refreshed. The packet itself is never delivered.
+   */
+  void PromiscReceive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                       const Address &from, const Address &to, NetDevice::PacketType packetType);
+
   //Check packet from deffered route output queue and send if position is already available
 //returns true if the IP should be erased from the list (was sent/droped)
   bool SendPacketFromQueue (Ipv4Address dst);
+  /// Send the packets queued for dst, whose position is known
+  bool SendQueuedPackets (Ipv4Address dst);
+  /// Replace the GPSR headers a queued packet was deferred with (invalid destination position) by a header built from ctx; false if they are unknown
+  bool RestampQueuedPacket (Ptr<Packet> p, const RouteContext &ctx, PositionHeader &posHeader);
 
   //Calls SendPacketFromQueue and re-schedules
   void CheckQueue ();
 
+  /// Drain (or drop) the packets queued for dst as soon as the location service ends its search
+  void SearchDone (Ipv4Address dst);
+
   void RecoveryMode(Ipv4Address dst, Ptr<Packet> p, UnicastForwardCallback ucb, Ipv4Header header);
+  /// Next hop of face routing on the planar subgraph towards the destination of hdr, zero when stuck; updates the perimeter state of hdr
+  Ipv4Address PerimeterNextHop (Ipv4Address dst, PositionHeader &hdr);
+
+  ///\name Per-flow header compression
+  //\{
+  /// Flow key: IP source of the flow and the flow ID it chose
+  typedef std::pair<Ipv4Address, uint16_t> FlowKey;
+  /// Flow ID of a locally originated flow
+  struct LocalFlow
+  {
+    uint16_t id;
+    Time used;                  ///< Last packet of the flow
+  };
+  bool HeaderCompression;                ///< Replace repeated position headers by a FlowHeader
+  Time CompressionContextLifetime;       ///< Lifetime of a context at the receiver, senders refresh at half of it
+  double CompressionTolerance;           ///< Side of the grid destination positions are quantised to, meters
+  std::map<Ipv4Address, LocalFlow> m_flowIds;                ///< Flow ID per destination of locally originated flows
+  std::vector<uint16_t> m_freeFlowIds;                       ///< IDs of flows idle for longer than the context lifetime
+  uint32_t m_nextFlowId;                                     ///< Next never used flow ID
+  std::map<FlowKey, FlowContext> m_flowContexts;             ///< Contexts installed by upstream hops
+  std::map<std::pair<Ipv4Address, FlowKey>, FlowContext> m_flowContextsSent; ///< Contexts installed at each next hop
+  /// Flow ID of locally originated packets to dst, false if all IDs are in use
+  bool GetFlowId (Ipv4Address dst, uint16_t &flowId);
+  /// Add the position headers for nextHop, compressed if it already holds the flow context
+  void AddPositionHeaders (Ptr<Packet> p, Ipv4Address origin, Ipv4Address nextHop,
+                           const PositionHeader &posHeader, bool hasFlow, FlowHeader flowHeader);
+  /// Store the context carried by a GPSRTYPE_POS_CTX packet
+  void InstallFlowContext (Ipv4Address origin, const FlowHeader &flowHeader, const PositionHeader &posHeader);
+  /// Rebuild the position header of a GPSRTYPE_CPOS packet, false if the context is unknown or stale
+  bool RestoreFlowContext (Ipv4Address origin, const FlowHeader &flowHeader, PositionHeader &posHeader);
+  /// Drop expired contexts
+  void PurgeFlowContexts ();
+  /// Context version of a destination position: its CompressionTolerance grid square
+  uint32_t GetPositionVersion (Vector position) const;
+  //\}
   
   uint32_t MaxQueueLen;                  ///< The maximum number of packets that we allow a routing protocol to buffer.
   Time MaxQueueTime;                     ///< The maximum period of time that a routing protocol is allowed to buffer a packet for.
@@ -127,11 +386,330 @@ private:
 
   Timer HelloIntervalTimer;
   Timer CheckQueueTimer;
+
+  ///\name Mobility-adaptive HELLO scheduling
+  //\{
+  bool AdaptiveHello;                    ///< Beacon on displacement/timeout instead of every HelloInterval
+  Time HelloMinInterval;                 ///< Minimum time between two HELLOs (polling period)
+  Time HelloMaxInterval;                 ///< A HELLO is always sent after this long, even if the node did not move
+  double HelloDistanceThreshold;         ///< Displacement since the last HELLO that triggers a new one, meters
+  Vector m_lastHelloPos;                 ///< Position advertised in the last HELLO
+  Time m_lastHelloTime;                  ///< Time the last HELLO was sent
+  uint32_t m_helloSent;                  ///< Number of HELLO rounds sent
+  //\}
+
+  ///\name Density-aware HELLO scheduling
+  //\{
+  bool DensityAwareHello;                ///< Scale the HELLO interval with the neighbour count and slot transmissions
+  uint32_t HelloDensityThreshold;        ///< Neighbour count up to which HelloInterval is used unscaled
+  uint32_t HelloSlots;                   ///< Number of transmission slots a HELLO period is divided into
+  uint32_t m_helloSlot;                  ///< Slot of this node, hashed from its address
+  uint16_t m_helloSeqNo;                 ///< Sequence number of the next HELLO
+  /// HELLO period for the current neighbour density
+  Time DensityHelloInterval ();
+  /// Delay until the start of this node's slot in the next HELLO period
+  Time NextHelloSlot ();
+  //\}
+
+  ///\name Two-hop neighbour summaries
+  //\{
+  bool TwoHopHello;                      ///< Send extended HELLOs carrying the neighbour positions
+  uint32_t TwoHopMaxNeighbors;           ///< Most neighbours advertised in one HELLO
+  uint8_t TwoHopQuantum;                 ///< Resolution of the advertised positions, meters
+  uint64_t m_twoHopBytes;                ///< Summary bytes sent
+  uint32_t m_perimeterEntries;           ///< Packets that entered Recovery-mode here
+  /// Summary of the farthest neighbours, relative to myPos
+  NeighborSummaryHeader GetNeighborSummary (Vector myPos);
+  //\}
+
+  ///\name Load-aware greedy forwarding
+  //\{
+  double LoadTolerance;                  ///< Progress a less loaded next hop may give up, meters
+  std::map<uint32_t, double> m_queueLoad;  ///< Smoothed MAC queue occupancy per interface, 0 to 1
+  /// Queue occupancy of interface to advertise in its HELLO, 0 to 255
+  uint8_t GetQueueLoad (uint32_t interface);
+  //\}
+
+  ///\name Multipath spreading
+  //\{
+  /// Current flowlet of a flow seen by this node
+  struct Flowlet
+  {
+    uint32_t id;
+    Time last;                           ///< Time of the last packet
+  };
+  uint32_t MultipathCandidates;          ///< Near-equal greedy candidates flows are hashed over, 1 disables
+  double MultipathTolerance;             ///< Relative score gap of a near-equal candidate
+  Time FlowletGap;                       ///< Idle time that starts a new flowlet of a flow, 0 hashes whole flows
+  std::map<std::pair<Ipv4Address, Ipv4Address>, Flowlet> m_flowlets;  ///< Per (origin, destination)
+  /// Hash of the current flowlet from origin to dst, 0 if spreading is off
+  uint32_t GetFlowHash (Ipv4Address origin, Ipv4Address dst);
+  //\}
+
+  ///\name Beaconless contention-based forwarding
+  //\{
+  /// A broadcast data packet: origin and destination, IP identification
+  typedef std::pair<std::pair<Ipv4Address, Ipv4Address>, uint16_t> ContentionKey;
+  /// Received packet waiting for its contention timer
+  struct Contention
+  {
+    Ptr<Packet> packet;                  ///< Without the GPSR headers
+    Ipv4Header header;
+    UnicastForwardCallback ucb;
+    PositionHeader posHeader;            ///< Position header to forward the packet with
+    bool udp;                            ///< Put back the UDP header in front of the GPSR headers
+    EventId timer;
+  };
+  bool Beaconless;                       ///< Broadcast data and let the receivers contend instead of using the neighbour table
+  Time ContentionMaxDelay;               ///< Contention delay of a receiver making no progress
+  std::map<ContentionKey, Contention> m_contentions;
+  std::map<ContentionKey, Time> m_contentionSeen;  ///< Time each beaconless or geocast packet was first heard
+  uint32_t m_contentionWins;
+  uint32_t m_contentionsSuppressed;
+  /// Subnet-directed broadcast of the first interface, the gateway of beaconless packets
+  Ipv4Address GetContentionGateway () const;
+  /**
+   * Start the contention for a received GPSRTYPE_CBF packet, or give up the
+   * pending one when it is overheard from another forwarder
+   * \param senderPos position of the node that sent the packet
+   * \param target destination position the progress is measured to
+   * \param udp the received packet had a UDP header in front of the GPSR headers
+   */
+  bool Contend (Ptr<Packet> p, const Ipv4Header &header, Vector senderPos, Vector target,
+                const PositionHeader &posHeader, bool udp, UnicastForwardCallback ucb);
+  /// The contention timer of key fired: forward the packet
+  void ContentionExpire (ContentionKey key);
+  //\}
+
+  ///\name Store-carry-forward
+  //\{
+  /// Packet neither greedy forwarding nor Recovery-mode could deliver, carried by this node
+  struct CustodyEntry
+  {
+    Ptr<Packet> packet;                  ///< Without the GPSR headers
+    Ipv4Header header;
+    UnicastForwardCallback ucb;
+    PositionHeader posHeader;            ///< Destination and source stamp of the packet
+    Time expire;
+  };
+  uint32_t CustodyBufferSize;            ///< Packets carried at most, 0 drops them as before
+  Time CustodyTimeout;                   ///< Time a packet is carried at most
+  std::list<CustodyEntry> m_custody;     ///< Oldest first
+  uint32_t m_custodyTaken;
+  uint32_t m_custodyForwarded;
+  uint32_t m_custodyHandovers;
+  uint32_t m_custodyDrops;
+  /// Carry a packet Recovery-mode gave up on, the oldest one is dropped when full; false if custody is off
+  bool TakeCustody (Ptr<Packet> p, const Ipv4Header &header, UnicastForwardCallback ucb, const PositionHeader &posHeader);
+  /// Forward the carried packets that have a greedy next hop now, or hand them to a carrier moving faster towards the destination
+  void ReleaseCustody ();
+  //\}
+
+  ///\name Geocast and anycast
+  //\{
+  /// Geocast packet waiting to be rebroadcast inside its region
+  struct GeocastPending
+  {
+    Ptr<Packet> packet;                  ///< Without the GPSR headers
+    Ipv4Header header;
+    UnicastForwardCallback ucb;
+    GeocastHeader geoHeader;
+    EventId timer;
+  };
+  static std::map<Ipv4Address, GeocastHeader> s_geocastRegions;  ///< Region of every geocast address, cleared in DoDispose
+  bool GeocastFlooding;                  ///< Flood geocast packets through the whole network instead of routing them, as a baseline
+  Time GeocastMaxDelay;                  ///< Rebroadcast delay of a receiver next to the transmitter
+  double GeocastSuppressDistance;        ///< Receivers closer than this to a transmitter of the packet do not rebroadcast it, meters
+  std::map<ContentionKey, GeocastPending> m_geocastPending;
+  uint32_t m_geocastDelivered;
+  uint32_t m_geocastRebroadcasts;
+  uint32_t m_geocastSuppressed;
+  /// Route of a packet sent to a geocast address: greedy towards the region, the loopback when stuck outside it so RecvGeocast starts face routing, or broadcast inside it
+  Ptr<Ipv4Route> GeocastRouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif, Socket::SocketErrno &sockerr);
+  /// Deliver, forward or rebroadcast a received GPSRTYPE_GEO packet
+  bool RecvGeocast (Ptr<const Packet> p, const Ipv4Header &header, int32_t iif,
+                    UnicastForwardCallback ucb, LocalDeliverCallback lcb);
+  /// The rebroadcast timer of key fired
+  void GeocastExpire (ContentionKey key);
+  //\}
+
+  /// Fired for every HELLO packet handed to a socket
+  TracedCallback<Ptr<const Packet> > m_helloTxTrace;
+  /// Fired for every HELLO received
+  TracedCallback<Ipv4Address, Ipv4Address, uint16_t> m_helloRxTrace;
   uint8_t LocationServiceName;
   PositionTable m_neighbors;
+  /// Destination fixes learned from the location service, HELLOs and forwarded packets
+  DestinationCache m_dstCache;
+  Time MaxExtrapolation;                 ///< Destination positions are extrapolated for at most this long, 0 disables
+  Time PiggybackMaxAge;                  ///< Cached fixes younger than this are used without asking the location service, 0 always asks and stamps no source
+  uint32_t m_queriesAvoided;
+  uint32_t m_piggybackedFixes;
+
+  ///\name Greedy failure memory
+  //\{
+  /// Greedy forwarding found no neighbour closer to a target in a destination cell
+  struct GreedyFailure
+  {
+    uint32_t version;                    ///< Neighbour table version of the failed scan
+    double drift;                        ///< Neighbour table drift at the failed scan
+    Vector target;                       ///< Target of the failed scan
+    double margin;                       ///< Every neighbour was at least this much further from target than this node
+    Vector myPos;                        ///< Position of this node at the failed scan
+    Time expire;
+  };
+  typedef std::pair<int32_t, int32_t> Cell;
+  double GreedyFailureCell;              ///< Side of the destination cells failures are remembered for, 0 disables
+  Time GreedyFailureLifetime;            ///< Time a failure is remembered with an unchanged neighbour table
+  std::map<Cell, GreedyFailure> m_greedyFailures;
+  uint32_t m_greedyScansSaved;
+  uint32_t m_greedyScans;
+  uint64_t m_neighborsNotScanned;
+  /// Cell of a destination position
+  Cell GetGreedyCell (Vector position) const;
+  /// Greedy next hop towards target, Ipv4Address::GetZero () if no neighbour is closer
+  Ipv4Address GreedyNextHop (Vector target, const RouteContext &ctx);
+  //\}
+
+  ///\name Multiple interfaces
+  //\{
+  /// Interface the neighbour nextHop was heard on, the main interface if it is not a neighbour
+  uint32_t GetOutputInterface (Ipv4Address nextHop);
+  /// Address of the main interface, identifies this node
+  Ipv4Address GetMainAddress () const;
+  /// Interface whose subnet-directed broadcast address is dst, 0 if none
+  uint32_t GetBroadcastInterface (Ipv4Address dst);
+  //\}
+
+  ///\name MAC transmit feedback
+  //\{
+  /// Unicast packet handed to the MAC, kept until the MAC reports it sent or failed
+  struct InFlight
+  {
+    Ptr<Packet> packet;         ///< Copy-on-write copy, shares the buffer of the packet sent
+    Ipv4Header header;
+    UnicastForwardCallback ucb;
+    Vector dstPos;
+    Time sent;
+    Ipv4Address nextHop;
+    bool transmitted;           ///< The PHY started sending it, mac, seq and firstTx are valid
+    Mac48Address mac;           ///< Receiver address of the frame
+    uint16_t seq;               ///< Sequence number the MAC gave the frame
+    Time firstTx;               ///< Start of the first transmission of the frame
+  };
+  /// Receiver address and MAC sequence number of a frame
+  typedef std::pair<Mac48Address, uint16_t> FrameKey;
+  /// Neighbour removed after a TX error, remembered until its entry would have expired
+  struct EvictedNeighbor
+  {
+    Vector position;
+    Time expire;
+  };
+  std::map<uint64_t, InFlight> m_inFlight;               ///< Tracked packets by UID
+  std::map<FrameKey, uint64_t> m_inFlightFrames;          ///< UID of every tracked frame the PHY sent, for the MAC reports
+  std::list<uint64_t> m_inFlightOrder;                    ///< UIDs in the order they were tracked, to expire them
+  Time m_retryCycle;                                      ///< Smoothed first transmission to TX error time of failed frames
+  std::map<Ipv4Address, EvictedNeighbor> m_evicted;
+  uint32_t m_failovers;
+  Time m_retryAirtimeSaved;
+  TracedCallback<Ipv4Address, Ipv4Address> m_failoverTrace;
+  /// Hand a greedy packet to ucb and keep a copy until the MAC reports on it
+  void SendTracked (UnicastForwardCallback ucb, Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Header &header, Vector dstPos);
+  /// The PHY started sending a frame: bind the tracked packet to its sequence number
+  void ProcessPhyTxBegin (Ptr<const Packet> packet);
+  /// Remove the tracked packet the MAC reported on, false if it is not tracked
+  bool TakeInFlight (WifiMacHeader const &hdr, InFlight &f);
+  /// Stop tracking the packet with this UID
+  void EraseInFlight (std::map<uint64_t, InFlight>::iterator i);
+  /// The MAC delivered a frame
+  void ProcessTxOk (WifiMacHeader const &hdr);
+  /// The MAC gave up on a frame: re-route that packet to the next best neighbour
+  void ProcessTxError (WifiMacHeader const &hdr);
+  /// Replace the GPSR headers built for oldHop by the ones for nextHop, false if they cannot be rebuilt
+  bool RebuildHeaders (Ptr<Packet> p, Ipv4Address origin, Ipv4Address oldHop, Ipv4Address nextHop, Vector myPos);
+  /// The position table removed a neighbour after a TX error: remember it as evicted
+  void LinkFailure (Ipv4Address neighbor, Vector position, Time expire);
+  /// Account a measured retry cycle if an evicted neighbour would have been chosen instead of ctx.nextHop
+  void CountRetrySaved (Vector target, const RouteContext &ctx);
+  //\}
+
+  ///\name Airtime metric
+  //\{
+  /// Transmission attempts per delivered frame to a neighbour, smoothed, and the rate it was sent at
+  struct LinkStats
+  {
+    double etx;
+    uint32_t failures;                   ///< Failed attempts since the last delivered frame
+    uint64_t rate;                       ///< Data rate of the last frame sent to it, bit/s, 0 if none yet
+  };
+  uint8_t ForwardingStrategy;            ///< NextHopStrategy of the greedy selection
+  bool AirtimeMetric;                    ///< Greedy selection by progress per expected airtime instead of geometry
+  uint32_t AirtimeFrameSize;             ///< Frame size the expected airtime is computed for, bytes
+  Time AirtimeOverhead;                  ///< Per attempt airtime besides the payload: preamble, IFS, backoff, ACK
+  std::map<Mac48Address, LinkStats> m_linkStats;
+  /// Expected airtime of a frame to neighbor, heard on interface: last rate used towards it times the observed attempts
+  Time GetAirtime (Ipv4Address neighbor, uint32_t interface);
+  /// Statistics of the link to address, created if new
+  LinkStats & FindLinkStats (Mac48Address address);
+  /// A transmission attempt to address failed
+  void ProcessTxDataFailed (Mac48Address address);
+  /// The PHY sent a frame: remember the rate the station manager chose for its receiver
+  void MonitorSnifferTx (Ptr<const Packet> packet, uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+                         WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu);
+  /// Greedy scan of the neighbour table with the configured strategy
+  Ipv4Address ScanNeighbors (Vector target, const RouteContext &ctx);
+  //\}
+
+  ///\name Radio range estimation
+  //\{
+  /// HELLO reception from a neighbour
+  struct RangeEstimate
+  {
+    double power;                        ///< Received power extrapolated to 1 m, dBm, smoothed
+    double delivery;                     ///< Fraction of its HELLOs received, smoothed
+    uint16_t lastSeqNo;
+    uint32_t hellos;
+  };
+  bool RangeEstimation;                  ///< Estimate the range of every neighbour from the signal and loss of its HELLOs
+  double DefaultRange;                   ///< Range assumed before an estimate exists, meters
+  double RangeThreshold;                 ///< Weakest signal a frame is still received with, dBm
+  std::map<Ipv4Address, RangeEstimate> m_ranges;
+  std::map<Ipv4Address, double> m_helloSignal;  ///< Signal of the last HELLO sniffed from each neighbour, dBm
+  ///\name Path loss fit over all neighbours: smoothed moments of log10 (distance) and signal
+  //\{
+  double m_fitX;
+  double m_fitY;
+  double m_fitXX;
+  double m_fitXY;
+  uint32_t m_fitSamples;
+  //\}
+  TracedCallback<Ipv4Address, double> m_rangeTrace;
+  /// Frame received by the PHY of a wifi interface; keeps the signal of HELLOs
+  void MonitorSnifferRx (Ptr<const Packet> packet, uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+                         WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu,
+                         struct signalNoiseDbm signalNoise);
+  /// Path loss exponent of the fit, 3 until the samples spread enough
+  double GetPathLossExponent () const;
+  /// Update the range of sender with its HELLO sent at position
+  void UpdateRange (Ipv4Address sender, Vector position, uint16_t seqNo);
+  //\}
+  /// Stamp the position and velocity of this node into a header it originates
+  void StampSource (PositionHeader &posHeader, const RouteContext &ctx);
+  /// Cache the source stamp carried by a full position header
+  void LearnSource (Ipv4Address origin, const PositionHeader &posHeader);
   bool PerimeterMode;
+  uint16_t MaxPerimeterHops;             ///< Packets making more hops in Recovery-mode are dropped
+  /// Fired when a packet returns to greedy mode or is delivered in Recovery-mode
+  TracedCallback<Ipv4Address, uint16_t> m_perimeterExitTrace;
+  /// Fired when a packet is dropped in Recovery-mode: face toured, hop limit or no neighbour
+  TracedCallback<Ipv4Address, uint16_t> m_perimeterDropTrace;
+  bool PromiscuousLearning;              ///< Learn neighbour positions from overheard data frames
+  /// Transmitter MAC to IP bindings, learned from overheard broadcasts (HELLOs are sent by their originator)
+  std::map<Mac48Address, Ipv4Address> m_macToIp;
   std::list<Ipv4Address> m_queuedAddresses;
   Ptr<LocationService> m_locationService;
+  /// Set when the home region service is in use, receives the messages sent to its regions
+  Ptr<HomeRegionLocationService> m_homeRegion;
 
   IpL4Protocol::DownTargetCallback m_downTarget;
 
@@ -100,20 +100,28 @@ private:
   void ReceivePacket (Ptr<Socket> socket);
   void CheckThroughput ();
   void Statistics (int nodes);
+  void PacketSent (Ptr<const Packet> packet);
+  void HelloTx (Ptr<const Packet> packet);
 
   uint32_t port;
   uint32_t bytesTotal;
   uint32_t packetsReceived;
   uint32_t packetsTotal;
+  uint32_t packetsSent;
+  uint32_t packetsDelivered;
+  uint32_t helloPackets;
+  uint32_t helloBytes;
   Time totalTime;
 
   std::string m_CSVfileName;
   std::string m_averageTimeFile;
+  std::string m_controlFile;
   int m_nSinks;
   std::string m_protocolName;
   double m_txp;
   bool m_traceMobility;
   uint32_t m_protocol;
+  bool m_adaptiveHello;
 };
 
 RoutingExperiment::RoutingExperiment ()
@@ -121,11 +129,17 @@ RoutingExperiment::RoutingExperiment ()
     bytesTotal (0),
     packetsReceived (0),
     packetsTotal (0),
+    packetsSent (0),
+    packetsDelivered (0),
+    helloPackets (0),
+    helloBytes (0),
     totalTime (Seconds(0)),
     m_CSVfileName ("manet-routing.output.csv"),
     m_averageTimeFile ("manet-routing.time.csv"),
+    m_controlFile ("manet-routing.control.csv"),
     m_traceMobility (false),
-    m_protocol (2) // AODV
+    m_protocol (2), // AODV
+    m_adaptiveHello (false)
 {
 }
 
@@ -158,6 +172,7 @@ RoutingExperiment::ReceivePacket (Ptr<Socket> socket)
       bytesTotal += packet->GetSize ();
       packetsReceived += 1;
       packetsTotal += 1;
+      packetsDelivered += 1;
       TimestampTag timestamp;
       if (packet->FindFirstMatchingByteTag (timestamp))
       {
@@ -205,6 +220,31 @@ void RoutingExperiment::Statistics (int nodes)
       << std::endl;
 
   out.close ();
+
+  // HELLO overhead against delivery, to compare fixed and adaptive beaconing
+  std::ofstream control (m_controlFile.c_str (), std::ios::app);
+  control << nodes << ","
+          << m_adaptiveHello << ","
+          << helloPackets << ","
+          << helloBytes << ","
+          << packetsSent << ","
+          << packetsDelivered << ","
+          << (packetsSent ? (double) packetsDelivered / packetsSent : 0.0) << ""
+          << std::endl;
+  control.close ();
+}
+
+void
+RoutingExperiment::PacketSent (Ptr<const Packet> packet)
+{
+  packetsSent += 1;
+}
+
+void
+RoutingExperiment::HelloTx (Ptr<const Packet> packet)
+{
+  helloPackets += 1;
+  helloBytes += packet->GetSize ();
 }
 
 Ptr<Socket>
@@ -226,6 +266,7 @@ RoutingExperiment::CommandSetup (int argc, char **argv)
   cmd.AddValue ("CSVfileName", "The name of the CSV output file name", m_CSVfileName);
   cmd.AddValue ("traceMobility", "Enable mobility tracing", m_traceMobility);
   cmd.AddValue ("protocol", "1=OLSR;2=AODV;3=DSDV;4=DSR", m_protocol);
+  cmd.AddValue ("adaptiveHello", "Use mobility-adaptive GPSR HELLO scheduling", m_adaptiveHello);
   // cmd.AddValue ("AverageTimeFile", "The name of the time file", m_averageTimeFile);
   cmd.Parse (argc, argv);
   return m_CSVfileName;
@@ -260,6 +301,17 @@ main (int argc, char *argv[])
   out1.close ();
   NS_LOG_UNCOND ("Create the second csv file!");
 
+  std::ofstream out2 ("manet-routing.control.csv");
+  out2 << "NodeCounts," <<
+  "AdaptiveHello," <<
+  "HelloPackets," <<
+  "HelloBytes," <<
+  "PacketsSent," <<
+  "PacketsReceived," <<
+  "DeliveryRatio" <<
+  std::endl;
+  out2.close ();
+
   int nSinks = 10;
   double txp = 20;
 
@@ -283,6 +335,10 @@ RoutingExperiment::Run (int nSinks, double txp, std::string CSVfileName, int pro
   m_CSVfileName = CSVfileName;
 
   m_protocol = protocol;
+  packetsSent = 0;
+  packetsDelivered = 0;
+  helloPackets = 0;
+  helloBytes = 0;
 
   int nWifis = nodes;
 
@@ -397,11 +453,14 @@ RoutingExperiment::Run (int nSinks, double txp, std::string CSVfileName, int pro
     {
       {
         GpsrHelper gpsr;
+        gpsr.Set ("AdaptiveHello", BooleanValue (m_adaptiveHello));
         internet.SetRoutingHelper (gpsr);
         internet.Install (adhocNodes);
       }
     
       gpsr.Install();
+      Config::ConnectWithoutContext ("/NodeList/*/$ns3::gpsr::RoutingProtocol/HelloTx",
+                                     MakeCallback (&RoutingExperiment::HelloTx, this));
     }
 
   NS_LOG_INFO ("assigning ip address");
@@ -425,6 +484,7 @@ RoutingExperiment::Run (int nSinks, double txp, std::string CSVfileName, int pro
       factory.Set("Port", UintegerValue(9));
       factory.Set("NumPackets", UintegerValue(200));
       Ptr<Sender> sender = factory.Create<Sender>();
+      sender->TraceConnectWithoutContext ("Tx", MakeCallback (&RoutingExperiment::PacketSent, this));
 
       Ptr<Node> appSource = NodeList::GetNode (i+nSinks);
       appSource->AddApplication (sender);